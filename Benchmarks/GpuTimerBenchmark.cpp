@@ -0,0 +1,183 @@
+/*
+ * Checks and costs of the GPU profiler in Source/GpuTimer.cpp, driven by SimulatedGpuTimerBackend so it runs without
+ * a GPU. The checks cover readback latency, frames skipped while the GPU is too far behind, disjoint frames being
+ * left out of the averages and the pass timings themselves; the timing is the CPU cost the profiler adds per frame.
+ *
+ * Linux:   g++ -std=c++17 -O2 -ISource Benchmarks/GpuTimerBenchmark.cpp Source/GpuTimer.cpp Source/Clock.cpp -o gpu_timer_benchmark
+ * Windows: cl /std:c++17 /O2 /EHsc /ISource Benchmarks\GpuTimerBenchmark.cpp Source\GpuTimer.cpp Source\Clock.cpp
+ *
+ * Usage: gpu_timer_benchmark [iterations]
+ */
+#include "GpuTimer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+
+using namespace awesome;
+
+namespace {
+
+	double BestSeconds(int iterations, const std::function<void()>& kernel) {
+		double best = 1e30;
+		for (int i = 0; i < iterations; ++i) {
+			auto start = std::chrono::steady_clock::now();
+			kernel();
+			best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	}
+
+	bool Check(const char* name, bool passed) {
+		printf("%-62s %s\n", name, passed ? "ok" : "FAILED");
+		return passed;
+	}
+
+	/* One tick per microsecond, so tick counts read as thousandths of a millisecond */
+	constexpr uint64_t FREQUENCY = 1000000;
+
+	/* Pass 0 of a frame writes timestamps 2 and 3, the frame end is 1 and written last */
+	void SetFrameTicks(SimulatedGpuTimerBackend& backend, uint64_t passTicks, uint64_t afterPassTicks) {
+		backend.SetTimestampDelta(2, 100);
+		backend.SetTimestampDelta(3, passTicks);
+		backend.SetTimestampDelta(1, afterPassTicks);
+	}
+
+	void RunFrame(GpuProfiler& profiler, SimulatedGpuTimerBackend& backend) {
+		profiler.BeginFrame();
+		profiler.BeginPass("Scene");
+		profiler.EndPass();
+		profiler.EndFrame();
+		backend.Present();
+	}
+
+	const GpuPassStats* FindPass(const GpuProfiler& profiler, const char* name) {
+		for (const GpuPassStats& pass : profiler.GetPassStats())
+			if (!strcmp(pass.name, name))
+				return &pass;
+		return nullptr;
+	}
+
+	bool NearlyEqual(double a, double b) {
+		return std::fabs(a - b) < 1e-9;
+	}
+
+	bool RunChecks() {
+		bool passed = true;
+
+		passed &= Check("frames are read back latency frames after they end", [] {
+			const uint32_t latency = 2;
+			SimulatedGpuTimerBackend backend(FREQUENCY, latency);
+			GpuProfiler profiler(backend);
+			if (!profiler.Init())
+				return false;
+			SetFrameTicks(backend, 2000, 1000);
+			bool inOrder = true;
+			for (uint32_t frame = 1; frame <= 10; ++frame) {
+				RunFrame(profiler, backend);
+				/* A frame is collected by the BeginFrame latency frames after its own */
+				inOrder &= profiler.GetFramesRead() == (frame > latency ? frame - latency : 0);
+			}
+			return inOrder && profiler.GetFramesSkipped() == 0 && profiler.GetFramesDisjoint() == 0;
+		}());
+
+		passed &= Check("frame and pass timings come from the timestamps", [] {
+			SimulatedGpuTimerBackend backend(FREQUENCY, 1);
+			GpuProfiler profiler(backend);
+			profiler.Init();
+			SetFrameTicks(backend, 2000, 1000);
+			for (int frame = 0; frame < 8; ++frame)
+				RunFrame(profiler, backend);
+			const GpuPassStats* frame = FindPass(profiler, "Frame");
+			const GpuPassStats* scene = FindPass(profiler, "Scene");
+			return frame && scene && profiler.GetPassStats()[0].name == frame->name && NearlyEqual(frame->gpuMs, 3.1)
+				&& NearlyEqual(scene->gpuMs, 2.0) && scene->samples == profiler.GetFramesRead();
+		}());
+
+		passed &= Check("a slot the GPU has not finished is skipped, not waited on", [] {
+			/* Two frames more than the ring holds: every slot is still pending when its turn comes */
+			const uint32_t latency = GpuProfiler::FRAME_LATENCY + 2;
+			SimulatedGpuTimerBackend backend(FREQUENCY, latency);
+			GpuProfiler profiler(backend);
+			profiler.Init();
+			SetFrameTicks(backend, 2000, 1000);
+			const uint32_t frames = 24;
+			for (uint32_t frame = 0; frame < frames; ++frame)
+				RunFrame(profiler, backend);
+			uint64_t accounted = profiler.GetFramesRead() + profiler.GetFramesSkipped();
+			const GpuPassStats* scene = FindPass(profiler, "Scene");
+			return profiler.GetFramesSkipped() > 0 && profiler.GetFramesRead() > 0 && accounted <= frames
+				&& accounted + GpuProfiler::FRAME_LATENCY >= frames && scene && NearlyEqual(scene->gpuMs, 2.0);
+		}());
+
+		passed &= Check("a GPU that never finishes leaves every later frame untimed", [] {
+			SimulatedGpuTimerBackend backend(FREQUENCY, 1);
+			GpuProfiler profiler(backend);
+			profiler.Init();
+			const uint32_t frames = 12;
+			for (uint32_t frame = 0; frame < frames; ++frame) {
+				profiler.BeginFrame();
+				profiler.EndFrame();
+			}
+			return profiler.GetFramesRead() == 0 && profiler.GetFramesSkipped() == frames - GpuProfiler::FRAME_LATENCY
+				&& profiler.GetPassStats().empty();
+		}());
+
+		passed &= Check("disjoint frames are counted and left out of the averages", [] {
+			const uint32_t disjointEvery = 3;
+			SimulatedGpuTimerBackend backend(FREQUENCY, 1);
+			backend.SetDisjointEvery(disjointEvery);
+			GpuProfiler profiler(backend);
+			profiler.Init();
+			const uint32_t frames = 30;
+			for (uint32_t frame = 1; frame <= frames; ++frame) {
+				/* The disjoint frames carry timings that would move the averages if they were used */
+				bool disjoint = frame % disjointEvery == 0;
+				SetFrameTicks(backend, disjoint ? 50000 : 2000, disjoint ? 90000 : 1000);
+				RunFrame(profiler, backend);
+			}
+			/* The last frame is still in flight */
+			uint64_t collected = frames - 1;
+			const GpuPassStats* frame = FindPass(profiler, "Frame");
+			const GpuPassStats* scene = FindPass(profiler, "Scene");
+			return profiler.GetFramesDisjoint() == collected / disjointEvery && profiler.GetFramesRead() == collected - collected / disjointEvery
+				&& frame && scene && frame->samples == profiler.GetFramesRead() && NearlyEqual(frame->gpuMs, 3.1) && NearlyEqual(scene->gpuMs, 2.0);
+		}());
+		return passed;
+	}
+
+	/* A frame with as many passes as the profiler takes, against the simulated backend which costs next to nothing */
+	void RunTimings(int iterations) {
+		static const char* const PASS_NAMES[] = { "Shadows", "Depth", "GBuffer", "Lighting", "Transparent", "Post", "UI", "Present" };
+		const uint32_t framesPerRun = 10000;
+		SimulatedGpuTimerBackend backend(FREQUENCY, 2);
+		GpuProfiler profiler(backend);
+		profiler.Init();
+		double seconds = BestSeconds(iterations, [&] {
+			for (uint32_t frame = 0; frame < framesPerRun; ++frame) {
+				profiler.BeginFrame();
+				for (const char* name : PASS_NAMES) {
+					profiler.BeginPass(name);
+					profiler.EndPass();
+				}
+				profiler.EndFrame();
+				backend.Present();
+			}
+		});
+
+		char report[2048];
+		profiler.FormatReport(report, sizeof(report));
+		printf("\n%s", report);
+		printf("%-40s %10.1f ns\n", "Profiler cost per frame, 8 passes", seconds * 1e9 / framesPerRun);
+	}
+}
+
+int main(int argc, char** argv) {
+	int iterations = argc > 1 ? std::max(1, atoi(argv[1])) : 20;
+	bool passed = RunChecks();
+	RunTimings(iterations);
+	return passed ? 0 : 1;
+}
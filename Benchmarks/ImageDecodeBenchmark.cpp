@@ -0,0 +1,937 @@
+/*
+ * Decode cost of the bundled stb_image per file, the way LoadTextures uses it (forced to 4 channels, HDR as float).
+ * Files are read into memory up front so only decoding is measured. For every image it reports decode throughput,
+ * allocations per decode and the peak heap held by stb_image during the decode, then the aggregate throughput
+ * of the whole corpus decoded on N threads at once.
+ *
+ * Linux:   g++ -std=c++17 -O2 -pthread -ISource Benchmarks/ImageDecodeBenchmark.cpp -o image_decode_benchmark
+ * Windows: cl /std:c++17 /O2 /EHsc /ISource Benchmarks\ImageDecodeBenchmark.cpp
+ *
+ * Usage: image_decode_benchmark [--threads N] [--iterations N] [files or directories...]
+ * Directories are scanned for .png .jpg .jpeg .tga .hdr .bmp .psd .gif files. With no files or directories the corpus
+ * is Textures/ plus images encoded at startup: PNGs at 8 and 16 bits with per row filters, baseline and progressive
+ * 4:2:0 JPEGs, raw and RLE TGAs and RLE HDR, each at 256x256 and 1024x1024. Those are checked to decode back to the
+ * pixels they were encoded from before anything is timed. Real content compresses differently, so pass files of your
+ * own for numbers to act on; name them after what they contain, the file name is what gets printed.
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+	/* Every stb_image allocation goes through these so they can be counted per thread and per decode */
+	struct AllocationHeader {
+		size_t size;
+		size_t padding; // keeps the returned pointer 16 byte aligned on 64 bit, like malloc itself
+	};
+
+	struct AllocationStats {
+		size_t count{ 0 };
+		size_t liveBytes{ 0 };
+		size_t peakBytes{ 0 };
+	};
+
+	thread_local AllocationStats threadAllocations;
+
+	void* CountingMalloc(size_t size) {
+		AllocationHeader* header = static_cast<AllocationHeader*>(malloc(sizeof(AllocationHeader) + size));
+		if (!header)
+			return nullptr;
+		header->size = size;
+		AllocationStats& stats = threadAllocations;
+		++stats.count;
+		stats.liveBytes += size;
+		stats.peakBytes = std::max(stats.peakBytes, stats.liveBytes);
+		return header + 1;
+	}
+
+	void CountingFree(void* p) {
+		if (!p)
+			return;
+		AllocationHeader* header = static_cast<AllocationHeader*>(p) - 1;
+		threadAllocations.liveBytes -= header->size;
+		free(header);
+	}
+
+	void* CountingRealloc(void* p, size_t size) {
+		if (!p)
+			return CountingMalloc(size);
+		AllocationHeader* header = static_cast<AllocationHeader*>(p) - 1;
+		size_t oldSize = header->size;
+		AllocationHeader* resized = static_cast<AllocationHeader*>(realloc(header, sizeof(AllocationHeader) + size));
+		if (!resized)
+			return nullptr;
+		resized->size = size;
+		AllocationStats& stats = threadAllocations;
+		++stats.count;
+		stats.liveBytes = stats.liveBytes - oldSize + size;
+		stats.peakBytes = std::max(stats.peakBytes, stats.liveBytes);
+		return resized + 1;
+	}
+
+} // namespace
+
+#define STBI_MALLOC(size) CountingMalloc(size)
+#define STBI_REALLOC(p, size) CountingRealloc(p, size)
+#define STBI_FREE(p) CountingFree(p)
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+namespace {
+
+	struct CorpusImage {
+		std::string name;
+		std::vector<unsigned char> bytes;
+		int width{ 0 };
+		int height{ 0 };
+		int channels{ 0 };
+		bool is16Bit{ false };
+		bool isHdr{ false };
+	};
+
+	struct DecodeResult {
+		bool ok{ false };
+		size_t outputBytes{ 0 };
+		AllocationStats allocations;
+	};
+
+	bool IsImageFile(const std::filesystem::path& path) {
+		std::string ext = path.extension().string();
+		std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+		const char* known[] = { ".png", ".jpg", ".jpeg", ".tga", ".hdr", ".bmp", ".psd", ".gif" };
+		for (const char* k : known)
+			if (ext == k)
+				return true;
+		return false;
+	}
+
+	bool LoadCorpusImage(const std::filesystem::path& path, CorpusImage& image) {
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		image.name = path.filename().string();
+		image.bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		const stbi_uc* data = image.bytes.data();
+		int length = static_cast<int>(image.bytes.size());
+		if (!stbi_info_from_memory(data, length, &image.width, &image.height, &image.channels))
+			return false;
+		image.is16Bit = stbi_is_16_bit_from_memory(data, length) != 0;
+		image.isHdr = stbi_is_hdr_from_memory(data, length) != 0;
+		return true;
+	}
+
+	/* Same request as LoadTextures: four channels, 8 bit unless the source is HDR */
+	DecodeResult Decode(const CorpusImage& image) {
+		threadAllocations = {};
+		DecodeResult result;
+		int w, h, n;
+		const stbi_uc* data = image.bytes.data();
+		int length = static_cast<int>(image.bytes.size());
+		void* pixels;
+		if (image.isHdr) {
+			pixels = stbi_loadf_from_memory(data, length, &w, &h, &n, 4);
+			result.outputBytes = static_cast<size_t>(w) * h * 4 * sizeof(float);
+		}
+		else {
+			pixels = stbi_load_from_memory(data, length, &w, &h, &n, 4);
+			result.outputBytes = static_cast<size_t>(w) * h * 4;
+		}
+		result.ok = pixels != nullptr;
+		stbi_image_free(pixels);
+		result.allocations = threadAllocations;
+		return result;
+	}
+
+	double Seconds(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	bool Check(const char* name, bool passed) {
+		printf("%-62s %s\n", name, passed ? "ok" : "FAILED");
+		return passed;
+	}
+
+	uint32_t NextRandom(uint32_t& seed) {
+		seed = seed * 1664525u + 1013904223u;
+		return seed;
+	}
+
+	/*
+	 * The synthetic corpus. Smooth gradients, hard edged tiles and a little noise, so PNG filters and LZ matches,
+	 * TGA and HDR runs and JPEG blocks all get some of each. The encoders write what common tools write for these
+	 * formats; they are kept small, not fast, they only run once at startup.
+	 */
+	struct SyntheticImage {
+		CorpusImage image;
+		std::vector<float> expected; // RGBA a decode should give back, 0..1 except for HDR
+		double minPsnr;              // INFINITY for the lossless formats
+	};
+
+	struct SourceImage {
+		int width;
+		int height;
+		std::vector<float> rgba; // 0..1
+	};
+
+	SourceImage MakeSourceImage(int width, int height) {
+		SourceImage source{ width, height, std::vector<float>(static_cast<size_t>(width) * height * 4) };
+		uint32_t seed = 1234567u + width;
+		for (int y = 0; y < height; ++y) {
+			for (int x = 0; x < width; ++x) {
+				float fx = static_cast<float>(x) / width;
+				float fy = static_cast<float>(y) / height;
+				float tile = ((x / 32 + y / 32) & 1) ? 0.7f : 0.2f;
+				float noise = (static_cast<float>(NextRandom(seed) >> 8) / 16777216.f - 0.5f) * 0.04f;
+				float distance = std::sqrt((fx - 0.5f) * (fx - 0.5f) + (fy - 0.5f) * (fy - 0.5f));
+				float* p = &source.rgba[(static_cast<size_t>(y) * width + x) * 4];
+				p[0] = 0.5f + 0.45f * std::sin(x * 0.031f + y * 0.017f) + noise;
+				p[1] = 0.05f + 0.9f * fy + noise;
+				p[2] = tile + 0.2f * fx + noise;
+				p[3] = 1.2f - 2.f * distance;
+				for (int c = 0; c < 4; ++c)
+					p[c] = std::min(1.f, std::max(0.f, p[c]));
+			}
+		}
+		return source;
+	}
+
+	uint8_t To8Bit(float v) { return static_cast<uint8_t>(v * 255.f + 0.5f); }
+	uint16_t To16Bit(float v) { return static_cast<uint16_t>(v * 65535.f + 0.5f); }
+
+	void Append32BigEndian(std::vector<uint8_t>& out, uint32_t v) {
+		for (int shift = 24; shift >= 0; shift -= 8)
+			out.push_back(static_cast<uint8_t>(v >> shift));
+	}
+
+	/* zlib stream of one fixed Huffman block with hash chain matches, the same kind of stream stb_image_write makes */
+	std::vector<uint8_t> Deflate(const std::vector<uint8_t>& data) {
+		static const uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		static const uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		static const uint16_t DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+			4097, 6145, 8193, 12289, 16385, 24577 };
+		static const uint8_t DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+		std::vector<uint8_t> out{ 0x78, 0x01 };
+		uint32_t bitBuffer = 0;
+		int bitCount = 0;
+		auto putBits = [&](uint32_t bits, int count) {
+			bitBuffer |= bits << bitCount;
+			bitCount += count;
+			for (; bitCount >= 8; bitCount -= 8, bitBuffer >>= 8)
+				out.push_back(static_cast<uint8_t>(bitBuffer));
+		};
+		/* Huffman codes go out most significant bit first, everything else least significant bit first */
+		auto putCode = [&](uint32_t code, int length) {
+			uint32_t reversed = 0;
+			for (int i = 0; i < length; ++i)
+				reversed |= ((code >> i) & 1) << (length - 1 - i);
+			putBits(reversed, length);
+		};
+		auto putSymbol = [&](uint32_t symbol) {
+			if (symbol <= 143)
+				putCode(0x30 + symbol, 8);
+			else if (symbol <= 255)
+				putCode(0x190 + symbol - 144, 9);
+			else if (symbol <= 279)
+				putCode(symbol - 256, 7);
+			else
+				putCode(0xC0 + symbol - 280, 8);
+		};
+
+		const int HASH_BITS = 15;
+		const size_t WINDOW = 32768;
+		const size_t size = data.size();
+		std::vector<int32_t> head(size_t(1) << HASH_BITS, -1), previous(size, -1);
+		auto hash = [&](size_t i) { return ((data[i] << 16 | data[i + 1] << 8 | data[i + 2]) * 2654435761u) >> (32 - HASH_BITS); };
+		auto insert = [&](size_t i) {
+			if (i + 2 < size) {
+				uint32_t h = hash(i);
+				previous[i] = head[h];
+				head[h] = static_cast<int32_t>(i);
+			}
+		};
+
+		putBits(1, 1); // last block
+		putBits(1, 2); // fixed Huffman codes
+		for (size_t i = 0; i < size;) {
+			size_t bestLength = 0, bestDistance = 0;
+			if (i + 2 < size) {
+				size_t maxLength = std::min<size_t>(258, size - i);
+				int chain = 32;
+				for (int32_t j = head[hash(i)]; j >= 0 && i - j <= WINDOW && chain-- > 0; j = previous[j]) {
+					size_t length = 0;
+					while (length < maxLength && data[j + length] == data[i + length])
+						++length;
+					if (length > bestLength) {
+						bestLength = length;
+						bestDistance = i - j;
+					}
+				}
+			}
+			if (bestLength < 3) {
+				putSymbol(data[i]);
+				insert(i++);
+				continue;
+			}
+			int lengthCode = 0;
+			while (lengthCode < 28 && LENGTH_BASE[lengthCode + 1] <= bestLength)
+				++lengthCode;
+			putSymbol(257 + lengthCode);
+			putBits(static_cast<uint32_t>(bestLength - LENGTH_BASE[lengthCode]), LENGTH_EXTRA[lengthCode]);
+			int distanceCode = 0;
+			while (distanceCode < 29 && DISTANCE_BASE[distanceCode + 1] <= bestDistance)
+				++distanceCode;
+			putCode(distanceCode, 5);
+			putBits(static_cast<uint32_t>(bestDistance - DISTANCE_BASE[distanceCode]), DISTANCE_EXTRA[distanceCode]);
+			for (size_t end = i + bestLength; i < end; ++i)
+				insert(i);
+		}
+		putSymbol(256);
+		if (bitCount > 0)
+			putBits(0, 8 - bitCount);
+
+		uint32_t a = 1, b = 0;
+		for (uint8_t v : data) {
+			a = (a + v) % 65521;
+			b = (b + a) % 65521;
+		}
+		Append32BigEndian(out, b << 16 | a);
+		return out;
+	}
+
+	uint32_t Crc32(const uint8_t* data, size_t size) {
+		static uint32_t table[256];
+		if (!table[1]) {
+			for (uint32_t i = 0; i < 256; ++i) {
+				uint32_t c = i;
+				for (int k = 0; k < 8; ++k)
+					c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				table[i] = c;
+			}
+		}
+		uint32_t crc = 0xFFFFFFFFu;
+		for (size_t i = 0; i < size; ++i)
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return crc ^ 0xFFFFFFFFu;
+	}
+
+	void AppendPngChunk(std::vector<uint8_t>& png, const char* type, const std::vector<uint8_t>& data) {
+		Append32BigEndian(png, static_cast<uint32_t>(data.size()));
+		size_t start = png.size();
+		png.insert(png.end(), type, type + 4);
+		png.insert(png.end(), data.begin(), data.end());
+		Append32BigEndian(png, Crc32(&png[start], png.size() - start));
+	}
+
+	/* Each row gets the filter with the smallest sum of absolute differences, the usual heuristic, so all five show up */
+	std::vector<uint8_t> EncodePng(int width, int height, int channels, int bitDepth, const std::vector<uint8_t>& samples) {
+		const size_t pixelBytes = static_cast<size_t>(channels) * bitDepth / 8;
+		const size_t rowBytes = pixelBytes * width;
+		std::vector<uint8_t> filtered, candidate(rowBytes), best(rowBytes);
+		filtered.reserve((rowBytes + 1) * height);
+		for (int y = 0; y < height; ++y) {
+			const uint8_t* row = &samples[y * rowBytes];
+			const uint8_t* prior = y > 0 ? row - rowBytes : nullptr;
+			int bestFilter = 0;
+			uint64_t bestCost = UINT64_MAX;
+			for (int filter = 0; filter < 5; ++filter) {
+				uint64_t cost = 0;
+				for (size_t x = 0; x < rowBytes; ++x) {
+					int a = x >= pixelBytes ? row[x - pixelBytes] : 0;
+					int b = prior ? prior[x] : 0;
+					int c = prior && x >= pixelBytes ? prior[x - pixelBytes] : 0;
+					int predicted = 0;
+					switch (filter) {
+					case 1: predicted = a; break;
+					case 2: predicted = b; break;
+					case 3: predicted = (a + b) / 2; break;
+					case 4: {
+						int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+						predicted = pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+						break;
+					}
+					}
+					candidate[x] = static_cast<uint8_t>(row[x] - predicted);
+					cost += abs(static_cast<int8_t>(candidate[x]));
+				}
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestFilter = filter;
+					best.swap(candidate);
+				}
+			}
+			filtered.push_back(static_cast<uint8_t>(bestFilter));
+			filtered.insert(filtered.end(), best.begin(), best.end());
+		}
+
+		std::vector<uint8_t> png{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		std::vector<uint8_t> header;
+		Append32BigEndian(header, width);
+		Append32BigEndian(header, height);
+		header.insert(header.end(), { static_cast<uint8_t>(bitDepth), static_cast<uint8_t>(channels == 4 ? 6 : 2), 0, 0, 0 });
+		AppendPngChunk(png, "IHDR", header);
+		AppendPngChunk(png, "IDAT", Deflate(filtered));
+		AppendPngChunk(png, "IEND", {});
+		return png;
+	}
+
+	/* BGR(A), bottom row first, RLE packets never cross a row, like stb_image_write and most paint programs */
+	std::vector<uint8_t> EncodeTga(int width, int height, int channels, const std::vector<uint8_t>& samples, bool rle) {
+		std::vector<uint8_t> tga(18, 0);
+		tga[2] = rle ? 10 : 2;
+		tga[12] = static_cast<uint8_t>(width);
+		tga[13] = static_cast<uint8_t>(width >> 8);
+		tga[14] = static_cast<uint8_t>(height);
+		tga[15] = static_cast<uint8_t>(height >> 8);
+		tga[16] = static_cast<uint8_t>(channels * 8);
+		tga[17] = channels == 4 ? 8 : 0;
+		auto pixel = [&](int x, int y) { return &samples[(static_cast<size_t>(y) * width + x) * channels]; };
+		auto append = [&](const uint8_t* p) {
+			tga.insert(tga.end(), { p[2], p[1], p[0] });
+			if (channels == 4)
+				tga.push_back(p[3]);
+		};
+		auto same = [&](int x0, int x1, int y) { return !memcmp(pixel(x0, y), pixel(x1, y), channels); };
+		for (int y = height - 1; y >= 0; --y) {
+			for (int x = 0; x < width;) {
+				if (!rle) {
+					append(pixel(x++, y));
+					continue;
+				}
+				int run = 1;
+				while (x + run < width && run < 128 && same(x, x + run, y))
+					++run;
+				if (run >= 2) {
+					tga.push_back(static_cast<uint8_t>(0x80 | (run - 1)));
+					append(pixel(x, y));
+					x += run;
+					continue;
+				}
+				int literal = 1;
+				while (x + literal < width && literal < 128 && !(x + literal + 1 < width && same(x + literal, x + literal + 1, y)))
+					++literal;
+				tga.push_back(static_cast<uint8_t>(literal - 1));
+				for (int end = x + literal; x < end; ++x)
+					append(pixel(x, y));
+			}
+		}
+		return tga;
+	}
+
+	/* Radiance RGBE with every scanline in the RLE form, the one stb_image_write and most HDR tools write */
+	std::vector<uint8_t> EncodeHdr(int width, int height, const std::vector<float>& rgb) {
+		char header[128];
+		int headerLength = snprintf(header, sizeof(header), "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y %d +X %d\n", height, width);
+		std::vector<uint8_t> hdr(header, header + headerLength);
+		std::vector<uint8_t> planes[4];
+		for (std::vector<uint8_t>& plane : planes)
+			plane.resize(width);
+		for (int y = 0; y < height; ++y) {
+			for (int x = 0; x < width; ++x) {
+				const float* p = &rgb[(static_cast<size_t>(y) * width + x) * 3];
+				float largest = std::max(p[0], std::max(p[1], p[2]));
+				int exponent = 0;
+				float scale = largest < 1e-32f ? 0.f : std::frexp(largest, &exponent) * 256.f / largest;
+				for (int c = 0; c < 3; ++c)
+					planes[c][x] = static_cast<uint8_t>(p[c] * scale);
+				planes[3][x] = largest < 1e-32f ? 0 : static_cast<uint8_t>(exponent + 128);
+			}
+			hdr.insert(hdr.end(), { 2, 2, static_cast<uint8_t>(width >> 8), static_cast<uint8_t>(width) });
+			for (const std::vector<uint8_t>& plane : planes) {
+				for (int x = 0; x < width;) {
+					int run = 1;
+					while (x + run < width && run < 127 && plane[x + run] == plane[x])
+						++run;
+					if (run >= 3) {
+						hdr.insert(hdr.end(), { static_cast<uint8_t>(128 + run), plane[x] });
+						x += run;
+						continue;
+					}
+					int literal = 1;
+					while (x + literal < width && literal < 128
+						&& !(x + literal + 2 < width && plane[x + literal] == plane[x + literal + 1] && plane[x + literal] == plane[x + literal + 2]))
+						++literal;
+					hdr.push_back(static_cast<uint8_t>(literal));
+					hdr.insert(hdr.end(), plane.begin() + x, plane.begin() + x + literal);
+					x += literal;
+				}
+			}
+		}
+		return hdr;
+	}
+
+	/* JPEG with the example tables from Annex K of the standard, which is what most encoders use unless told otherwise */
+	const uint8_t ZIGZAG[64] = { 0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5, 12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+		35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63 };
+	const uint8_t LUMINANCE_QUANT[64] = { 16, 11, 10, 16, 24, 40, 51, 61, 12, 12, 14, 19, 26, 58, 60, 55, 14, 13, 16, 24, 40, 57, 69, 56,
+		14, 17, 22, 29, 51, 87, 80, 62, 18, 22, 37, 56, 68, 109, 103, 77, 24, 35, 55, 64, 81, 104, 113, 92,
+		49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99 };
+	const uint8_t CHROMINANCE_QUANT[64] = { 17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99, 24, 26, 56, 99, 99, 99, 99, 99,
+		47, 66, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+		99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99 };
+	const uint8_t DC_LUMINANCE_BITS[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+	const uint8_t DC_CHROMINANCE_BITS[16] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+	const uint8_t DC_VALUES[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+	const uint8_t AC_LUMINANCE_BITS[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7D };
+	const uint8_t AC_LUMINANCE_VALUES[162] = {
+		0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xA1, 0x08,
+		0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0, 0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0A, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28,
+		0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+		0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+		0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6,
+		0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2,
+		0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA };
+	const uint8_t AC_CHROMINANCE_BITS[16] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+	const uint8_t AC_CHROMINANCE_VALUES[162] = {
+		0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91,
+		0xA1, 0xB1, 0xC1, 0x09, 0x23, 0x33, 0x52, 0xF0, 0x15, 0x62, 0x72, 0xD1, 0x0A, 0x16, 0x24, 0x34, 0xE1, 0x25, 0xF1, 0x17, 0x18, 0x19, 0x1A, 0x26,
+		0x27, 0x28, 0x29, 0x2A, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58,
+		0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+		0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4,
+		0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA,
+		0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA };
+
+	struct HuffmanTable {
+		const uint8_t* bits;
+		const uint8_t* values;
+		uint16_t code[256];
+		uint8_t length[256];
+	};
+
+	HuffmanTable MakeHuffmanTable(const uint8_t* bits, const uint8_t* values) {
+		HuffmanTable table{ bits, values, {}, {} };
+		uint16_t code = 0;
+		for (int length = 1, k = 0; length <= 16; ++length, code <<= 1) {
+			for (int i = 0; i < bits[length - 1]; ++i, ++k, ++code) {
+				table.code[values[k]] = code;
+				table.length[values[k]] = static_cast<uint8_t>(length);
+			}
+		}
+		return table;
+	}
+
+	struct JpegComponent {
+		int blocksX;
+		int blocksY;
+		std::vector<int16_t> coefficients; // 64 per block, zigzag order
+		const HuffmanTable* dc;
+		const HuffmanTable* ac;
+		int predictor;
+	};
+
+	/* Entropy coded data, most significant bit first with a zero stuffed after every 0xFF */
+	struct JpegBitWriter {
+		std::vector<uint8_t>& out;
+		uint32_t buffer = 0;
+		int count = 0;
+
+		void Put(uint32_t bits, int length) {
+			buffer = buffer << length | (bits & ((1u << length) - 1));
+			count += length;
+			for (; count >= 8; count -= 8) {
+				uint8_t byte = static_cast<uint8_t>(buffer >> (count - 8));
+				out.push_back(byte);
+				if (byte == 0xFF)
+					out.push_back(0);
+			}
+		}
+
+		void PutValue(const HuffmanTable& table, int symbol, int value, int size) {
+			Put(table.code[symbol], table.length[symbol]);
+			if (size > 0)
+				Put(value < 0 ? value - 1 : value, size);
+		}
+
+		void Flush() {
+			if (count > 0)
+				Put(0x7F, 8 - count);
+		}
+	};
+
+	int MagnitudeSize(int value) {
+		int size = 0;
+		for (int magnitude = abs(value); magnitude; magnitude >>= 1)
+			++size;
+		return size;
+	}
+
+	void EncodeDc(JpegBitWriter& writer, JpegComponent& component, int block) {
+		int dc = component.coefficients[block * 64];
+		int difference = dc - component.predictor;
+		component.predictor = dc;
+		int size = MagnitudeSize(difference);
+		writer.PutValue(*component.dc, size, difference, size);
+	}
+
+	/* Coefficients first to last of one block, a progressive scan only ever ends its band with EOB, never an EOB run */
+	void EncodeAc(JpegBitWriter& writer, const JpegComponent& component, int block, int first, int last) {
+		const int16_t* coefficients = &component.coefficients[block * 64];
+		int run = 0;
+		for (int k = first; k <= last; ++k) {
+			if (!coefficients[k]) {
+				++run;
+				continue;
+			}
+			for (; run > 15; run -= 16)
+				writer.PutValue(*component.ac, 0xF0, 0, 0);
+			int size = MagnitudeSize(coefficients[k]);
+			writer.PutValue(*component.ac, run << 4 | size, coefficients[k], size);
+			run = 0;
+		}
+		if (run > 0)
+			writer.PutValue(*component.ac, 0x00, 0, 0);
+	}
+
+	/* Y in 2x2 blocks then Cb and Cr, the MCU order of a 4:2:0 interleaved scan */
+	template<typename EncodeBlock>
+	void ForEachMcuBlock(JpegComponent (&components)[3], EncodeBlock encode) {
+		for (int my = 0; my < components[1].blocksY; ++my) {
+			for (int mx = 0; mx < components[1].blocksX; ++mx) {
+				for (int by = 0; by < 2; ++by)
+					for (int bx = 0; bx < 2; ++bx)
+						encode(components[0], (my * 2 + by) * components[0].blocksX + mx * 2 + bx);
+				encode(components[1], my * components[1].blocksX + mx);
+				encode(components[2], my * components[2].blocksX + mx);
+			}
+		}
+	}
+
+	void AppendMarker(std::vector<uint8_t>& jpeg, uint8_t marker, std::initializer_list<uint8_t> payload) {
+		size_t length = payload.size() + 2;
+		jpeg.insert(jpeg.end(), { 0xFF, marker, static_cast<uint8_t>(length >> 8), static_cast<uint8_t>(length) });
+		jpeg.insert(jpeg.end(), payload);
+	}
+
+	/* 4:2:0 at quality 90; a progressive file sends all DC first, then low and high luma AC bands, then the chroma AC */
+	std::vector<uint8_t> EncodeJpeg(int width, int height, const std::vector<uint8_t>& rgb, bool progressive) {
+		const int quality = 90;
+		uint8_t quant[2][64];
+		for (int i = 0; i < 64; ++i) {
+			quant[0][i] = static_cast<uint8_t>(std::min(255, std::max(1, (LUMINANCE_QUANT[i] * (200 - 2 * quality) + 50) / 100)));
+			quant[1][i] = static_cast<uint8_t>(std::min(255, std::max(1, (CHROMINANCE_QUANT[i] * (200 - 2 * quality) + 50) / 100)));
+		}
+		static const HuffmanTable dcTables[2] = { MakeHuffmanTable(DC_LUMINANCE_BITS, DC_VALUES), MakeHuffmanTable(DC_CHROMINANCE_BITS, DC_VALUES) };
+		static const HuffmanTable acTables[2] = { MakeHuffmanTable(AC_LUMINANCE_BITS, AC_LUMINANCE_VALUES),
+			MakeHuffmanTable(AC_CHROMINANCE_BITS, AC_CHROMINANCE_VALUES) };
+
+		/* Full resolution Y, Cb and Cr averaged over 2x2 pixels */
+		std::vector<float> planes[3];
+		planes[0].resize(static_cast<size_t>(width) * height);
+		planes[1].assign(static_cast<size_t>(width / 2) * (height / 2), 0.f);
+		planes[2].assign(planes[1].size(), 0.f);
+		for (int y = 0; y < height; ++y) {
+			for (int x = 0; x < width; ++x) {
+				const uint8_t* p = &rgb[(static_cast<size_t>(y) * width + x) * 3];
+				size_t half = static_cast<size_t>(y / 2) * (width / 2) + x / 2;
+				planes[0][static_cast<size_t>(y) * width + x] = 0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2];
+				planes[1][half] += 0.25f * (-0.168736f * p[0] - 0.331264f * p[1] + 0.5f * p[2] + 128.f);
+				planes[2][half] += 0.25f * (0.5f * p[0] - 0.418688f * p[1] - 0.081312f * p[2] + 128.f);
+			}
+		}
+
+		float basis[8][8];
+		for (int u = 0; u < 8; ++u)
+			for (int x = 0; x < 8; ++x)
+				basis[u][x] = (u ? 0.5f : 0.5f / std::sqrt(2.f)) * std::cos((2 * x + 1) * u * 3.14159265f / 16.f);
+
+		JpegComponent components[3];
+		for (int c = 0; c < 3; ++c) {
+			int planeWidth = c ? width / 2 : width;
+			JpegComponent& component = components[c];
+			component = { planeWidth / 8, (c ? height / 2 : height) / 8, {}, &dcTables[c ? 1 : 0], &acTables[c ? 1 : 0], 0 };
+			component.coefficients.resize(static_cast<size_t>(component.blocksX) * component.blocksY * 64);
+			for (int block = 0; block < component.blocksX * component.blocksY; ++block) {
+				const float* samples = &planes[c][static_cast<size_t>(block / component.blocksX) * 8 * planeWidth + (block % component.blocksX) * 8];
+				float rows[8][8], coefficients[8][8];
+				for (int y = 0; y < 8; ++y)
+					for (int u = 0; u < 8; ++u) {
+						rows[y][u] = 0.f;
+						for (int x = 0; x < 8; ++x)
+							rows[y][u] += basis[u][x] * (samples[y * planeWidth + x] - 128.f);
+					}
+				for (int v = 0; v < 8; ++v)
+					for (int u = 0; u < 8; ++u) {
+						coefficients[v][u] = 0.f;
+						for (int y = 0; y < 8; ++y)
+							coefficients[v][u] += basis[v][y] * rows[y][u];
+					}
+				for (int k = 0; k < 64; ++k) {
+					int natural = ZIGZAG[k];
+					component.coefficients[block * 64 + k] = static_cast<int16_t>(std::lround(coefficients[natural / 8][natural % 8] / quant[c ? 1 : 0][natural]));
+				}
+			}
+		}
+
+		std::vector<uint8_t> jpeg{ 0xFF, 0xD8 };
+		AppendMarker(jpeg, 0xE0, { 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0 });
+		for (uint8_t table = 0; table < 2; ++table) {
+			jpeg.insert(jpeg.end(), { 0xFF, 0xDB, 0, 67, table });
+			for (int k = 0; k < 64; ++k)
+				jpeg.push_back(quant[table][ZIGZAG[k]]);
+		}
+		AppendMarker(jpeg, progressive ? 0xC2 : 0xC0, { 8, static_cast<uint8_t>(height >> 8), static_cast<uint8_t>(height),
+			static_cast<uint8_t>(width >> 8), static_cast<uint8_t>(width), 3, 1, 0x22, 0, 2, 0x11, 1, 3, 0x11, 1 });
+		for (uint8_t table = 0; table < 4; ++table) {
+			const HuffmanTable& huffman = table & 2 ? acTables[table & 1] : dcTables[table & 1];
+			int valueCount = 0;
+			for (int i = 0; i < 16; ++i)
+				valueCount += huffman.bits[i];
+			size_t length = 3 + 16 + valueCount;
+			jpeg.insert(jpeg.end(), { 0xFF, 0xC4, static_cast<uint8_t>(length >> 8), static_cast<uint8_t>(length), static_cast<uint8_t>((table & 2) << 3 | (table & 1)) });
+			jpeg.insert(jpeg.end(), huffman.bits, huffman.bits + 16);
+			jpeg.insert(jpeg.end(), huffman.values, huffman.values + valueCount);
+		}
+
+		if (!progressive) {
+			AppendMarker(jpeg, 0xDA, { 3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0 });
+			JpegBitWriter writer{ jpeg };
+			ForEachMcuBlock(components, [&](JpegComponent& component, int block) {
+				EncodeDc(writer, component, block);
+				EncodeAc(writer, component, block, 1, 63);
+			});
+			writer.Flush();
+		}
+		else {
+			AppendMarker(jpeg, 0xDA, { 3, 1, 0x00, 2, 0x10, 3, 0x10, 0, 0, 0 });
+			JpegBitWriter writer{ jpeg };
+			ForEachMcuBlock(components, [&](JpegComponent& component, int block) { EncodeDc(writer, component, block); });
+			writer.Flush();
+			const struct { uint8_t component, first, last; } bands[] = { { 0, 1, 5 }, { 0, 6, 63 }, { 1, 1, 63 }, { 2, 1, 63 } };
+			for (const auto& band : bands) {
+				uint8_t table = band.component ? 0x01 : 0x00;
+				AppendMarker(jpeg, 0xDA, { 1, static_cast<uint8_t>(band.component + 1), table, band.first, band.last, 0 });
+				JpegBitWriter bandWriter{ jpeg };
+				const JpegComponent& component = components[band.component];
+				for (int block = 0; block < component.blocksX * component.blocksY; ++block)
+					EncodeAc(bandWriter, component, block, band.first, band.last);
+				bandWriter.Flush();
+			}
+		}
+		jpeg.insert(jpeg.end(), { 0xFF, 0xD9 });
+		return jpeg;
+	}
+
+	/* Every format at a small and a large size; width and height are multiples of 16 for the 4:2:0 JPEGs */
+	std::vector<SyntheticImage> MakeSyntheticCorpus() {
+		std::vector<SyntheticImage> corpus;
+		for (int size : { 256, 1024 }) {
+			SourceImage source = MakeSourceImage(size, size);
+			const size_t pixelCount = static_cast<size_t>(size) * size;
+			std::vector<uint8_t> rgb8(pixelCount * 3), rgba8(pixelCount * 4), rgb16(pixelCount * 6), rgba16(pixelCount * 8);
+			std::vector<float> hdr(pixelCount * 3);
+			for (size_t i = 0; i < pixelCount; ++i) {
+				for (int c = 0; c < 4; ++c) {
+					float v = source.rgba[i * 4 + c];
+					rgba8[i * 4 + c] = To8Bit(v);
+					rgba16[i * 8 + c * 2] = static_cast<uint8_t>(To16Bit(v) >> 8);
+					rgba16[i * 8 + c * 2 + 1] = static_cast<uint8_t>(To16Bit(v));
+					if (c < 3) {
+						rgb8[i * 3 + c] = To8Bit(v);
+						rgb16[i * 6 + c * 2] = rgba16[i * 8 + c * 2];
+						rgb16[i * 6 + c * 2 + 1] = rgba16[i * 8 + c * 2 + 1];
+						/* Spread over a range HDR is for, from deep shadow to a few hundred times white */
+						hdr[i * 3 + c] = v * std::exp2(12.f * source.rgba[i * 4] - 4.f);
+					}
+				}
+			}
+
+			/* What each decode to 8 bit RGBA should give back: opaque without alpha, the top byte of 16 bit samples */
+			auto expected8 = [&](bool alpha) {
+				std::vector<float> expected(pixelCount * 4);
+				for (size_t i = 0; i < pixelCount; ++i)
+					for (int c = 0; c < 4; ++c)
+						expected[i * 4 + c] = c < 3 || alpha ? rgba8[i * 4 + c] / 255.f : 1.f;
+				return expected;
+			};
+			auto expected16 = [&](bool alpha) {
+				std::vector<float> expected(pixelCount * 4);
+				for (size_t i = 0; i < pixelCount; ++i)
+					for (int c = 0; c < 4; ++c)
+						expected[i * 4 + c] = c < 3 || alpha ? rgba16[i * 8 + c * 2] / 255.f : 1.f;
+				return expected;
+			};
+			std::vector<float> expectedHdr(pixelCount * 4, 1.f);
+			for (size_t i = 0; i < pixelCount; ++i)
+				for (int c = 0; c < 3; ++c)
+					expectedHdr[i * 4 + c] = hdr[i * 3 + c];
+
+			auto add = [&](const char* name, std::vector<uint8_t> bytes, std::vector<float> expected, double minPsnr) {
+				SyntheticImage synthetic;
+				synthetic.image.name = std::string("synthetic ") + name;
+				synthetic.image.bytes = std::move(bytes);
+				synthetic.expected = std::move(expected);
+				synthetic.minPsnr = minPsnr;
+				const stbi_uc* data = synthetic.image.bytes.data();
+				int length = static_cast<int>(synthetic.image.bytes.size());
+				stbi_info_from_memory(data, length, &synthetic.image.width, &synthetic.image.height, &synthetic.image.channels);
+				synthetic.image.is16Bit = stbi_is_16_bit_from_memory(data, length) != 0;
+				synthetic.image.isHdr = stbi_is_hdr_from_memory(data, length) != 0;
+				corpus.push_back(std::move(synthetic));
+			};
+			add("png 8-bit rgb", EncodePng(size, size, 3, 8, rgb8), expected8(false), INFINITY);
+			add("png 8-bit rgba", EncodePng(size, size, 4, 8, rgba8), expected8(true), INFINITY);
+			add("png 16-bit rgb", EncodePng(size, size, 3, 16, rgb16), expected16(false), INFINITY);
+			add("png 16-bit rgba", EncodePng(size, size, 4, 16, rgba16), expected16(true), INFINITY);
+			add("jpeg baseline 4:2:0", EncodeJpeg(size, size, rgb8, false), expected8(false), 30.0);
+			add("jpeg progressive 4:2:0", EncodeJpeg(size, size, rgb8, true), expected8(false), 30.0);
+			add("tga rgb", EncodeTga(size, size, 3, rgb8, false), expected8(false), INFINITY);
+			add("tga rgba rle", EncodeTga(size, size, 4, rgba8, true), expected8(true), INFINITY);
+			add("hdr rle", EncodeHdr(size, size, hdr), std::move(expectedHdr), 55.0);
+		}
+		return corpus;
+	}
+
+	/* Peak signal to noise ratio of a decode against what was encoded, the peak being the brightest expected value */
+	double DecodedPsnr(const SyntheticImage& synthetic) {
+		const CorpusImage& image = synthetic.image;
+		int w, h, n;
+		std::vector<float> decoded(synthetic.expected.size());
+		if (image.isHdr) {
+			float* pixels = stbi_loadf_from_memory(image.bytes.data(), static_cast<int>(image.bytes.size()), &w, &h, &n, 4);
+			if (!pixels)
+				return 0.0;
+			std::copy(pixels, pixels + decoded.size(), decoded.begin());
+			stbi_image_free(pixels);
+		}
+		else {
+			stbi_uc* pixels = stbi_load_from_memory(image.bytes.data(), static_cast<int>(image.bytes.size()), &w, &h, &n, 4);
+			if (!pixels)
+				return 0.0;
+			for (size_t i = 0; i < decoded.size(); ++i)
+				decoded[i] = pixels[i] / 255.f;
+			stbi_image_free(pixels);
+		}
+		double squaredError = 0.0, peak = 0.0;
+		for (size_t i = 0; i < decoded.size(); ++i) {
+			double difference = static_cast<double>(decoded[i]) - synthetic.expected[i];
+			squaredError += difference * difference;
+			peak = std::max(peak, static_cast<double>(synthetic.expected[i]));
+		}
+		if (squaredError == 0.0)
+			return INFINITY;
+		return 10.0 * std::log10(peak * peak / (squaredError / decoded.size()));
+	}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+	int iterations = 5;
+	std::vector<std::filesystem::path> inputs;
+	for (int i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+			threadCount = std::max(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--iterations") && i + 1 < argc)
+			iterations = std::max(1, atoi(argv[++i]));
+		else
+			inputs.emplace_back(argv[i]);
+	}
+	bool synthetic = inputs.empty();
+	if (synthetic)
+		inputs.emplace_back("Textures");
+
+	std::vector<std::filesystem::path> files;
+	for (const auto& input : inputs) {
+		std::error_code error;
+		if (std::filesystem::is_directory(input, error)) {
+			for (const auto& entry : std::filesystem::recursive_directory_iterator(input, error))
+				if (entry.is_regular_file() && IsImageFile(entry.path()))
+					files.push_back(entry.path());
+		}
+		else {
+			files.push_back(input);
+		}
+	}
+	std::sort(files.begin(), files.end());
+
+	bool passed = true;
+	std::vector<CorpusImage> corpus;
+	if (synthetic) {
+		std::vector<SyntheticImage> syntheticCorpus = MakeSyntheticCorpus();
+		for (SyntheticImage& image : syntheticCorpus) {
+			char name[96];
+			snprintf(name, sizeof(name), "%s %dx%d decodes back", image.image.name.c_str(), image.image.width, image.image.height);
+			passed &= Check(name, DecodedPsnr(image) >= image.minPsnr);
+			corpus.push_back(std::move(image.image));
+		}
+		printf("\n");
+	}
+	for (const auto& path : files) {
+		CorpusImage image;
+		if (LoadCorpusImage(path, image))
+			corpus.push_back(std::move(image));
+		else
+			fprintf(stderr, "skipping %s: %s\n", path.string().c_str(), stbi_failure_reason() ? stbi_failure_reason() : "unreadable");
+	}
+	if (corpus.empty()) {
+		fprintf(stderr, "no decodable images found\n");
+		return 1;
+	}
+
+	printf("Single thread, best of %d\n", iterations);
+	printf("%-32s %11s %6s %9s %10s %10s %7s %10s\n", "image", "size", "bits", "file KB", "MB/s out", "MB/s in", "allocs", "peak KB");
+	size_t totalInputBytes = 0, totalOutputBytes = 0;
+	for (const CorpusImage& image : corpus) {
+		double best = 1e30;
+		DecodeResult result;
+		for (int i = 0; i < iterations; ++i) {
+			auto start = std::chrono::steady_clock::now();
+			result = Decode(image);
+			best = std::min(best, Seconds(start));
+		}
+		if (!result.ok) {
+			printf("%-32s decode failed: %s\n", image.name.c_str(), stbi_failure_reason());
+			continue;
+		}
+		char size[32];
+		snprintf(size, sizeof(size), "%dx%d", image.width, image.height);
+		printf("%-32s %11s %6s %9.1f %10.1f %10.1f %7zu %10.1f\n",
+			image.name.c_str(), size, image.isHdr ? "hdr" : image.is16Bit ? "16" : "8",
+			image.bytes.size() / 1024.0,
+			result.outputBytes / best / (1024.0 * 1024.0),
+			image.bytes.size() / best / (1024.0 * 1024.0),
+			result.allocations.count,
+			result.allocations.peakBytes / 1024.0);
+		totalInputBytes += image.bytes.size();
+		totalOutputBytes += result.outputBytes;
+	}
+
+	/* Every thread decodes the whole corpus, starting at a different image so they do not run in lockstep */
+	std::atomic<bool> go{ false };
+	std::atomic<size_t> failures{ 0 };
+	std::vector<std::thread> threads;
+	for (unsigned t = 0; t < threadCount; ++t) {
+		threads.emplace_back([&, t] {
+			while (!go.load(std::memory_order_acquire))
+				std::this_thread::yield();
+			for (int i = 0; i < iterations; ++i)
+				for (size_t j = 0; j < corpus.size(); ++j)
+					if (!Decode(corpus[(j + t) % corpus.size()]).ok)
+						failures.fetch_add(1, std::memory_order_relaxed);
+		});
+	}
+	auto start = std::chrono::steady_clock::now();
+	go.store(true, std::memory_order_release);
+	for (std::thread& thread : threads)
+		thread.join();
+	double elapsed = Seconds(start);
+
+	double scale = static_cast<double>(threadCount) * iterations / elapsed / (1024.0 * 1024.0);
+	printf("\n%u threads x %d passes over %zu images: %.1f MB/s out, %.1f MB/s in, %.1f images/s%s\n",
+		threadCount, iterations, corpus.size(),
+		totalOutputBytes * scale, totalInputBytes * scale,
+		static_cast<double>(corpus.size()) * threadCount * iterations / elapsed,
+		failures.load() ? " (some decodes failed)" : "");
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,169 @@
+/*
+ * Scheduling cost and scaling of Source/JobSystem.cpp. Reports the cost per job for empty jobs submitted from one
+ * thread and from every worker at once, the per-hop latency of a dependency chain, and WriteObjectTransforms at
+ * frame sizes on one thread, on threads started per call (what it did before the job system) and as jobs. An
+ * unbalanced ParallelFor, where the cost per item grows along the range, shows what stealing recovers.
+ *
+ * Linux:   g++ -std=c++17 -O2 -pthread -ISource Benchmarks/JobSystemBenchmark.cpp Source/JobSystem.cpp Source/TransformBuffer.cpp -o job_system_benchmark
+ * Windows: cl /std:c++17 /O2 /EHsc /ISource Benchmarks\JobSystemBenchmark.cpp Source\JobSystem.cpp Source\TransformBuffer.cpp
+ *
+ * Usage: job_system_benchmark [--workers N] [--iterations N], by default one worker per hardware thread but one
+ * Pin the run to a fixed set of cores (taskset) and disable frequency scaling when comparing results across machines.
+ */
+#include "JobSystem.h"
+#include "TransformBuffer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+
+using namespace awesome;
+
+namespace {
+
+	double BestSeconds(int iterations, const std::function<void()>& kernel) {
+		double best = 1e30;
+		for (int i = 0; i < iterations; ++i) {
+			auto start = std::chrono::steady_clock::now();
+			kernel();
+			best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	}
+
+	/* The conversion WriteObjectTransforms did before the job system, one thread started per range on every call */
+	void WriteWithThreads(float3x4* dst, const float4x4* models, uint32_t count, uint32_t maxThreads) {
+		uint32_t threadCount = std::max(1u, std::min(maxThreads, count / 4096));
+		uint32_t perThread = (count + threadCount - 1) / threadCount;
+		auto writeRange = [dst, models](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; ++i)
+				dst[i] = toFloat3x4(models[i]);
+		};
+		std::vector<std::thread> threads;
+		for (uint32_t t = 1; t < threadCount; ++t) {
+			uint32_t begin = std::min(count, t * perThread);
+			threads.emplace_back(writeRange, begin, std::min(count, begin + perThread));
+		}
+		writeRange(0, std::min(count, perThread));
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+
+	/* Busy work the compiler cannot remove, roughly proportional to units */
+	float Spin(uint32_t units) {
+		float value = 1.0f;
+		for (uint32_t i = 0; i < units; ++i)
+			value = std::sqrt(value + static_cast<float>(i));
+		return value;
+	}
+
+	void EmptyJobs(JobSystem& jobSystem, int iterations) {
+		constexpr uint32_t JOB_COUNT = 100000;
+		double single = BestSeconds(iterations, [&] {
+			JobCounter counter;
+			for (uint32_t i = 0; i < JOB_COUNT; ++i)
+				jobSystem.Submit([] {}, &counter);
+			jobSystem.Wait(counter);
+		});
+		/* Every thread submits a share from its own deque, nothing goes through the shared queue */
+		uint32_t perThread = JOB_COUNT / jobSystem.GetThreadCount();
+		double spread = BestSeconds(iterations, [&] {
+			JobCounter counter;
+			for (uint32_t t = 0; t < jobSystem.GetThreadCount(); ++t)
+				jobSystem.Submit([&jobSystem, perThread] {
+					JobCounter inner;
+					for (uint32_t i = 0; i < perThread; ++i)
+						jobSystem.Submit([] {}, &inner);
+					jobSystem.Wait(inner);
+				}, &counter);
+			jobSystem.Wait(counter);
+		});
+		printf("Empty jobs, submitted by one thread:    %8.1f ns/job\n", single * 1e9 / JOB_COUNT);
+		printf("Empty jobs, submitted by every thread:  %8.1f ns/job\n", spread * 1e9 / (perThread * jobSystem.GetThreadCount()));
+	}
+
+	void DependencyChain(JobSystem& jobSystem, int iterations) {
+		constexpr uint32_t LENGTH = 10000;
+		std::vector<JobCounter> links(LENGTH);
+		double seconds = BestSeconds(iterations, [&] {
+			jobSystem.Submit([] {}, &links[0]);
+			for (uint32_t i = 1; i < LENGTH; ++i)
+				jobSystem.SubmitAfter(links[i - 1], [] {}, &links[i]);
+			jobSystem.Wait(links[LENGTH - 1]);
+			/* The counters are reused by the next iteration */
+			for (JobCounter& link : links)
+				jobSystem.Wait(link);
+		});
+		printf("Dependency chain of %u jobs:          %8.1f ns/hop\n", LENGTH, seconds * 1e9 / LENGTH);
+	}
+
+	void Transforms(JobSystem& jobSystem, int iterations) {
+		printf("\nWriteObjectTransforms, ms per frame\n%10s %10s %10s %10s %8s\n", "objects", "1 thread", "threads", "jobs", "speedup");
+		for (uint32_t count : { 1000u, 10000u, 100000u, 1000000u }) {
+			std::vector<float4x4> models(count);
+			for (uint32_t i = 0; i < count; ++i)
+				models[i] = translationMat(float3{ static_cast<float>(i), 1.0f, 2.0f });
+			std::vector<float3x4> dst(count);
+			int repeat = std::max(iterations, static_cast<int>(2000000 / count));
+			double single = BestSeconds(repeat, [&] {
+				for (uint32_t i = 0; i < count; ++i)
+					dst[i] = toFloat3x4(models[i]);
+			});
+			double threads = BestSeconds(repeat, [&] { WriteWithThreads(dst.data(), models.data(), count, jobSystem.GetThreadCount()); });
+			double jobs = BestSeconds(repeat, [&] { WriteObjectTransforms(dst.data(), models.data(), count, jobSystem); });
+			printf("%10u %10.3f %10.3f %10.3f %7.2fx\n", count, single * 1e3, threads * 1e3, jobs * 1e3, single / jobs);
+		}
+	}
+
+	void Unbalanced(JobSystem& jobSystem, int iterations) {
+		constexpr uint32_t ITEMS = 4096;
+		std::vector<float> results(ITEMS);
+		auto work = [&results](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; ++i)
+				results[i] = Spin(i / 4);
+		};
+		double single = BestSeconds(iterations, [&] { work(0, ITEMS); });
+		double parallel = BestSeconds(iterations, [&] { jobSystem.ParallelFor(ITEMS, 16, work); });
+		JobSystemStats before = jobSystem.GetStats();
+		jobSystem.ParallelFor(ITEMS, 16, work);
+		JobSystemStats after = jobSystem.GetStats();
+		printf("\nUnbalanced ParallelFor: %.3f ms on 1 thread, %.3f ms as jobs, %.2fx on %u threads, %llu of %llu jobs stolen\n",
+			single * 1e3, parallel * 1e3, single / parallel, jobSystem.GetThreadCount(),
+			static_cast<unsigned long long>(after.jobsStolen - before.jobsStolen), static_cast<unsigned long long>(after.jobsRun - before.jobsRun));
+	}
+}
+
+int main(int argc, char** argv) {
+	uint32_t workers = 0;
+	int iterations = 5;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc)
+			workers = static_cast<uint32_t>(atoi(argv[++i]));
+		else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+			iterations = std::max(1, atoi(argv[++i]));
+		else {
+			fprintf(stderr, "Usage: job_system_benchmark [--workers N] [--iterations N]\n");
+			return 1;
+		}
+	}
+
+	JobSystem jobSystem(workers);
+	jobSystem.SetMainThread();
+	printf("%u workers + main thread, %u hardware threads\n\n", jobSystem.GetWorkerCount(), std::thread::hardware_concurrency());
+
+	EmptyJobs(jobSystem, iterations);
+	DependencyChain(jobSystem, iterations);
+	Transforms(jobSystem, iterations);
+	Unbalanced(jobSystem, iterations);
+
+	char stats[256];
+	jobSystem.FormatStats(stats, sizeof(stats));
+	printf("\n%s", stats);
+	return 0;
+}
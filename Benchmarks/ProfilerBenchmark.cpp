@@ -0,0 +1,315 @@
+/*
+ * Checks and costs of the CPU scope profiler in Source/Profiler.cpp. The checks nest scopes on the main thread and on a
+ * worker running at the same time, then read the frame back through GetFrameHierarchy and through the Chrome trace,
+ * which is parsed as JSON and checked for the same scopes, nested the same way; the timings are the cost of one scope
+ * and of EndFrame draining a frame full of them.
+ *
+ * Linux:   g++ -std=c++17 -O2 -pthread -DAWESOME_PROFILER -ISource Benchmarks/ProfilerBenchmark.cpp Source/Profiler.cpp Source/Clock.cpp -o profiler_benchmark
+ * Windows: cl /std:c++17 /O2 /EHsc /DAWESOME_PROFILER /ISource Benchmarks\ProfilerBenchmark.cpp Source\Profiler.cpp Source\Clock.cpp
+ *
+ * Usage: profiler_benchmark [iterations]
+ * The trace is written under the system temp directory and removed again afterwards.
+ */
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef AWESOME_PROFILER
+#error "Build with AWESOME_PROFILER defined, without it every scope compiles to nothing"
+#endif
+
+using namespace awesome;
+
+namespace {
+
+	bool Check(const char* name, bool passed) {
+		printf("%-62s %s\n", name, passed ? "ok" : "FAILED");
+		return passed;
+	}
+
+	/* Just enough JSON to read the trace back: objects, arrays, strings and numbers */
+	struct JsonValue {
+		enum class Type { Null, Number, String, Array, Object } type{ Type::Null };
+		double number{ 0.0 };
+		std::string string;
+		std::vector<JsonValue> elements; // array elements, or object values in the order of keys
+		std::vector<std::string> keys;
+
+		const JsonValue* Find(const char* key) const {
+			for (size_t i = 0; i < keys.size(); ++i)
+				if (keys[i] == key)
+					return &elements[i];
+			return nullptr;
+		}
+	};
+
+	class JsonParser {
+	public:
+		explicit JsonParser(const std::string& text) : text(text) {}
+
+		/* The whole text has to be one value, anything left over is an error */
+		bool Parse(JsonValue& value) {
+			if (!ParseValue(value))
+				return false;
+			SkipSpace();
+			return position == text.size();
+		}
+
+	private:
+		void SkipSpace() {
+			while (position < text.size() && strchr(" \t\r\n", text[position]))
+				++position;
+		}
+
+		bool Consume(char c) {
+			SkipSpace();
+			if (position >= text.size() || text[position] != c)
+				return false;
+			++position;
+			return true;
+		}
+
+		bool ParseString(std::string& out) {
+			if (!Consume('"'))
+				return false;
+			for (; position < text.size() && text[position] != '"'; ++position) {
+				if (static_cast<unsigned char>(text[position]) < 0x20)
+					return false;
+				if (text[position] == '\\' && ++position < text.size() && !strchr("\"\\/bfnrt", text[position]))
+					return false;
+				out += text[position];
+			}
+			return Consume('"');
+		}
+
+		bool ParseValue(JsonValue& value) {
+			SkipSpace();
+			if (position >= text.size())
+				return false;
+			char c = text[position];
+			if (c == '"') {
+				value.type = JsonValue::Type::String;
+				return ParseString(value.string);
+			}
+			if (c == '[' || c == '{') {
+				bool isObject = c == '{';
+				value.type = isObject ? JsonValue::Type::Object : JsonValue::Type::Array;
+				++position;
+				if (Consume(isObject ? '}' : ']'))
+					return true;
+				do {
+					if (isObject) {
+						value.keys.emplace_back();
+						if (!ParseString(value.keys.back()) || !Consume(':'))
+							return false;
+					}
+					value.elements.emplace_back();
+					if (!ParseValue(value.elements.back()))
+						return false;
+				} while (Consume(','));
+				return Consume(isObject ? '}' : ']');
+			}
+			const char* start = text.c_str() + position;
+			char* end = nullptr;
+			value.type = JsonValue::Type::Number;
+			value.number = strtod(start, &end);
+			position += end - start;
+			return end != start;
+		}
+
+		const std::string& text;
+		size_t position{ 0 };
+	};
+
+	struct TraceScope {
+		std::string name;
+		double start;
+		double end;
+	};
+
+	/* The X events of one tid in the trace, false if any event misses a field the viewers need */
+	bool ReadTraceScopes(const JsonValue& trace, int pid, int tid, std::vector<TraceScope>& scopes) {
+		const JsonValue* events = trace.Find("traceEvents");
+		if (!events || events->type != JsonValue::Type::Array)
+			return false;
+		for (const JsonValue& event : events->elements) {
+			const JsonValue* name = event.Find("name");
+			const JsonValue* ph = event.Find("ph");
+			const JsonValue* eventPid = event.Find("pid");
+			const JsonValue* eventTid = event.Find("tid");
+			if (!name || !ph || !eventPid || !eventTid || name->type != JsonValue::Type::String)
+				return false;
+			if (ph->string != "X" || eventPid->number != pid || eventTid->number != tid)
+				continue;
+			const JsonValue* ts = event.Find("ts");
+			const JsonValue* dur = event.Find("dur");
+			if (!ts || !dur || ts->type != JsonValue::Type::Number || dur->type != JsonValue::Type::Number || ts->number < 0 || dur->number < 0)
+				return false;
+			scopes.push_back({ name->string, ts->number, ts->number + dur->number });
+		}
+		return true;
+	}
+
+	/* Whether every scope called childName lies inside one called parentName, and there are count of them */
+	bool NestedInTrace(const std::vector<TraceScope>& scopes, const char* parentName, const char* childName, size_t count) {
+		size_t found = 0;
+		for (const TraceScope& child : scopes) {
+			if (child.name != childName)
+				continue;
+			++found;
+			bool inside = std::any_of(scopes.begin(), scopes.end(), [&](const TraceScope& parent) {
+				/* ts and dur are printed to a thousandth of a microsecond */
+				return parent.name == parentName && parent.start <= child.start + 0.001 && child.end <= parent.end + 0.002;
+			});
+			if (!inside)
+				return false;
+		}
+		return found == count;
+	}
+
+	const ProfileNode* FindNode(const std::vector<ProfileNode>& nodes, const char* name, const char* parentName) {
+		for (const ProfileNode& node : nodes) {
+			const char* parent = node.parent < 0 ? nullptr : nodes[node.parent].name;
+			if (!strcmp(node.name, name) && (parent ? parentName && !strcmp(parent, parentName) : !parentName))
+				return &node;
+		}
+		return nullptr;
+	}
+
+	void Spin(int iterations) {
+		volatile int sink = 0;
+		for (int i = 0; i < iterations; ++i)
+			sink = sink + i;
+	}
+
+	/* Main thread: Frame { Update { Physics x2 } Render }; worker: Jobs { Task { Leaf } x3 }, both inside one frame */
+	void RecordFrame() {
+		std::atomic<int> started{ 0 };
+		PROFILE_SCOPE("Frame");
+		std::thread worker([&] {
+			PROFILE_SCOPE("Jobs");
+			++started;
+			while (started < 2)
+				std::this_thread::yield();
+			for (int i = 0; i < 3; ++i) {
+				PROFILE_SCOPE("Task");
+				Spin(2000);
+				{
+					PROFILE_SCOPE("Leaf");
+					Spin(2000);
+				}
+			}
+		});
+		{
+			PROFILE_SCOPE("Update");
+			++started;
+			while (started < 2)
+				std::this_thread::yield();
+			for (int i = 0; i < 2; ++i) {
+				PROFILE_SCOPE("Physics");
+				Spin(5000);
+			}
+		}
+		{
+			PROFILE_SCOPE("Render");
+			Spin(5000);
+		}
+		worker.join();
+	}
+
+	bool RunChecks(const std::string& tracePath) {
+		bool passed = true;
+		/* The first thread to open a scope is thread 0, make sure that is this one; the name needs escaping in JSON */
+		const char* const startup = "Startup \"cold\" C:\\ShaderCache";
+		{
+			PROFILE_SCOPE(startup);
+		}
+		Profiler::EndFrame();
+		RecordFrame();
+		Profiler::EndFrame();
+
+		std::vector<ProfileNode> main = Profiler::GetFrameHierarchy(0);
+		const ProfileNode* frame = FindNode(main, "Frame", nullptr);
+		const ProfileNode* update = FindNode(main, "Update", "Frame");
+		const ProfileNode* physics = FindNode(main, "Physics", "Update");
+		const ProfileNode* render = FindNode(main, "Render", "Frame");
+		passed &= Check("the main thread hierarchy follows its scopes", main.size() == 4 && frame && update && physics && render
+			&& frame->calls == 1 && physics->calls == 2 && render->calls == 1 && frame->depth == 0 && physics->depth == 2
+			&& !FindNode(main, startup, nullptr) && !FindNode(main, "Jobs", nullptr));
+		passed &= Check("parents take at least as long as their children", frame && update && physics && render
+			&& frame->totalTicks >= update->totalTicks + render->totalTicks
+			&& update->totalTicks >= physics->totalTicks && physics->totalTicks > 0);
+
+		std::vector<ProfileNode> worker = Profiler::GetFrameHierarchy(1);
+		const ProfileNode* jobs = FindNode(worker, "Jobs", nullptr);
+		const ProfileNode* task = FindNode(worker, "Task", "Jobs");
+		const ProfileNode* leaf = FindNode(worker, "Leaf", "Task");
+		passed &= Check("the worker hierarchy merges repeated scopes", worker.size() == 3 && jobs && task && leaf
+			&& task->calls == 3 && leaf->calls == 3 && jobs->depth == 0 && leaf->depth == 2 && task->totalTicks >= leaf->totalTicks);
+
+		char text[1024];
+		Profiler::FormatFrameHierarchy(text, sizeof(text), 1);
+		passed &= Check("the formatted hierarchy indents children", strstr(text, "Jobs ") == text && strstr(text, "\n  Task ") && strstr(text, "\n    Leaf "));
+
+		JsonValue trace;
+		std::string json;
+		if (Profiler::WriteChromeTrace(tracePath)) {
+			std::ifstream file(tracePath, std::ios::binary);
+			json.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		}
+		passed &= Check("the Chrome trace is valid JSON", JsonParser(json).Parse(trace) && trace.Find("traceEvents"));
+
+		std::vector<TraceScope> frames, mainScopes, workerScopes;
+		bool wellFormed = ReadTraceScopes(trace, 0, 0, frames) && ReadTraceScopes(trace, 1, 0, mainScopes) && ReadTraceScopes(trace, 1, 1, workerScopes);
+		/* Both captured frames: Startup alone, then five main thread and seven worker scopes */
+		passed &= Check("the trace has every scope on its thread's track", wellFormed && frames.size() == 2
+			&& mainScopes.size() == 1 + 5 && workerScopes.size() == 7 && mainScopes[0].name == startup);
+		passed &= Check("scopes nest in the trace like in the hierarchy", NestedInTrace(mainScopes, "Update", "Physics", 2)
+			&& NestedInTrace(mainScopes, "Frame", "Render", 1) && NestedInTrace(workerScopes, "Jobs", "Task", 3) && NestedInTrace(workerScopes, "Task", "Leaf", 3));
+		/* The frame track and the main thread's Frame scope both cover the worker, whose scopes came from another thread */
+		std::vector<TraceScope> overlap = mainScopes;
+		overlap.insert(overlap.end(), frames.begin(), frames.end());
+		overlap.insert(overlap.end(), workerScopes.begin(), workerScopes.end());
+		passed &= Check("the worker ran inside the main thread's frame", NestedInTrace(overlap, "Frame 1", "Jobs", 1)
+			&& NestedInTrace(overlap, "Frame", "Jobs", 1) && !NestedInTrace(overlap, "Frame 0", "Jobs", 1));
+		passed &= Check("no scope was dropped", Profiler::GetDroppedEvents() == 0);
+		return passed;
+	}
+
+	/* Best of each part separately, EndFrame has to run between the runs or the ring fills up */
+	void RunTimings(int iterations) {
+		const int scopesPerFrame = 10000;
+		double scopeSeconds = 1e30, endFrameSeconds = 1e30;
+		for (int iteration = 0; iteration < iterations; ++iteration) {
+			auto start = std::chrono::steady_clock::now();
+			for (int i = 0; i < scopesPerFrame; ++i) {
+				PROFILE_SCOPE("Timed");
+			}
+			auto scopesEnd = std::chrono::steady_clock::now();
+			Profiler::EndFrame();
+			scopeSeconds = std::min(scopeSeconds, std::chrono::duration<double>(scopesEnd - start).count());
+			endFrameSeconds = std::min(endFrameSeconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - scopesEnd).count());
+		}
+		printf("\n%-40s %10.1f ns\n", "One scope, opened and closed", scopeSeconds * 1e9 / scopesPerFrame);
+		printf("%-40s %10.1f us\n", "EndFrame, 10000 scopes", endFrameSeconds * 1e6);
+	}
+}
+
+int main(int argc, char** argv) {
+	int iterations = argc > 1 ? std::max(1, atoi(argv[1])) : 20;
+	std::error_code error;
+	const std::string tracePath = (std::filesystem::temp_directory_path(error) / "profiler_benchmark.json").string();
+	bool passed = RunChecks(tracePath);
+	std::filesystem::remove(tracePath, error);
+	RunTimings(iterations);
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,203 @@
+/*
+ * Checks and costs of the shader cache in Source/ShaderCache.cpp, with a stand-in compiler so it runs without the D3D
+ * compiler. The checks cover the key following a change to an included file, a second run being served from the cache
+ * directory without compiling, and corrupt entries being compiled again instead of trusted; the timings are the
+ * key computation over an include tree and the memory and disk lookups.
+ *
+ * Linux:   g++ -std=c++17 -O2 -ISource Benchmarks/ShaderCacheBenchmark.cpp Source/ShaderCache.cpp -o shader_cache_benchmark
+ * Windows: cl /std:c++17 /O2 /EHsc /ISource Benchmarks\ShaderCacheBenchmark.cpp Source\ShaderCache.cpp
+ *
+ * Usage: shader_cache_benchmark [iterations]
+ * The shaders and the cache directory are written under the system temp directory and removed again afterwards.
+ */
+#include "ShaderCache.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+
+using namespace awesome;
+
+namespace {
+
+	double BestSeconds(int iterations, const std::function<void()>& kernel) {
+		double best = 1e30;
+		for (int i = 0; i < iterations; ++i) {
+			auto start = std::chrono::steady_clock::now();
+			kernel();
+			best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	}
+
+	bool Check(const char* name, bool passed) {
+		printf("%-62s %s\n", name, passed ? "ok" : "FAILED");
+		return passed;
+	}
+
+	/* "Compiles" to the source text after the entry point, so different inputs give different bytecode */
+	class StubCompiler : public ShaderCompiler {
+	public:
+		bool Compile(const ShaderCompileDesc& desc, const std::string& source, ShaderBytecode& bytecode, std::string& errors) override {
+			++compiles;
+			if (source.find(desc.entryPoint) == std::string::npos) {
+				errors = desc.sourcePath + ": entry point " + desc.entryPoint + " not found";
+				return false;
+			}
+			std::string text = desc.entryPoint + "\n" + source;
+			bytecode.assign(text.begin(), text.end());
+			return true;
+		}
+
+		uint32_t compiles{ 0 };
+	};
+
+	void WriteFile(const std::filesystem::path& path, const std::string& contents) {
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file << contents;
+	}
+
+	/* A pixel shader including a common header, which includes a lighting header from a sub directory */
+	ShaderCompileDesc MakeShaderTree(const std::filesystem::path& directory, const std::string& lighting) {
+		std::filesystem::create_directories(directory / "include");
+		WriteFile(directory / "surface.hlsl", "#include \"include/common.hlsli\"\nfloat4 PSMain() : SV_Target { return Shade(); }\n");
+		WriteFile(directory / "include" / "common.hlsli", "#pragma once\n#include \"lighting.hlsli\"\n");
+		WriteFile(directory / "include" / "lighting.hlsli", lighting);
+		ShaderCompileDesc desc;
+		desc.sourcePath = (directory / "surface.hlsl").generic_string();
+		desc.entryPoint = "PSMain";
+		desc.profile = "ps_5_0";
+		desc.defines = { { "SHADOWS", "1" } };
+		return desc;
+	}
+
+	uint64_t KeyOf(const ShaderCompileDesc& desc, const std::string& cacheDirectory) {
+		StubCompiler compiler;
+		ShaderCache cache(cacheDirectory, &compiler);
+		uint64_t key = 0;
+		std::string errors;
+		cache.ComputeKey(desc, key, errors);
+		return key;
+	}
+
+	bool RunChecks(const std::filesystem::path& root) {
+		bool passed = true;
+		const std::string cacheDirectory = (root / "cache").string();
+		const std::string lighting = "float4 Shade() { return 1; }\n";
+		ShaderCompileDesc desc = MakeShaderTree(root / "shaders", lighting);
+		const uint64_t key = KeyOf(desc, cacheDirectory);
+
+		passed &= Check("the key is the same when nothing changed", KeyOf(desc, cacheDirectory) == key);
+		passed &= Check("the key changes with a file included two levels down", [&] {
+			WriteFile(root / "shaders" / "include" / "lighting.hlsli", "float4 Shade() { return 0.5; }\n");
+			uint64_t changed = KeyOf(desc, cacheDirectory);
+			WriteFile(root / "shaders" / "include" / "lighting.hlsli", lighting);
+			return changed != key && KeyOf(desc, cacheDirectory) == key;
+		}());
+		passed &= Check("the key changes with the defines", [&] {
+			ShaderCompileDesc other = desc;
+			other.defines[0].value = "0";
+			return KeyOf(other, cacheDirectory) != key;
+		}());
+
+		ShaderBytecode firstBytecode;
+		passed &= Check("the first run compiles once and hits memory after that", [&] {
+			StubCompiler compiler;
+			ShaderCache cache(cacheDirectory, &compiler);
+			std::string errors;
+			ShaderBytecode again;
+			bool ok = cache.GetBytecode(desc, firstBytecode, errors) && cache.GetBytecode(desc, again, errors);
+			ShaderCacheStats stats = cache.GetStats();
+			return ok && again == firstBytecode && compiler.compiles == 1 && stats.compiles == 1 && stats.memoryHits == 1 && stats.diskHits == 0
+				&& std::filesystem::exists(cache.GetCachePath(key));
+		}());
+		passed &= Check("a second run is served from the cache directory", [&] {
+			StubCompiler compiler;
+			ShaderCache cache(cacheDirectory, &compiler);
+			std::string errors;
+			ShaderBytecode bytecode;
+			bool ok = cache.GetBytecode(desc, bytecode, errors);
+			ShaderCacheStats stats = cache.GetStats();
+			return ok && bytecode == firstBytecode && compiler.compiles == 0 && stats.diskHits == 1;
+		}());
+
+		/* Entries as a crash, a full disk or a bad sector could leave them: cut short, too long, and a size of 2^62 */
+		const std::string entryPath = ShaderCache(cacheDirectory, nullptr).GetCachePath(key);
+		auto readEntry = [&] {
+			std::ifstream file(entryPath, std::ios::binary);
+			return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		};
+		const std::string entry = readEntry();
+		const size_t sizeOffset = 16;
+		std::string hugeSize = entry;
+		hugeSize[sizeOffset + 7] = 0x40;
+		const std::string corruptEntries[] = { entry.substr(0, entry.size() - 3), entry + "junk", hugeSize };
+		bool allRejected = true;
+		for (const std::string& corrupt : corruptEntries) {
+			WriteFile(entryPath, corrupt);
+			StubCompiler compiler;
+			ShaderCache cache(cacheDirectory, &compiler);
+			std::string errors;
+			ShaderBytecode bytecode;
+			bool ok = cache.GetBytecode(desc, bytecode, errors);
+			ShaderCacheStats stats = cache.GetStats();
+			allRejected &= ok && bytecode == firstBytecode && compiler.compiles == 1 && stats.diskHits == 0 && readEntry() == entry;
+		}
+		passed &= Check("corrupt entries are compiled again and rewritten", allRejected);
+
+		passed &= Check("a failed compile is reported and not cached", [&] {
+			ShaderCompileDesc broken = desc;
+			broken.entryPoint = "VSMain";
+			StubCompiler compiler;
+			ShaderCache cache(cacheDirectory, &compiler);
+			std::string errors;
+			ShaderBytecode bytecode;
+			bool ok = cache.GetBytecode(broken, bytecode, errors) || cache.GetBytecode(broken, bytecode, errors);
+			uint64_t brokenKey = 0;
+			cache.ComputeKey(broken, brokenKey, errors);
+			return !ok && compiler.compiles == 2 && cache.GetStats().failures == 2 && !errors.empty()
+				&& !std::filesystem::exists(cache.GetCachePath(brokenKey));
+		}());
+		return passed;
+	}
+
+	void RunTimings(const std::filesystem::path& root, int iterations) {
+		const std::string cacheDirectory = (root / "cache").string();
+		ShaderCompileDesc desc = MakeShaderTree(root / "shaders", std::string(16 * 1024, '\n') + "float4 Shade() { return 1; }\n");
+		StubCompiler compiler;
+		ShaderCache warm(cacheDirectory, &compiler);
+		ShaderBytecode bytecode;
+		std::string errors;
+		warm.GetBytecode(desc, bytecode, errors);
+
+		/* Sources are read once per cache, so this is hashing and include scanning over files already in memory */
+		uint64_t key = 0;
+		double keySeconds = BestSeconds(iterations, [&] { warm.ComputeKey(desc, key, errors); });
+		double memorySeconds = BestSeconds(iterations, [&] { warm.GetBytecode(desc, bytecode, errors); });
+		/* A fresh cache per call, so this also reads the three source files */
+		double diskSeconds = BestSeconds(iterations, [&] {
+			ShaderCache cache(cacheDirectory, &compiler);
+			cache.GetBytecode(desc, bytecode, errors);
+		});
+
+		printf("\n%-40s %10.1f us\n", "ComputeKey, 3 files, 16 KB", keySeconds * 1e6);
+		printf("%-40s %10.1f us\n", "GetBytecode, memory hit", memorySeconds * 1e6);
+		printf("%-40s %10.1f us\n", "GetBytecode, disk hit in a new cache", diskSeconds * 1e6);
+	}
+}
+
+int main(int argc, char** argv) {
+	int iterations = argc > 1 ? std::max(1, atoi(argv[1])) : 20;
+	std::error_code error;
+	const std::filesystem::path root = std::filesystem::temp_directory_path(error) / "shader_cache_benchmark";
+	std::filesystem::remove_all(root, error);
+	bool passed = RunChecks(root);
+	std::filesystem::remove_all(root, error);
+	RunTimings(root, iterations);
+	std::filesystem::remove_all(root, error);
+	return passed ? 0 : 1;
+}
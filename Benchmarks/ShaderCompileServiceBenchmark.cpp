@@ -0,0 +1,227 @@
+/*
+ * Checks and costs of the background shader compiles in Source/ShaderCompileService.cpp, with a stand-in compiler that
+ * holds every compile until the check lets it finish. The checks cover draws falling back while a program compiles,
+ * Poll switching to the program once every stage is done, a failed compile keeping the fallback, and shutdown failing
+ * the queued requests instead of waiting for them; the timing is the round trip of a request served from memory.
+ *
+ * Linux:   g++ -std=c++17 -O2 -pthread -ISource Benchmarks/ShaderCompileServiceBenchmark.cpp Source/ShaderCompileService.cpp Source/ShaderCache.cpp Source/ShaderPermutations.cpp -o shader_compile_service_benchmark
+ * Windows: cl /std:c++17 /O2 /EHsc /ISource Benchmarks\ShaderCompileServiceBenchmark.cpp Source\ShaderCompileService.cpp Source\ShaderCache.cpp Source\ShaderPermutations.cpp
+ *
+ * Usage: shader_compile_service_benchmark [iterations]
+ * The shader is written under the system temp directory and removed again afterwards.
+ */
+#include "ShaderCompileService.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using namespace awesome;
+
+namespace {
+
+	double BestSeconds(int iterations, const std::function<void()>& kernel) {
+		double best = 1e30;
+		for (int i = 0; i < iterations; ++i) {
+			auto start = std::chrono::steady_clock::now();
+			kernel();
+			best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	}
+
+	bool Check(const char* name, bool passed) {
+		printf("%-62s %s\n", name, passed ? "ok" : "FAILED");
+		return passed;
+	}
+
+	/* Fails entry points missing from the source like the real compiler; while closed, every compile waits at the gate */
+	class GatedCompiler : public ShaderCompiler {
+	public:
+		bool Compile(const ShaderCompileDesc& desc, const std::string& source, ShaderBytecode& bytecode, std::string& errors) override {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				++waiting;
+				changed.notify_all();
+				changed.wait(lock, [this] { return open; });
+				--waiting;
+			}
+			if (source.find(desc.entryPoint) == std::string::npos) {
+				errors = desc.sourcePath + ": entry point " + desc.entryPoint + " not found";
+				return false;
+			}
+			std::string text = desc.entryPoint + " " + desc.profile;
+			bytecode.assign(text.begin(), text.end());
+			return true;
+		}
+
+		void SetOpen(bool isOpen) {
+			std::lock_guard<std::mutex> lock(mutex);
+			open = isOpen;
+			changed.notify_all();
+		}
+
+		/* Until count compiles are held at the gate, false if that does not happen within a few seconds */
+		bool WaitForWaiting(uint32_t count) {
+			std::unique_lock<std::mutex> lock(mutex);
+			return changed.wait_for(lock, std::chrono::seconds(5), [&] { return waiting >= count; });
+		}
+
+	private:
+		std::mutex mutex;
+		std::condition_variable changed;
+		uint32_t waiting{ 0 };
+		bool open{ false };
+	};
+
+	/* Polls once per "frame" until the program is no longer compiling, false if that takes more than a few seconds */
+	bool PollUntilDone(AsyncShaderProgram& program) {
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (program.Poll() == ShaderProgramState::Compiling) {
+			if (std::chrono::steady_clock::now() > deadline)
+				return false;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return true;
+	}
+
+	struct Shader {
+		ShaderCompileDesc stages[SHADER_STAGE_COUNT];
+	};
+
+	/* A define per request keeps every program a separate cache key, so each one really goes to the compiler */
+	Shader MakeShader(const std::string& sourcePath, const std::string& variant, const char* pixelEntryPoint = "PSMain") {
+		Shader shader;
+		const char* entryPoints[SHADER_STAGE_COUNT] = { "VSMain", pixelEntryPoint };
+		const char* profiles[SHADER_STAGE_COUNT] = { "vs_5_0", "ps_5_0" };
+		for (uint32_t stage = 0; stage < SHADER_STAGE_COUNT; ++stage) {
+			shader.stages[stage].sourcePath = sourcePath;
+			shader.stages[stage].entryPoint = entryPoints[stage];
+			shader.stages[stage].profile = profiles[stage];
+			shader.stages[stage].defines = { { "VARIANT", variant } };
+		}
+		return shader;
+	}
+
+	bool RunChecks(const std::string& sourcePath, const std::string& cacheDirectory) {
+		bool passed = true;
+		GatedCompiler compiler;
+		ShaderCache cache(cacheDirectory, &compiler);
+
+		{
+			ShaderCompileService service(cache, 2);
+			AsyncShaderProgram program;
+			program.Request(service, MakeShader(sourcePath, "pending").stages);
+			compiler.WaitForWaiting(SHADER_STAGE_COUNT);
+			bool pending = program.Poll() == ShaderProgramState::Compiling && service.GetPendingCount() == SHADER_STAGE_COUNT;
+			passed &= Check("draws use the fallback while the program compiles", pending
+				&& ChooseDrawShader(program.GetState(), true) == DrawShaderChoice::Fallback
+				&& ChooseDrawShader(program.GetState(), false) == DrawShaderChoice::Skip);
+
+			compiler.SetOpen(true);
+			bool done = PollUntilDone(program);
+			passed &= Check("Poll switches to the program once every stage is compiled", done && program.GetState() == ShaderProgramState::Ready
+				&& ChooseDrawShader(program.GetState(), true) == DrawShaderChoice::Program
+				&& program.GetBytecode(SHADER_STAGE_VERTEX) == ShaderBytecode{ 'V', 'S', 'M', 'a', 'i', 'n', ' ', 'v', 's', '_', '5', '_', '0' }
+				&& !program.GetBytecode(SHADER_STAGE_PIXEL).empty() && service.GetPendingCount() == 0);
+
+			AsyncShaderProgram broken;
+			broken.Request(service, MakeShader(sourcePath, "broken", "PSMissing").stages);
+			done = PollUntilDone(broken);
+			passed &= Check("a failed compile keeps the fallback and reports why", done && broken.GetState() == ShaderProgramState::Failed
+				&& ChooseDrawShader(broken.GetState(), true) == DrawShaderChoice::Fallback
+				&& broken.GetErrors().find("PSMissing") != std::string::npos && broken.Poll() == ShaderProgramState::Failed);
+		}
+
+		/*
+		 * One worker held inside the first compile, everything else queued. The gate opens only after the destructor
+		 * has taken the queue, so the compile in progress finishes and the queued ones must fail without compiling.
+		 */
+		compiler.SetOpen(false);
+		const uint32_t compilesBefore = cache.GetStats().compiles;
+		const int programCount = 4;
+		AsyncShaderProgram programs[programCount];
+		auto service = std::make_unique<ShaderCompileService>(cache, 1);
+		for (int i = 0; i < programCount; ++i)
+			programs[i].Request(*service, MakeShader(sourcePath, "shutdown" + std::to_string(i)).stages);
+		compiler.WaitForWaiting(1);
+		std::thread opener([&] {
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			compiler.SetOpen(true);
+		});
+		std::atomic<bool> shutDown{ false };
+		std::thread destroyer([&] {
+			service.reset();
+			shutDown = true;
+		});
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (!shutDown && std::chrono::steady_clock::now() < deadline)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		if (!shutDown) {
+			Check("shutdown fails queued compiles instead of waiting", false);
+			fflush(stdout);
+			_Exit(1); // the service is stuck in its destructor, nothing left to do but leave
+		}
+		destroyer.join();
+		opener.join();
+
+		bool queuedFailed = true;
+		for (int i = 0; i < programCount; ++i)
+			queuedFailed &= programs[i].Poll() == ShaderProgramState::Failed && programs[i].GetErrors().find("shut down") != std::string::npos
+				&& ChooseDrawShader(programs[i].GetState(), true) == DrawShaderChoice::Fallback;
+		/* The first program's vertex shader was the compile in progress, so it is the only one that made it */
+		passed &= Check("shutdown fails queued compiles instead of waiting", queuedFailed && cache.GetStats().compiles == compilesBefore + 1
+			&& programs[0].GetErrors().find("VSMain") == std::string::npos);
+		return passed;
+	}
+
+	/* Requests the cache already holds: what a program costs to request and pick up when nothing needs compiling */
+	void RunTimings(const std::string& sourcePath, const std::string& cacheDirectory, int iterations) {
+		GatedCompiler compiler;
+		compiler.SetOpen(true);
+		ShaderCache cache(cacheDirectory, &compiler);
+		ShaderCompileService service(cache, std::max(1u, std::thread::hardware_concurrency()));
+		Shader shader = MakeShader(sourcePath, "timing");
+		AsyncShaderProgram program;
+		program.Request(service, shader.stages);
+		PollUntilDone(program);
+
+		const int programsPerRun = 1000;
+		double seconds = BestSeconds(iterations, [&] {
+			for (int i = 0; i < programsPerRun; ++i) {
+				program.Request(service, shader.stages);
+				while (program.Poll() == ShaderProgramState::Compiling)
+					std::this_thread::yield();
+			}
+		});
+		printf("\n%-40s %10.1f us\n", "Request and Poll, memory hit", seconds * 1e6 / programsPerRun);
+	}
+}
+
+int main(int argc, char** argv) {
+	int iterations = argc > 1 ? std::max(1, atoi(argv[1])) : 20;
+	std::error_code error;
+	const std::filesystem::path root = std::filesystem::temp_directory_path(error) / "shader_compile_service_benchmark";
+	std::filesystem::remove_all(root, error);
+	std::filesystem::create_directories(root, error);
+	const std::string sourcePath = (root / "surface.hlsl").generic_string();
+	{
+		std::ofstream source(sourcePath, std::ios::binary);
+		source << "float4 VSMain() : SV_Position { return 0; }\nfloat4 PSMain() : SV_Target { return 1; }\n";
+	}
+	const std::string cacheDirectory = (root / "cache").string();
+
+	bool passed = RunChecks(sourcePath, cacheDirectory);
+	RunTimings(sourcePath, cacheDirectory, iterations);
+	std::filesystem::remove_all(root, error);
+	return passed ? 0 : 1;
+}
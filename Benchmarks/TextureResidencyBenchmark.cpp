@@ -0,0 +1,171 @@
+/*
+ * Checks and costs of the texture budget in Source/TextureResidency.cpp. The checks oversubscribe a small budget with
+ * several textures with full mip chains and follow the dropped, restored and evicted mips as the textures fall out of
+ * use and come back; the timing runs Update over a scene with thousands of textures, most of them unused.
+ *
+ * Linux:   g++ -std=c++17 -O2 -ISource Benchmarks/TextureResidencyBenchmark.cpp Source/TextureResidency.cpp -o texture_residency_benchmark
+ * Windows: cl /std:c++17 /O2 /EHsc /ISource Benchmarks\TextureResidencyBenchmark.cpp Source\TextureResidency.cpp
+ *
+ * Usage: texture_residency_benchmark [iterations]
+ */
+#include "TextureResidency.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+using namespace awesome;
+
+namespace {
+
+	double BestSeconds(int iterations, const std::function<void()>& kernel) {
+		double best = 1e30;
+		for (int i = 0; i < iterations; ++i) {
+			auto start = std::chrono::steady_clock::now();
+			kernel();
+			best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	}
+
+	bool Check(const char* name, bool passed) {
+		printf("%-62s %s\n", name, passed ? "ok" : "FAILED");
+		return passed;
+	}
+
+	/* 256x256 RGBA8 with all 9 mips, drawn at one texel per pixel so every mip is wanted */
+	constexpr uint32_t TEXTURE_SIZE = 256;
+	constexpr uint32_t MIP_COUNT = 9;
+	constexpr float FULL_COVERAGE = static_cast<float>(TEXTURE_SIZE * TEXTURE_SIZE);
+
+	TextureResidencyDesc MakeDesc(const char* name) {
+		TextureResidencyDesc desc;
+		desc.name = name;
+		desc.width = TEXTURE_SIZE;
+		desc.height = TEXTURE_SIZE;
+		desc.mipCount = MIP_COUNT;
+		return desc;
+	}
+
+	/* Whether the changes only touch expectedOrder, every change to one texture before any to the next */
+	bool ChangedInOrder(const std::vector<ResidencyChange>& changes, const std::vector<TextureHandle>& expectedOrder) {
+		size_t position = 0;
+		for (const ResidencyChange& change : changes) {
+			while (position < expectedOrder.size() && expectedOrder[position] != change.texture)
+				++position;
+			if (position == expectedOrder.size())
+				return false;
+		}
+		return true;
+	}
+
+	bool RunChecks() {
+		bool passed = true;
+		TextureResidencyManager manager;
+		manager.SetEvictAfterFrames(8);
+		TextureHandle a = manager.Register(MakeDesc("a"));
+		TextureHandle b = manager.Register(MakeDesc("b"));
+		TextureHandle c = manager.Register(MakeDesc("c"));
+		TextureHandle d = manager.Register(MakeDesc("d"));
+		const uint64_t fullBytes = manager.GetStats().residentBytes / 4;
+
+		passed &= Check("no budget keeps every mip", [] {
+			TextureResidencyManager unbudgeted;
+			TextureHandle first = unbudgeted.Register(MakeDesc("first"));
+			TextureHandle second = unbudgeted.Register(MakeDesc("second"));
+			std::vector<ResidencyChange> changes;
+			unbudgeted.MarkUsed(first, 1, 1.f);
+			unbudgeted.Update(400, changes);
+			return changes.empty() && unbudgeted.GetTopMip(first) == 0 && unbudgeted.GetTopMip(second) == 0;
+		}());
+
+		/* Room for two and a half of the four textures, used oldest first from a to d */
+		const uint64_t budget = fullBytes * 5 / 2;
+		manager.SetBudget(budget);
+		std::vector<ResidencyChange> changes;
+		manager.MarkUsed(a, 2, FULL_COVERAGE);
+		manager.MarkUsed(b, 3, FULL_COVERAGE);
+		manager.MarkUsed(c, 4, FULL_COVERAGE);
+		manager.MarkUsed(d, 5, FULL_COVERAGE);
+		manager.Update(5, changes);
+		const ResidencyStats& stats = manager.GetStats();
+		passed &= Check("an oversubscribed budget is met in one update", stats.residentBytes <= budget && stats.framesOverBudget == 0
+			&& stats.pressure > 1.f && stats.mipsDroppedThisFrame > 0);
+		passed &= Check("the least recently used texture loses its mips first", ChangedInOrder(changes, { a, b })
+			&& manager.GetTopMip(a) == MIP_COUNT - 1 && manager.GetTopMip(b) > 0 && manager.GetTopMip(c) == 0 && manager.GetTopMip(d) == 0);
+
+		/* c and d stay in use, a and b are not drawn for a while */
+		bool withinBudget = true;
+		bool nothingRestored = true;
+		for (uint64_t frame = 6; frame <= 10; ++frame) {
+			changes.clear();
+			manager.MarkUsed(c, frame, FULL_COVERAGE);
+			manager.MarkUsed(d, frame, FULL_COVERAGE);
+			manager.Update(frame, changes);
+			withinBudget &= stats.residentBytes <= budget;
+			nothingRestored &= changes.empty();
+		}
+		passed &= Check("a steady scene within budget changes nothing", withinBudget && nothingRestored);
+		passed &= Check("peak resident memory stays within the budget", stats.peakResidentBytes <= budget);
+
+		/* More budget and a back in use: a gets its mips back, b is still unused and does not */
+		const uint64_t largerBudget = fullBytes * 7 / 2;
+		manager.SetBudget(largerBudget);
+		changes.clear();
+		manager.MarkUsed(a, 11, FULL_COVERAGE);
+		manager.MarkUsed(c, 11, FULL_COVERAGE);
+		manager.MarkUsed(d, 11, FULL_COVERAGE);
+		uint32_t bTopMip = manager.GetTopMip(b);
+		manager.Update(11, changes);
+		passed &= Check("spare budget restores the mips of textures used again", manager.GetTopMip(a) == 0 && manager.GetTopMip(b) == bTopMip
+			&& stats.mipsRestoredThisFrame == MIP_COUNT - 1 && stats.residentBytes <= largerBudget);
+
+		/* Back to the small budget long after b was last drawn: b goes entirely, a keeps its lowest mip */
+		manager.SetBudget(budget);
+		changes.clear();
+		manager.MarkUsed(c, 12, FULL_COVERAGE);
+		manager.MarkUsed(d, 12, FULL_COVERAGE);
+		manager.Update(12, changes);
+		passed &= Check("textures unused for evictAfterFrames are evicted entirely", manager.GetTopMip(b) == MIP_COUNT
+			&& stats.evictedTextures == 1 && ChangedInOrder(changes, { b, a }) && stats.residentBytes <= budget);
+		passed &= Check("peak resident memory never exceeded the largest budget", stats.peakResidentBytes <= largerBudget);
+
+		manager.Unregister(b);
+		passed &= Check("unregistering an evicted texture balances the stats", stats.evictedTextures == 0 && stats.textureCount == 3);
+		return passed;
+	}
+
+	/* 4096 textures of which a few hundred are drawn each frame, twice as many as fit in the budget */
+	void RunTimings(int iterations) {
+		const uint32_t textureCount = 4096;
+		TextureResidencyManager manager;
+		std::vector<TextureHandle> handles;
+		for (uint32_t i = 0; i < textureCount; ++i)
+			handles.push_back(manager.Register(MakeDesc("scene")));
+		manager.SetBudget(manager.GetStats().residentBytes / 2);
+
+		std::vector<ResidencyChange> changes;
+		uint64_t frame = 1;
+		double seconds = BestSeconds(iterations, [&] {
+			changes.clear();
+			for (uint32_t i = 0; i < 300; ++i)
+				manager.MarkUsed(handles[(frame * 97 + i * 13) % textureCount], frame, FULL_COVERAGE / (1 + i % 16));
+			manager.Update(frame, changes);
+			++frame;
+		});
+
+		char line[512];
+		manager.FormatStats(line, sizeof(line));
+		printf("\n%s", line);
+		printf("%-40s %10.1f us\n", "Update, 4096 textures", seconds * 1e6);
+	}
+}
+
+int main(int argc, char** argv) {
+	int iterations = argc > 1 ? std::max(1, atoi(argv[1])) : 20;
+	bool passed = RunChecks();
+	RunTimings(iterations);
+	return passed ? 0 : 1;
+}
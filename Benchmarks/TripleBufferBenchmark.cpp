@@ -0,0 +1,176 @@
+/*
+ * Checks and costs of the snapshot handoff in Source/TripleBuffer.h, on the FrameSnapshot the simulation thread hands
+ * to the render thread. A writer thread publishes snapshots as fast as it can while a reader thread takes the latest;
+ * the checks are that the reader only ever sees newer frames, never a snapshot with fields from two different frames,
+ * and that Publish reports exactly the snapshots the reader never got. The timing is the cost of one handoff.
+ *
+ * Linux:   g++ -std=c++17 -O2 -pthread -ISource Benchmarks/TripleBufferBenchmark.cpp -o triple_buffer_benchmark
+ * Windows: cl /std:c++17 /O2 /EHsc /ISource Benchmarks\TripleBufferBenchmark.cpp
+ *
+ * Usage: triple_buffer_benchmark [iterations]
+ */
+#include "FrameSnapshot.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+
+using namespace awesome;
+
+namespace {
+
+	double BestSeconds(int iterations, const std::function<void()>& kernel) {
+		double best = 1e30;
+		for (int i = 0; i < iterations; ++i) {
+			auto start = std::chrono::steady_clock::now();
+			kernel();
+			best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	}
+
+	bool Check(const char* name, bool passed) {
+		printf("%-62s %s\n", name, passed ? "ok" : "FAILED");
+		return passed;
+	}
+
+	constexpr double STEP_SEC = 1.0 / 120.0;
+
+	/* Every field derived from the frame number, so a snapshot mixing two frames does not add up */
+	void WriteSnapshot(FrameSnapshot& snapshot, uint64_t frame) {
+		float value = static_cast<float>(frame & 0xFFFF);
+		snapshot.frame = frame;
+		snapshot.timeSec = frame * STEP_SEC;
+		snapshot.deltaTimeSec = STEP_SEC;
+		for (int i = 0; i < 16; ++i)
+			snapshot.viewMatrix.m[i / 4][i % 4] = value + i;
+		snapshot.cameraPosition = { value, -value, value * 0.5f };
+		/* A different count every frame, so the vector is resized while the reader may be looking at another buffer */
+		snapshot.objectTransforms.resize(1 + frame % 8);
+		for (float4x4& transform : snapshot.objectTransforms)
+			for (int i = 0; i < 16; ++i)
+				transform.m[i / 4][i % 4] = value - i;
+	}
+
+	bool IsWhole(const FrameSnapshot& snapshot) {
+		uint64_t frame = snapshot.frame;
+		float value = static_cast<float>(frame & 0xFFFF);
+		bool whole = snapshot.timeSec == frame * STEP_SEC && snapshot.deltaTimeSec == STEP_SEC && snapshot.cameraPosition.x == value
+			&& snapshot.cameraPosition.y == -value && snapshot.cameraPosition.z == value * 0.5f && snapshot.objectTransforms.size() == 1 + frame % 8;
+		for (int i = 0; i < 16; ++i)
+			whole &= snapshot.viewMatrix.m[i / 4][i % 4] == value + i;
+		for (const float4x4& transform : snapshot.objectTransforms)
+			for (int i = 0; i < 16; ++i)
+				whole &= transform.m[i / 4][i % 4] == value - i;
+		return whole;
+	}
+
+	void Publish(FrameSnapshotBuffer& buffer, uint64_t frame, bool& overwritten) {
+		WriteSnapshot(buffer.GetWriteBuffer(), frame);
+		overwritten = buffer.Publish();
+	}
+
+	struct HandoffResult {
+		uint64_t published{ 0 };
+		uint64_t overwritten{ 0 };  // Publish returned true
+		uint64_t acquired{ 0 };
+		uint64_t skipped{ 0 };      // frames the reader jumped over
+		bool increasing{ true };
+		bool whole{ true };
+	};
+
+	/* Writer and reader on their own threads, the reader takes whatever is newest until it has seen the last frame */
+	HandoffResult RunHandoff(uint64_t frameCount) {
+		FrameSnapshotBuffer buffer;
+		HandoffResult result;
+		std::atomic<int> ready{ 0 };
+		std::thread writer([&] {
+			++ready;
+			while (ready < 2)
+				std::this_thread::yield();
+			for (uint64_t frame = 1; frame <= frameCount; ++frame) {
+				bool overwritten;
+				Publish(buffer, frame, overwritten);
+				result.overwritten += overwritten;
+				/* Now and then give the reader a head start, so it also finds nothing new */
+				if (frame % 64 == 0)
+					std::this_thread::yield();
+			}
+			result.published = frameCount;
+		});
+		std::thread reader([&] {
+			++ready;
+			while (ready < 2)
+				std::this_thread::yield();
+			uint64_t last = 0;
+			while (last < frameCount) {
+				if (!buffer.AcquireLatest()) {
+					std::this_thread::yield();
+					continue;
+				}
+				const FrameSnapshot& snapshot = buffer.GetReadBuffer();
+				result.increasing &= snapshot.frame > last;
+				result.whole &= IsWhole(snapshot);
+				result.skipped += snapshot.frame - last - 1;
+				last = snapshot.frame;
+				++result.acquired;
+			}
+		});
+		writer.join();
+		reader.join();
+		return result;
+	}
+
+	bool RunChecks() {
+		bool passed = true;
+
+		passed &= Check("Publish reports a value the reader never took", [] {
+			FrameSnapshotBuffer buffer;
+			bool first, second, third;
+			Publish(buffer, 1, first);
+			Publish(buffer, 2, second);
+			bool acquired = buffer.AcquireLatest() && buffer.GetReadBuffer().frame == 2 && !buffer.HasNew() && !buffer.AcquireLatest();
+			Publish(buffer, 3, third);
+			return !first && second && acquired && !third;
+		}());
+
+		passed &= Check("the read buffer stays put while the writer keeps going", [] {
+			FrameSnapshotBuffer buffer;
+			bool overwritten;
+			Publish(buffer, 1, overwritten);
+			buffer.AcquireLatest();
+			const FrameSnapshot* held = &buffer.GetReadBuffer();
+			for (uint64_t frame = 2; frame < 100; ++frame)
+				Publish(buffer, frame, overwritten);
+			bool unchanged = &buffer.GetReadBuffer() == held && held->frame == 1 && IsWhole(*held);
+			return unchanged && buffer.AcquireLatest() && buffer.GetReadBuffer().frame == 99 && IsWhole(buffer.GetReadBuffer());
+		}());
+
+		HandoffResult result = RunHandoff(200000);
+		printf("  %llu published, %llu taken by the reader, %llu overwritten\n", static_cast<unsigned long long>(result.published),
+			static_cast<unsigned long long>(result.acquired), static_cast<unsigned long long>(result.overwritten));
+		passed &= Check("across threads the reader only sees newer frames", result.increasing && result.acquired > 0);
+		passed &= Check("across threads no snapshot is torn", result.whole);
+		passed &= Check("Publish returns true once per frame the reader skipped", result.overwritten == result.skipped
+			&& result.acquired + result.overwritten == result.published);
+		return passed;
+	}
+
+	void RunTimings(int iterations) {
+		const uint64_t frameCount = 100000;
+		HandoffResult result;
+		double seconds = BestSeconds(iterations, [&] { result = RunHandoff(frameCount); });
+		printf("\n%-40s %10.1f ns\n", "Write and publish, reader polling", seconds * 1e9 / frameCount);
+		printf("%-40s %10.1f %%\n", "Snapshots the reader took", 100.0 * result.acquired / frameCount);
+	}
+}
+
+int main(int argc, char** argv) {
+	int iterations = argc > 1 ? std::max(1, atoi(argv[1])) : 20;
+	bool passed = RunChecks();
+	RunTimings(iterations);
+	return passed ? 0 : 1;
+}
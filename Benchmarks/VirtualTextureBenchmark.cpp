@@ -0,0 +1,181 @@
+/*
+ * Checks and costs of the CPU side of the virtual texture in Source/VirtualTexture.cpp. The checks drive a small
+ * PageManager through residency, coarser-mip fallback, LRU eviction and a failing page loader; the timings run a
+ * frame of feedback through ProcessFeedback and Update and rebuild the mip 0 indirection for a large texture.
+ *
+ * Linux:   g++ -std=c++17 -O2 -ISource Benchmarks/VirtualTextureBenchmark.cpp Source/VirtualTexture.cpp -o virtual_texture_benchmark
+ * Windows: cl /std:c++17 /O2 /EHsc /ISource Benchmarks\VirtualTextureBenchmark.cpp Source\VirtualTexture.cpp
+ *
+ * Usage: virtual_texture_benchmark [iterations]
+ * The page loader does no I/O here, so the timings are the page management alone.
+ */
+#include "VirtualTexture.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+using namespace awesome;
+
+namespace {
+
+	double BestSeconds(int iterations, const std::function<void()>& kernel) {
+		double best = 1e30;
+		for (int i = 0; i < iterations; ++i) {
+			auto start = std::chrono::steady_clock::now();
+			kernel();
+			best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	}
+
+	bool Check(const char* name, bool passed) {
+		printf("%-62s %s\n", name, passed ? "ok" : "FAILED");
+		return passed;
+	}
+
+	bool IsResident(const PageManager& manager, PageId page) {
+		return manager.GetPageTable().GetSlot(page) >= 0;
+	}
+
+	/* The mip the lookup for page falls back to, -1 if nothing resolves */
+	int32_t ResolvedMip(const PageManager& manager, PageId page) {
+		PageId resolved;
+		int32_t slot;
+		return manager.GetPageTable().Resolve(page, resolved, slot) ? static_cast<int32_t>(resolved.mip) : -1;
+	}
+
+	bool RunChecks() {
+		bool passed = true;
+
+		passed &= Check("page keys round trip at the largest coordinates", [] {
+			PageId page = UnpackPageId(PackPageId({ 13, MAX_PAGES_PER_SIDE - 1, MAX_PAGES_PER_SIDE - 2 }));
+			return page.mip == 13 && page.x == MAX_PAGES_PER_SIDE - 1 && page.y == MAX_PAGES_PER_SIDE - 2;
+		}());
+
+		/* 8x8 pages in four mips, four pool slots of which the 1x1 mip pins one */
+		VirtualTextureDesc desc;
+		desc.widthInPages = 8;
+		desc.heightInPages = 8;
+		desc.poolWidthInPages = 2;
+		desc.poolHeightInPages = 2;
+		uint32_t failingKey = INVALID_PAGE_KEY;
+		std::vector<uint32_t> loaded;
+		PageManager manager;
+		manager.Init(desc, [&](PageId page, uint32_t, uint32_t) {
+			if (PackPageId(page) == failingKey)
+				return false;
+			loaded.push_back(PackPageId(page));
+			return true;
+		});
+
+		const PageId coarsest = { 3, 0, 0 };
+		passed &= Check("coarsest mip is resident after Init", manager.GetPageTable().GetMipCount() == 4 && IsResident(manager, coarsest)
+			&& ResolvedMip(manager, { 0, 7, 7 }) == 3);
+
+		/* Frame 1 samples one mip 0 page: it and its missing ancestors load, coarsest first */
+		uint32_t feedback = PackPageId({ 0, 0, 0 });
+		manager.ProcessFeedback(&feedback, 1, 1);
+		passed &= Check("feedback requests the page and its missing ancestors", manager.GetStats().requestedPages == 3);
+		bool changed = manager.Update(1, 8);
+		passed &= Check("update loads them coarse to fine", changed && loaded.size() == 4 && loaded[1] == PackPageId({ 2, 0, 0 })
+			&& loaded[2] == PackPageId({ 1, 0, 0 }) && loaded[3] == PackPageId({ 0, 0, 0 }) && manager.GetStats().pendingPages == 0);
+		passed &= Check("a resident page resolves to itself", ResolvedMip(manager, { 0, 0, 0 }) == 0);
+		passed &= Check("a missing page falls back to the nearest resident coarser mip", ResolvedMip(manager, { 0, 1, 1 }) == 1
+			&& ResolvedMip(manager, { 0, 2, 2 }) == 2 && ResolvedMip(manager, { 0, 7, 7 }) == 3);
+
+		std::vector<IndirectionEntry> indirection;
+		manager.GetPageTable().BuildIndirection(0, desc.poolWidthInPages, indirection);
+		passed &= Check("indirection points at the fallback mip", indirection.size() == 64 && indirection[0].mip == 0
+			&& indirection[2 * 8 + 2].mip == 2 && indirection[7 * 8 + 7].mip == 3 && indirection[7 * 8 + 7].resident == 1);
+
+		/* Frame 2 samples mips 0 and 2, so mip 1 becomes the least recently used page */
+		uint32_t touched[] = { PackPageId({ 0, 0, 0 }), PackPageId({ 2, 0, 0 }) };
+		manager.ProcessFeedback(touched, 2, 2);
+		manager.Update(2, 8);
+
+		/* Frame 3 samples a page in the other corner, which has to evict one */
+		feedback = PackPageId({ 2, 1, 1 });
+		manager.ProcessFeedback(&feedback, 1, 3);
+		manager.Update(3, 8);
+		passed &= Check("eviction recycles the least recently used page", manager.GetStats().evictedPages == 1
+			&& !IsResident(manager, { 1, 0, 0 }) && IsResident(manager, { 2, 1, 1 }) && IsResident(manager, { 0, 0, 0 }));
+		passed &= Check("the pinned coarsest mip is never evicted", IsResident(manager, coarsest));
+
+		/* Frame 4 samples every resident page and asks for another, nothing may be evicted */
+		uint32_t visible[] = { PackPageId({ 0, 0, 0 }), PackPageId({ 2, 0, 0 }), PackPageId({ 2, 1, 1 }), PackPageId({ 1, 0, 0 }) };
+		manager.ProcessFeedback(visible, 4, 4);
+		size_t loadedBefore = loaded.size();
+		changed = manager.Update(4, 8);
+		passed &= Check("pages sampled this frame are not evicted", !changed && loaded.size() == loadedBefore
+			&& manager.GetStats().pendingPages == 1 && IsResident(manager, { 2, 0, 0 }));
+
+		/* Frame 5 moves on, the page still wanted loads but its loader fails */
+		failingKey = PackPageId({ 1, 0, 0 });
+		feedback = PackPageId({ 1, 0, 0 });
+		manager.ProcessFeedback(&feedback, 1, 5);
+		changed = manager.Update(5, 8);
+		passed &= Check("a failed load leaves the page missing and asks again", !changed && !IsResident(manager, { 1, 0, 0 })
+			&& ResolvedMip(manager, { 1, 0, 0 }) == 2);
+		failingKey = INVALID_PAGE_KEY;
+		manager.ProcessFeedback(&feedback, 1, 6);
+		changed = manager.Update(6, 8);
+		passed &= Check("the freed slot takes the page once it loads", changed && IsResident(manager, { 1, 0, 0 }));
+
+		passed &= Check("feedback outside the texture is ignored", [&] {
+			uint32_t invalid[] = { INVALID_PAGE_KEY, PackPageId({ 0, 8, 0 }), PackPageId({ 4, 0, 0 }) };
+			manager.ProcessFeedback(invalid, 3, 7);
+			return manager.GetStats().requestedPages == 0;
+		}());
+		return passed;
+	}
+
+	/* A 1024x1024 page texture seen through a 1080p frame with feedback at 1/16 resolution */
+	void RunTimings(int iterations) {
+		VirtualTextureDesc desc;
+		desc.widthInPages = 1024;
+		desc.heightInPages = 1024;
+		desc.poolWidthInPages = 64;
+		desc.poolHeightInPages = 64;
+		PageManager manager;
+		manager.Init(desc, nullptr);
+
+		const uint32_t feedbackWidth = 1920 / 16, feedbackHeight = 1080 / 16;
+		std::vector<uint32_t> feedback(feedbackWidth * feedbackHeight);
+		uint64_t frame = 1;
+		auto fillFeedback = [&] {
+			/* The view scrolls a little every frame so some pages are always missing */
+			for (uint32_t y = 0; y < feedbackHeight; ++y)
+				for (uint32_t x = 0; x < feedbackWidth; ++x) {
+					uint32_t mip = y * 4 / feedbackHeight;
+					feedback[y * feedbackWidth + x] = PackPageId({ mip, ((x + static_cast<uint32_t>(frame)) * 2) >> mip, (y * 4) >> mip });
+				}
+		};
+
+		double feedbackSeconds = BestSeconds(iterations, [&] {
+			fillFeedback();
+			manager.ProcessFeedback(feedback.data(), feedback.size(), frame);
+			manager.Update(frame, 64);
+			++frame;
+		});
+		std::vector<IndirectionEntry> indirection;
+		double indirectionSeconds = BestSeconds(iterations, [&] {
+			manager.GetPageTable().BuildIndirection(0, desc.poolWidthInPages, indirection);
+		});
+
+		const PageManagerStats& stats = manager.GetStats();
+		printf("\n%u feedback entries, %u requested, %u uploaded, %u resident\n", static_cast<uint32_t>(feedback.size()),
+			stats.requestedPages, stats.uploadedPages, stats.residentPages);
+		printf("%-40s %10.1f us\n", "ProcessFeedback + Update", feedbackSeconds * 1e6);
+		printf("%-40s %10.1f us\n", "BuildIndirection, mip 0 (1024x1024)", indirectionSeconds * 1e6);
+	}
+}
+
+int main(int argc, char** argv) {
+	int iterations = argc > 1 ? std::max(1, atoi(argv[1])) : 20;
+	bool passed = RunChecks();
+	RunTimings(iterations);
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+/* Specialised through defines set to 0 or 1, see ShaderPermutations.h for the feature bits */
+#ifndef TEXTURED
+#define TEXTURED 0
+#endif
+#ifndef VERTEX_COLOR
+#define VERTEX_COLOR 0
+#endif
+
+/* Split by update frequency, see ShaderConstants.h for the C++ side */
+cbuffer FrameConstants : register(b0)
+{
+    float TimeSec;
+    float DeltaTimeSec;
+};
+
+cbuffer ViewConstants : register(b1)
+{
+    float4x4 ViewProj;
+    float3 CameraPosition;
+};
+
+cbuffer MaterialConstants : register(b2)
+{
+    float4 BaseColor;
+};
+
+cbuffer ObjectConstants : register(b3)
+{
+    uint FirstTransform;
+};
+
+/* Every object transform of the frame, indexed by FirstTransform + SV_InstanceID */
+struct ObjectTransform {
+    row_major float3x4 world;
+};
+StructuredBuffer<ObjectTransform> ObjectTransforms : register(t1);
+
+struct VS_Input {
+    float2 pos : POS;
+#if TEXTURED
+    float2 uv : TEX;
+#endif
+#if VERTEX_COLOR
+    float4 color : COL;
+#endif
+};
+
+struct VS_Output {
+    float4 pos : SV_POSITION;
+#if TEXTURED
+    float2 uv : TEXCOORD;
+#endif
+#if VERTEX_COLOR
+    float4 color : COL;
+#endif
+};
+
+#if TEXTURED
+Texture2D    mytexture : register(t0);
+SamplerState mysampler : register(s0);
+#endif
+
+VS_Output vs_main(VS_Input input, uint instanceId : SV_InstanceID)
+{
+    VS_Output output;
+    float3 worldPos = mul(ObjectTransforms[FirstTransform + instanceId].world, float4(input.pos, 0.0f, 1.0f));
+    output.pos = mul(float4(worldPos, 1.0f), ViewProj);
+#if TEXTURED
+    output.uv = input.uv;
+#endif
+#if VERTEX_COLOR
+    output.color = input.color;
+#endif
+    return output;
+}
+
+float4 ps_main(VS_Output input) : SV_Target
+{
+    float4 color = BaseColor;
+#if TEXTURED
+    color *= mytexture.Sample(mysampler, input.uv);
+#endif
+#if VERTEX_COLOR
+    color *= input.color;
+#endif
+    return color;
+}
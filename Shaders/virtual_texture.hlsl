@@ -0,0 +1,63 @@
+cbuffer constants : register(b0)
+{
+    float4x4 ModelViewProj;
+};
+
+cbuffer virtualTexture : register(b1)
+{
+    float2 VirtualSizeInPages; // mip 0
+    float2 PoolSizeInPages;
+    float PageSizeTexels;
+    float MaxMip;
+    uint FeedbackDownscale; // the feedback buffer is 1/N of the render target in each dimension
+    uint _padding;
+};
+
+struct VS_Input {
+    float2 pos : POS;
+    float2 uv : TEX;
+};
+
+struct VS_Output {
+    float4 pos : SV_POSITION;
+    float2 uv : TEXCOORD;
+};
+
+Texture2D<uint4> indirection : register(t0); // one texel per page, full mip chain
+Texture2D pagePool : register(t1);
+SamplerState poolSampler : register(s0);
+RWTexture2D<uint> feedback : register(u1); // u0 is taken by the render target
+
+VS_Output vs_main(VS_Input input)
+{
+    VS_Output output;
+    output.pos = mul(float4(input.pos, 0.0f, 1.0f), ModelViewProj);
+    output.uv = input.uv;
+    return output;
+}
+
+float4 ps_main(VS_Output input) : SV_Target
+{
+    /* Mip the hardware would pick if the whole virtual texture was resident */
+    float2 texelCoord = input.uv * VirtualSizeInPages * PageSizeTexels;
+    float2 dx = ddx(texelCoord);
+    float2 dy = ddy(texelCoord);
+    float mip = clamp(floor(0.5f * log2(max(dot(dx, dx), dot(dy, dy)))), 0.0f, MaxMip);
+
+    uint2 page = (uint2)(saturate(input.uv) * VirtualSizeInPages / exp2(mip));
+    page = min(page, (uint2)max(VirtualSizeInPages / exp2(mip), 1.0f) - 1);
+
+    /* Packed as mip:8 | y:12 | x:12, must match PackPageId in VirtualTexture.h */
+    uint2 screenPos = (uint2)input.pos.xy;
+    if (all(screenPos % FeedbackDownscale == 0))
+        feedback[screenPos / FeedbackDownscale] = ((uint)mip << 24) | ((page.y & 0xFFF) << 12) | (page.x & 0xFFF);
+
+    /* The indirection texture already points at the finest resident ancestor of this page */
+    uint4 entry = indirection.Load(int3(page, (int)mip));
+    if (entry.w == 0)
+        return float4(1.0f, 0.0f, 1.0f, 1.0f);
+
+    float2 pageUV = frac(input.uv * VirtualSizeInPages / exp2((float)entry.z));
+    float2 poolUV = (float2(entry.xy) + pageUV) / PoolSizeInPages;
+    return pagePool.SampleLevel(poolSampler, poolUV, 0);
+}
@@ -28,6 +28,13 @@ union float4x4
     }
 };
 
+// Affine transform without the constant last column of a float4x4: row i holds column i of the
+// matrix (rows are m[i] of the float4x4), so the shader computes mul(transform, float4(pos, 1))
+struct float3x4
+{
+    float m[3][4];
+};
+
 inline float degreesToRadians(float degs) {
     return degs * ((float)M_PI / 180.0f);
 }
@@ -148,3 +155,12 @@ inline float4x4 operator* (float4x4 a, float4x4 b)
         dot(a.row(3), b.cols[3]),
     };
 }
+
+inline float3x4 toFloat3x4(const float4x4& mat)
+{
+    return {
+        mat.m[0][0], mat.m[0][1], mat.m[0][2], mat.m[0][3],
+        mat.m[1][0], mat.m[1][1], mat.m[1][2], mat.m[1][3],
+        mat.m[2][0], mat.m[2][1], mat.m[2][2], mat.m[2][3],
+    };
+}
@@ -8,10 +8,12 @@ namespace awesome {
 	{
 	public:
 		Camera(InputManager*);
-		void UpdateCamera(unsigned long long deltaTimeMs);
-		void UpdatePerspectiveMatrix(float windowAspectRatio);
+		/* One fixed simulation step; the view matrix is only built by Interpolate */
+		void UpdateCamera(float deltaTimeSec);
+		/* Blends the previous and the latest step for rendering, alpha 0 is the previous one */
+		void Interpolate(float alpha);
 		float4x4& GetViewMatrix();
-		float4x4& GetPerspectiveMatrix();
+		const float3& GetPosition() const { return cameraPos; }
 
 	private:
 		InputManager* inputManager;
@@ -20,8 +22,10 @@ namespace awesome {
 		float3 cameraFwd = { 0, 0, -1 };
 		float cameraPitch{ 0.f };
 		float cameraYaw{ 0.f };
+		float3 previousPos = cameraPos;
+		float previousPitch{ 0.f };
+		float previousYaw{ 0.f };
 
-		float4x4 perspectiveMatrix{};
 		float4x4 viewMatrix{};
 
 		const float CAM_MOVE_SPEED{ 5.f }; // in metres per second
@@ -0,0 +1,162 @@
+#include "Clock.h"
+#include <chrono>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define AWESOME_HAS_RDTSC 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+#else
+#define AWESOME_HAS_RDTSC 0
+#endif
+
+namespace awesome {
+
+	namespace {
+		struct ClockState {
+			ClockBackend backend;
+			unsigned long long ticksPerSec;
+		};
+
+		ClockState SelectClock() {
+#ifdef _WIN32
+			LARGE_INTEGER frequency;
+			if (QueryPerformanceFrequency(&frequency) && frequency.QuadPart > 0)
+				return { ClockBackend::Qpc, static_cast<unsigned long long>(frequency.QuadPart) };
+#elif defined(CLOCK_MONOTONIC_RAW)
+			timespec now;
+			if (clock_gettime(CLOCK_MONOTONIC_RAW, &now) == 0)
+				return { ClockBackend::MonotonicRaw, 1000000000ULL };
+#endif
+			return { ClockBackend::SteadyClock, 1000000000ULL };
+		}
+
+		const ClockState& GetClockState() {
+			static const ClockState state = SelectClock();
+			return state;
+		}
+
+		unsigned long long QuerySteadyClockNs() {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+#if AWESOME_HAS_RDTSC
+		bool HasInvariantTsc() {
+			unsigned int regs[4] = {};
+#ifdef _MSC_VER
+			int cpuInfo[4];
+			__cpuid(cpuInfo, 0x80000000);
+			if (static_cast<unsigned int>(cpuInfo[0]) < 0x80000007)
+				return false;
+			__cpuid(cpuInfo, 0x80000007);
+			regs[3] = static_cast<unsigned int>(cpuInfo[3]);
+#else
+			if (__get_cpuid_max(0x80000000, nullptr) < 0x80000007)
+				return false;
+			__get_cpuid(0x80000007, &regs[0], &regs[1], &regs[2], &regs[3]);
+#endif
+			return (regs[3] & (1u << 8)) != 0; // EDX bit 8: invariant TSC
+		}
+#endif
+
+		struct TscState {
+			bool enabled{ false };
+			unsigned long long ticksPerSec{ 0 };
+		};
+
+		TscState CalibrateTsc() {
+			TscState state;
+#if AWESOME_HAS_RDTSC
+			if (!HasInvariantTsc())
+				return state;
+
+			/* Count TSC ticks over a known stretch of the OS clock, the error is one OS clock read */
+			unsigned long long clockPerSec = Clock::QueryTicksPerSec();
+			unsigned long long clockTicks = clockPerSec * ProfileClock::CALIBRATION_MS / 1000;
+			unsigned long long clockStart = Clock::QueryTicks();
+			unsigned long long tscStart = __rdtsc();
+			unsigned long long clockEnd;
+			do {
+				clockEnd = Clock::QueryTicks();
+			} while (clockEnd - clockStart < clockTicks);
+			unsigned long long tscEnd = __rdtsc();
+
+			unsigned long long elapsedNs = TicksToNs(clockEnd - clockStart, clockPerSec);
+			if (elapsedNs == 0 || tscEnd <= tscStart)
+				return state;
+			state.ticksPerSec = static_cast<unsigned long long>(static_cast<double>(tscEnd - tscStart) * 1e9 / static_cast<double>(elapsedNs));
+			state.enabled = state.ticksPerSec > 0;
+#endif
+			return state;
+		}
+
+		const TscState& GetTscState() {
+			static const TscState state = CalibrateTsc();
+			return state;
+		}
+	}
+
+	const char* GetClockBackendName(ClockBackend backend) {
+		switch (backend) {
+		case ClockBackend::Qpc: return "QueryPerformanceCounter";
+		case ClockBackend::MonotonicRaw: return "CLOCK_MONOTONIC_RAW";
+		case ClockBackend::SteadyClock: return "steady_clock";
+		case ClockBackend::Tsc: return "invariant TSC";
+		}
+		return "unknown";
+	}
+
+	unsigned long long Clock::QueryTicks() {
+		switch (GetClockState().backend) {
+#ifdef _WIN32
+		case ClockBackend::Qpc: {
+			LARGE_INTEGER perfCount;
+			QueryPerformanceCounter(&perfCount);
+			return perfCount.QuadPart;
+		}
+#elif defined(CLOCK_MONOTONIC_RAW)
+		case ClockBackend::MonotonicRaw: {
+			timespec now;
+			clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+			return static_cast<unsigned long long>(now.tv_sec) * 1000000000ULL + static_cast<unsigned long long>(now.tv_nsec);
+		}
+#endif
+		default:
+			return QuerySteadyClockNs();
+		}
+	}
+
+	unsigned long long Clock::QueryTicksPerSec() {
+		return GetClockState().ticksPerSec;
+	}
+
+	ClockBackend Clock::GetBackend() {
+		return GetClockState().backend;
+	}
+
+	unsigned long long ProfileClock::QueryTicks() {
+#if AWESOME_HAS_RDTSC
+		if (GetTscState().enabled)
+			return __rdtsc();
+#endif
+		return Clock::QueryTicks();
+	}
+
+	unsigned long long ProfileClock::QueryTicksPerSec() {
+		const TscState& tsc = GetTscState();
+		return tsc.enabled ? tsc.ticksPerSec : Clock::QueryTicksPerSec();
+	}
+
+	ClockBackend ProfileClock::GetBackend() {
+		return GetTscState().enabled ? ClockBackend::Tsc : Clock::GetBackend();
+	}
+
+} // namespace awesome
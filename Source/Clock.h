@@ -0,0 +1,46 @@
+#pragma once
+
+namespace awesome {
+
+	enum class ClockBackend {
+		Qpc,          // QueryPerformanceCounter, Windows
+		MonotonicRaw, // clock_gettime(CLOCK_MONOTONIC_RAW), not slewed by NTP
+		SteadyClock,  // std::chrono::steady_clock, when neither of the above is available
+		Tsc           // rdtsc on a CPU with an invariant TSC, calibrated against the OS clock
+	};
+
+	const char* GetClockBackendName(ClockBackend backend);
+
+	/* Converts without overflowing ticks * 1e9, which happens after half an hour at 10 MHz */
+	inline unsigned long long TicksToNs(unsigned long long ticks, unsigned long long ticksPerSec) {
+		return ticks / ticksPerSec * 1000000000ULL + ticks % ticksPerSec * 1000000000ULL / ticksPerSec;
+	}
+
+	/*
+	 * The OS monotonic clock, for frame timing and anything that has to stay right across sleeps
+	 * and core migrations. The backend is picked on first use and never fails: if the preferred
+	 * one is unavailable the next is used.
+	 */
+	class Clock {
+	public:
+		static unsigned long long QueryTicks();
+		static unsigned long long QueryTicksPerSec();
+		static ClockBackend GetBackend();
+	};
+
+	/*
+	 * Timestamps for the profilers, where the clock is read twice per scope. Reads the TSC directly
+	 * when the CPU reports it invariant (constant rate, not stopped in deep C-states), which costs a
+	 * few nanoseconds instead of a QPC or vDSO call; the rate is measured against Clock on first
+	 * use, which takes about CALIBRATION_MS. Falls back to Clock on other CPUs.
+	 */
+	class ProfileClock {
+	public:
+		static constexpr unsigned int CALIBRATION_MS = 20;
+
+		static unsigned long long QueryTicks();
+		static unsigned long long QueryTicksPerSec();
+		static ClockBackend GetBackend();
+	};
+
+} // namespace awesome
@@ -0,0 +1,113 @@
+#include "CommandList.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cstdio>
+#include <tuple>
+
+namespace awesome {
+
+	void CommandList::Reset() {
+		commands.clear();
+		pipeline = UNKNOWN_STATE;
+		material = UNKNOWN_STATE;
+		mesh = UNKNOWN_STATE;
+		drawItems = 0;
+		draws = 0;
+		stateChanges = 0;
+	}
+
+	void CommandList::SetState(CommandType type, uint16_t handle, uint32_t& current) {
+		if (current == handle)
+			return;
+		current = handle;
+		commands.push_back({ type, handle, 0, 0, 0, 0 });
+		++stateChanges;
+	}
+
+	void CommandList::Draw(const DrawItem& item) {
+		if (item.vertexCount == 0 || item.instanceCount == 0)
+			return;
+		++drawItems;
+		SetState(CommandType::SetPipeline, item.pipeline, pipeline);
+		SetState(CommandType::SetMaterial, item.material, material);
+		SetState(CommandType::SetMesh, item.mesh, mesh);
+
+		/* Any state change in between would be the last command, so a Draw there has the same state */
+		if (!commands.empty()) {
+			Command& last = commands.back();
+			if (last.type == CommandType::Draw && last.vertexCount == item.vertexCount && last.firstVertex == item.firstVertex
+				&& last.firstTransform + last.instanceCount == item.firstTransform) {
+				last.instanceCount += item.instanceCount;
+				return;
+			}
+		}
+		commands.push_back({ CommandType::Draw, 0, item.vertexCount, item.firstVertex, item.firstTransform, item.instanceCount });
+		++draws;
+	}
+
+	void HeadlessCommandBackend::BeginFrame(uint32_t batchCount) {
+		/* Only grows, so recording threads never see the vector move */
+		if (batches.size() < batchCount)
+			batches.resize(batchCount);
+	}
+
+	void HeadlessCommandBackend::Record(uint32_t batch, const CommandList& commands) {
+		batches[batch] = commands.GetCommands();
+	}
+
+	void HeadlessCommandBackend::Execute(uint32_t batchCount) {
+		for (uint32_t batch = 0; batch < batchCount; ++batch)
+			executed.insert(executed.end(), batches[batch].begin(), batches[batch].end());
+	}
+
+	void CommandRecorder::Submit(const DrawItem* items, uint32_t count, JobSystem& jobSystem) {
+		uint32_t batchCount = GetBatchCount(count, jobSystem.GetThreadCount());
+		uint32_t perBatch = batchCount > 0 ? (count + batchCount - 1) / batchCount : 0;
+		backend.BeginFrame(batchCount);
+		jobSystem.ParallelFor(batchCount, 1, [this, items, count, perBatch](uint32_t firstBatch, uint32_t endBatch) {
+			for (uint32_t batch = firstBatch; batch < endBatch; ++batch) {
+				CommandList& list = lists[batch];
+				list.Reset();
+				uint32_t end = std::min(count, (batch + 1) * perBatch);
+				for (uint32_t i = batch * perBatch; i < end; ++i)
+					list.Draw(items[i]);
+				backend.Record(batch, list);
+			}
+		});
+		backend.Execute(batchCount);
+
+		++stats.frames;
+		stats.batches += batchCount;
+		for (uint32_t batch = 0; batch < batchCount; ++batch) {
+			stats.drawItems += lists[batch].GetDrawItemCount();
+			stats.draws += lists[batch].GetDrawCount();
+			stats.stateChanges += lists[batch].GetStateChangeCount();
+		}
+	}
+
+	uint32_t CommandRecorder::GetBatchCount(uint32_t count, uint32_t threadCount) const {
+		if (count == 0)
+			return 0;
+		uint32_t batchCount = std::min({ count / MIN_DRAWS_PER_BATCH, threadCount, MAX_BATCHES, backend.GetMaxBatchCount() });
+		if (batchCount <= 1)
+			return 1;
+		/* Rounding the batch size up can leave the last batches empty */
+		uint32_t perBatch = (count + batchCount - 1) / batchCount;
+		return (count + perBatch - 1) / perBatch;
+	}
+
+	void CommandRecorder::FormatStats(char* buffer, size_t bufferSize) const {
+		double frames = stats.frames > 0 ? static_cast<double>(stats.frames) : 1.0;
+		snprintf(buffer, bufferSize, "Command recording over %llu frames: %.1f draw items as %.1f draws, %.1f state changes, %.1f batches per frame\n",
+			static_cast<unsigned long long>(stats.frames), stats.drawItems / frames, stats.draws / frames,
+			stats.stateChanges / frames, stats.batches / frames);
+	}
+
+	void SortByState(std::vector<DrawItem>& items) {
+		std::stable_sort(items.begin(), items.end(), [](const DrawItem& a, const DrawItem& b) {
+			return std::tie(a.pipeline, a.material, a.mesh, a.firstVertex, a.firstTransform)
+				< std::tie(b.pipeline, b.material, b.mesh, b.firstVertex, b.firstTransform);
+		});
+	}
+
+} // namespace awesome
@@ -0,0 +1,143 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace awesome {
+
+	class JobSystem;
+
+	/* Indices into the backend's tables, what they stand for is up to the backend */
+	using PipelineHandle = uint16_t; // shaders and input layout
+	using MaterialHandle = uint16_t; // textures and samplers
+	using MeshHandle = uint16_t;     // vertex buffer
+
+	/* One object to draw: instanceCount instances whose transforms start at firstTransform in the frame's transform buffer */
+	struct DrawItem {
+		PipelineHandle pipeline{ 0 };
+		MaterialHandle material{ 0 };
+		MeshHandle mesh{ 0 };
+		uint32_t vertexCount{ 0 };
+		uint32_t firstVertex{ 0 };
+		uint32_t firstTransform{ 0 };
+		uint32_t instanceCount{ 1 };
+	};
+
+	enum class CommandType : uint8_t {
+		SetPipeline,
+		SetMaterial,
+		SetMesh,
+		Draw
+	};
+
+	struct Command {
+		CommandType type;
+		uint16_t handle;         // Set commands
+		uint32_t vertexCount;    // Draw from here on
+		uint32_t firstVertex;
+		uint32_t firstTransform;
+		uint32_t instanceCount;
+	};
+
+	/*
+	 * Draw items recorded as backend-neutral commands. A list starts from unknown state, like a
+	 * deferred context, and only records the state a draw changes. A draw with the same state and
+	 * vertex range as the one before it, whose transforms follow on from that draw's, extends it
+	 * into one instanced draw instead of adding a command.
+	 */
+	class CommandList {
+	public:
+		/* Keeps the capacity */
+		void Reset();
+		void Draw(const DrawItem& item);
+
+		const std::vector<Command>& GetCommands() const { return commands; }
+		uint32_t GetDrawItemCount() const { return drawItems; }
+		uint32_t GetDrawCount() const { return draws; }
+		uint32_t GetStateChangeCount() const { return stateChanges; }
+
+	private:
+		void SetState(CommandType type, uint16_t handle, uint32_t& current);
+
+		static constexpr uint32_t UNKNOWN_STATE = 0x10000;
+
+		std::vector<Command> commands;
+		uint32_t pipeline{ UNKNOWN_STATE };
+		uint32_t material{ UNKNOWN_STATE };
+		uint32_t mesh{ UNKNOWN_STATE };
+		uint32_t drawItems{ 0 };
+		uint32_t draws{ 0 };
+		uint32_t stateChanges{ 0 };
+	};
+
+	/* Turns command lists into API work */
+	class CommandListBackend {
+	public:
+		virtual ~CommandListBackend() = default;
+		/* Batches it can record at the same time, a frame is split into at most this many */
+		virtual uint32_t GetMaxBatchCount() const = 0;
+		/* Render thread, before any batch of the frame is recorded */
+		virtual void BeginFrame(uint32_t batchCount) = 0;
+		/* Any thread, each batch of a frame exactly once, different batches at the same time */
+		virtual void Record(uint32_t batch, const CommandList& commands) = 0;
+		/* Render thread, once every batch was recorded; runs the batches in order */
+		virtual void Execute(uint32_t batchCount) = 0;
+	};
+
+	/* Executes into memory: the commands of every batch, in order, the way a GPU would receive them */
+	class HeadlessCommandBackend : public CommandListBackend {
+	public:
+		uint32_t GetMaxBatchCount() const override { return ~0u; }
+		void BeginFrame(uint32_t batchCount) override;
+		void Record(uint32_t batch, const CommandList& commands) override;
+		void Execute(uint32_t batchCount) override;
+
+		const std::vector<Command>& GetExecuted() const { return executed; }
+		void ClearExecuted() { executed.clear(); }
+
+	private:
+		std::vector<std::vector<Command>> batches;
+		std::vector<Command> executed;
+	};
+
+	struct CommandRecorderStats {
+		uint64_t frames{ 0 };
+		uint64_t drawItems{ 0 };
+		uint64_t draws{ 0 };        // after merging
+		uint64_t stateChanges{ 0 };
+		uint64_t batches{ 0 };
+	};
+
+	/*
+	 * Records a frame's draw items on the job system and executes them in the order given. The
+	 * items are split into contiguous batches, each recorded into its own command list by whichever
+	 * thread picks it up; the backend executes them by batch index, so the result never depends on
+	 * which thread finished first. A frame too small to be worth splitting is one batch recorded on
+	 * the calling thread. Draws only merge within a batch.
+	 */
+	class CommandRecorder {
+	public:
+		/* Every batch costs the backend a command list to build and execute */
+		static constexpr uint32_t MAX_BATCHES = 16;
+		static constexpr uint32_t MIN_DRAWS_PER_BATCH = 128;
+
+		explicit CommandRecorder(CommandListBackend& backend) : backend(backend) {}
+
+		/* Render thread */
+		void Submit(const DrawItem* items, uint32_t count, JobSystem& jobSystem);
+
+		const CommandRecorderStats& GetStats() const { return stats; }
+		void FormatStats(char* buffer, size_t bufferSize) const;
+
+	private:
+		uint32_t GetBatchCount(uint32_t count, uint32_t threadCount) const;
+
+		CommandListBackend& backend;
+		CommandList lists[MAX_BATCHES];
+		CommandRecorderStats stats;
+	};
+
+	/* Stable, so items with the same state keep their order; only for passes where draw order does not matter */
+	void SortByState(std::vector<DrawItem>& items);
+
+} // namespace awesome
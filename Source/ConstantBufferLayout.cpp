@@ -0,0 +1,35 @@
+#include "ConstantBufferLayout.h"
+#include <cassert>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define AWESOME_SIMD_X86 1
+#include <emmintrin.h>
+#endif
+
+/* MSVC lets any function use any intrinsic, GCC and Clang need to be told per function */
+#if defined(_MSC_VER) && !defined(__clang__)
+#define AWESOME_TARGET_SSE2
+#else
+#define AWESOME_TARGET_SSE2 __attribute__((target("sse2")))
+#endif
+
+namespace awesome {
+
+#if AWESOME_SIMD_X86
+	AWESOME_TARGET_SSE2 void StreamToMappedBuffer(void* dst, const void* src, size_t size) {
+		assert((reinterpret_cast<uintptr_t>(dst) & 15) == 0 && (reinterpret_cast<uintptr_t>(src) & 15) == 0 && (size & 15) == 0);
+		__m128i* out = static_cast<__m128i*>(dst);
+		const __m128i* in = static_cast<const __m128i*>(src);
+		for (size_t i = 0; i < size / 16; ++i)
+			_mm_stream_si128(out + i, _mm_load_si128(in + i));
+		/* Streaming stores are weakly ordered, make them visible before Unmap */
+		_mm_sfence();
+	}
+#else
+	void StreamToMappedBuffer(void* dst, const void* src, size_t size) {
+		assert((reinterpret_cast<uintptr_t>(dst) & 15) == 0 && (reinterpret_cast<uintptr_t>(src) & 15) == 0 && (size & 15) == 0);
+		memcpy(dst, src, size);
+	}
+#endif
+
+} // namespace awesome
@@ -0,0 +1,155 @@
+#pragma once
+#include "3DMaths.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace awesome {
+
+	/*
+	 * HLSL constant buffer packing, checked against the C++ struct at compile time. HLSL packs
+	 * fields into 16 byte registers: a field never straddles a register, and matrices, arrays and
+	 * structs always start a new one. Declare the struct in the same order as the cbuffer and list
+	 * its fields:
+	 *
+	 *     using FrameLayout = CBufferLayout<FrameConstants,
+	 *         AWESOME_CBUFFER_FIELD(FrameConstants, viewProj),
+	 *         AWESOME_CBUFFER_FIELD(FrameConstants, time)>;
+	 *
+	 * Any field whose C++ offset differs from the HLSL one, or a struct size that is not the
+	 * register-rounded HLSL size, fails to compile. Fill the gaps with explicit padding members.
+	 */
+
+	template<typename T> struct HlslTypeTraits;
+
+	template<> struct HlslTypeTraits<float> { static constexpr uint32_t SIZE = 4; static constexpr bool STARTS_REGISTER = false; };
+	template<> struct HlslTypeTraits<int32_t> { static constexpr uint32_t SIZE = 4; static constexpr bool STARTS_REGISTER = false; };
+	template<> struct HlslTypeTraits<uint32_t> { static constexpr uint32_t SIZE = 4; static constexpr bool STARTS_REGISTER = false; };
+	template<> struct HlslTypeTraits<float2> { static constexpr uint32_t SIZE = 8; static constexpr bool STARTS_REGISTER = false; };
+	template<> struct HlslTypeTraits<float3> { static constexpr uint32_t SIZE = 12; static constexpr bool STARTS_REGISTER = false; };
+	template<> struct HlslTypeTraits<float4> { static constexpr uint32_t SIZE = 16; static constexpr bool STARTS_REGISTER = false; };
+	template<> struct HlslTypeTraits<float4x4> { static constexpr uint32_t SIZE = 64; static constexpr bool STARTS_REGISTER = true; };
+
+	constexpr uint32_t CBUFFER_REGISTER_SIZE = 16;
+
+	constexpr uint32_t AlignToRegister(uint32_t offset) {
+		return (offset + CBUFFER_REGISTER_SIZE - 1) & ~(CBUFFER_REGISTER_SIZE - 1);
+	}
+
+	/*
+	 * An HLSL array: every element starts a register. The last element is not padded in HLSL,
+	 * so only a register aligned field (or nothing) may follow an array.
+	 */
+	template<typename T, uint32_t N>
+	struct CBufferArray {
+		struct alignas(16) Element {
+			T value;
+		};
+		Element elements[N];
+
+		T& operator[](uint32_t i) { return elements[i].value; }
+		const T& operator[](uint32_t i) const { return elements[i].value; }
+	};
+
+	template<typename T, uint32_t N> struct HlslTypeTraits<CBufferArray<T, N>> {
+		static constexpr uint32_t SIZE = AlignToRegister(HlslTypeTraits<T>::SIZE) * (N - 1) + HlslTypeTraits<T>::SIZE;
+		static constexpr bool STARTS_REGISTER = true;
+	};
+
+	template<typename T, size_t Offset>
+	struct CBufferField {
+		using Type = T;
+		static constexpr uint32_t OFFSET = static_cast<uint32_t>(Offset);
+	};
+
+#define AWESOME_CBUFFER_FIELD(Struct, member) ::awesome::CBufferField<decltype(Struct::member), offsetof(Struct, member)>
+
+	template<typename Struct, typename... Fields>
+	class CBufferLayout {
+	public:
+		static constexpr uint32_t FIELD_COUNT = sizeof...(Fields);
+		static_assert(FIELD_COUNT > 0, "A constant buffer needs at least one field");
+		static_assert(std::is_trivially_copyable_v<Struct> && std::is_standard_layout_v<Struct>, "Constant buffer structs must be plain data");
+
+	private:
+		static constexpr std::array<uint32_t, FIELD_COUNT> ComputeHlslOffsets() {
+			constexpr uint32_t sizes[] = { HlslTypeTraits<typename Fields::Type>::SIZE... };
+			constexpr bool startsRegister[] = { HlslTypeTraits<typename Fields::Type>::STARTS_REGISTER... };
+			std::array<uint32_t, FIELD_COUNT> offsets{};
+			uint32_t offset = 0;
+			for (uint32_t i = 0; i < FIELD_COUNT; ++i) {
+				uint32_t used = offset % CBUFFER_REGISTER_SIZE;
+				if (startsRegister[i] || (used != 0 && used + sizes[i] > CBUFFER_REGISTER_SIZE))
+					offset = AlignToRegister(offset);
+				offsets[i] = offset;
+				offset += sizes[i];
+			}
+			return offsets;
+		}
+
+		static constexpr uint32_t ComputeHlslSize() {
+			constexpr uint32_t sizes[] = { HlslTypeTraits<typename Fields::Type>::SIZE... };
+			return AlignToRegister(HLSL_OFFSETS[FIELD_COUNT - 1] + sizes[FIELD_COUNT - 1]);
+		}
+
+		static constexpr bool OffsetsMatch() {
+			constexpr uint32_t offsets[] = { Fields::OFFSET... };
+			for (uint32_t i = 0; i < FIELD_COUNT; ++i)
+				if (offsets[i] != HLSL_OFFSETS[i])
+					return false;
+			return true;
+		}
+
+	public:
+		using Type = Struct;
+		static constexpr std::array<uint32_t, FIELD_COUNT> HLSL_OFFSETS = ComputeHlslOffsets();
+		static constexpr uint32_t SIZE = ComputeHlslSize();
+
+		static_assert(OffsetsMatch(), "C++ field offsets do not follow HLSL packing, reorder the fields or add padding");
+		static_assert(sizeof(Struct) == SIZE, "C++ struct size differs from the HLSL cbuffer size rounded to 16 bytes");
+	};
+
+	/*
+	 * Copies whole registers into mapped (write-combined) memory with non-temporal stores,
+	 * so the CPU never reads the destination back. Both pointers must be 16 byte aligned
+	 * and size a multiple of 16, which Map and ConstantBufferShadow guarantee.
+	 */
+	void StreamToMappedBuffer(void* dst, const void* src, size_t size);
+
+	/*
+	 * A CPU copy of one constant buffer. Setting a field to the value it already has is a no-op,
+	 * so a buffer whose fields did not change stays clean and its Map can be skipped entirely.
+	 * A dirty buffer is uploaded whole: WRITE_DISCARD leaves the previous contents undefined.
+	 */
+	template<typename Layout>
+	class ConstantBufferShadow {
+	public:
+		using Struct = typename Layout::Type;
+
+		template<typename F>
+		void Set(F Struct::* field, const F& value) {
+			F& current = data.*field;
+			if (memcmp(&current, &value, sizeof(F)) == 0)
+				return;
+			current = value;
+			dirty = true;
+		}
+
+		const Struct& Get() const { return data; }
+		bool IsDirty() const { return dirty; }
+		/* For when the GPU buffer was recreated and lost its contents */
+		void MarkDirty() { dirty = true; }
+
+		void Upload(void* mapped) {
+			StreamToMappedBuffer(mapped, &data, Layout::SIZE);
+			dirty = false;
+		}
+
+	private:
+		alignas(16) Struct data{};
+		bool dirty{ true };
+	};
+
+} // namespace awesome
@@ -0,0 +1,131 @@
+#include "D3DCommandList.h"
+#include <d3d11.h>
+#include <assert.h>
+
+namespace awesome {
+
+	D3DCommandBackend::~D3DCommandBackend() {
+		for (Batch& batch : batches) {
+			if (batch.commandList)
+				batch.commandList->Release();
+			if (batch.context)
+				batch.context->Release();
+		}
+	}
+
+	bool D3DCommandBackend::Init(ID3D11Device* device, ID3D11DeviceContext* immediateContext, ID3D11Buffer* objectConstantBuffer) {
+		this->device = device;
+		this->immediateContext = immediateContext;
+		this->objectConstantBuffer = objectConstantBuffer;
+
+		D3D11_FEATURE_DATA_THREADING threading = {};
+		if (SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_THREADING, &threading, sizeof(threading))))
+			driverCommandLists = threading.DriverCommandLists != FALSE;
+
+		/* Created up front, a deferred context is too expensive to create during a frame */
+		for (Batch& batch : batches) {
+			if (FAILED(device->CreateDeferredContext(0, &batch.context)))
+				return false;
+			++deferredContextCount;
+		}
+		return true;
+	}
+
+	void D3DCommandBackend::SetPipeline(PipelineHandle handle, const D3DPipeline& pipeline) {
+		if (pipelines.size() <= handle)
+			pipelines.resize(handle + 1);
+		pipelines[handle] = pipeline;
+	}
+
+	void D3DCommandBackend::SetMaterial(MaterialHandle handle, const D3DMaterial& material) {
+		if (materials.size() <= handle)
+			materials.resize(handle + 1);
+		materials[handle] = material;
+	}
+
+	void D3DCommandBackend::SetMesh(MeshHandle handle, const D3DMesh& mesh) {
+		if (meshes.size() <= handle)
+			meshes.resize(handle + 1);
+		meshes[handle] = mesh;
+	}
+
+	void D3DCommandBackend::BeginFrame(uint32_t batchCount) {
+		recordImmediate = batchCount <= 1;
+	}
+
+	void D3DCommandBackend::Record(uint32_t batch, const CommandList& commands) {
+		if (recordImmediate) {
+			/* Called on the render thread, CommandRecorder records a single batch there */
+			Replay(immediateContext, immediateBatch, commands);
+			return;
+		}
+		Batch& target = batches[batch];
+		Replay(target.context, target, commands);
+		HRESULT hResult = target.context->FinishCommandList(FALSE, &target.commandList);
+		assert(SUCCEEDED(hResult));
+	}
+
+	void D3DCommandBackend::Execute(uint32_t batchCount) {
+		if (recordImmediate)
+			return;
+		/* Not restoring the immediate context's state after each list; everything after the pass binds its own */
+		for (uint32_t batch = 0; batch < batchCount; ++batch) {
+			Batch& source = batches[batch];
+			immediateContext->ExecuteCommandList(source.commandList, FALSE);
+			source.commandList->Release();
+			source.commandList = nullptr;
+		}
+	}
+
+	void D3DCommandBackend::ApplyPassState(ID3D11DeviceContext* context) {
+		D3D11_VIEWPORT viewport = { passState.viewport[0], passState.viewport[1], passState.viewport[2], passState.viewport[3], 0.0f, 1.0f };
+		context->RSSetViewports(1, &viewport);
+		context->RSSetState(passState.rasterizerState);
+		context->OMSetRenderTargets(1, &passState.renderTarget, nullptr);
+		context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		context->VSSetConstantBuffers(0, CBUFFER_SLOT_COUNT, passState.constantBuffers);
+		context->PSSetConstantBuffers(0, CBUFFER_SLOT_COUNT, passState.constantBuffers);
+		context->VSSetShaderResources(1, 1, &passState.transforms);
+	}
+
+	void D3DCommandBackend::Replay(ID3D11DeviceContext* context, Batch& batch, const CommandList& commands) {
+		ApplyPassState(context);
+		/* The buffer holds whatever the last list wrote, the first draw always uploads */
+		batch.objectConstants.MarkDirty();
+		for (const Command& command : commands.GetCommands()) {
+			switch (command.type) {
+			case CommandType::SetPipeline: {
+				const D3DPipeline& pipeline = pipelines[command.handle];
+				context->IASetInputLayout(pipeline.inputLayout);
+				context->VSSetShader(pipeline.vertexShader, nullptr, 0);
+				context->PSSetShader(pipeline.pixelShader, nullptr, 0);
+				break;
+			}
+			case CommandType::SetMaterial: {
+				const D3DMaterial& material = materials[command.handle];
+				context->PSSetShaderResources(0, 1, &material.texture);
+				context->PSSetSamplers(0, 1, &material.sampler);
+				break;
+			}
+			case CommandType::SetMesh: {
+				const D3DMesh& mesh = meshes[command.handle];
+				context->IASetVertexBuffers(0, 1, &mesh.vertexBuffer, &mesh.stride, &mesh.offset);
+				break;
+			}
+			case CommandType::Draw: {
+				batch.objectConstants.Set(&ObjectConstants::firstTransform, command.firstTransform);
+				if (batch.objectConstants.IsDirty()) {
+					D3D11_MAPPED_SUBRESOURCE mappedSubresource;
+					HRESULT hResult = context->Map(objectConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedSubresource);
+					assert(SUCCEEDED(hResult));
+					batch.objectConstants.Upload(mappedSubresource.pData);
+					context->Unmap(objectConstantBuffer, 0);
+				}
+				context->DrawInstanced(command.vertexCount, command.instanceCount, command.firstVertex, 0);
+				break;
+			}
+			}
+		}
+	}
+
+} // namespace awesome
@@ -0,0 +1,96 @@
+#pragma once
+#include "CommandList.h"
+#include "ShaderConstants.h"
+#include <vector>
+
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+struct ID3D11CommandList;
+struct ID3D11RenderTargetView;
+struct ID3D11RasterizerState;
+struct ID3D11InputLayout;
+struct ID3D11Buffer;
+struct ID3D11VertexShader;
+struct ID3D11PixelShader;
+struct ID3D11SamplerState;
+struct ID3D11ShaderResourceView;
+
+namespace awesome {
+
+	struct D3DPipeline {
+		ID3D11VertexShader* vertexShader{ nullptr };
+		ID3D11PixelShader* pixelShader{ nullptr };
+		ID3D11InputLayout* inputLayout{ nullptr };
+	};
+
+	struct D3DMaterial {
+		ID3D11ShaderResourceView* texture{ nullptr };
+		ID3D11SamplerState* sampler{ nullptr };
+	};
+
+	struct D3DMesh {
+		ID3D11Buffer* vertexBuffer{ nullptr };
+		unsigned int stride{ 0 };
+		unsigned int offset{ 0 };
+	};
+
+	/* Everything a pass binds once; a deferred context starts with nothing bound, so every batch sets it again */
+	struct D3DPassState {
+		ID3D11RenderTargetView* renderTarget{ nullptr };
+		float viewport[4]{};  // x, y, width, height, depth 0 to 1
+		ID3D11RasterizerState* rasterizerState{ nullptr };
+		ID3D11Buffer* constantBuffers[CBUFFER_SLOT_COUNT]{};
+		ID3D11ShaderResourceView* transforms{ nullptr };
+	};
+
+	/*
+	 * Records every batch into a deferred context of its own and executes the finished command
+	 * lists on the immediate context in batch order. A frame of one batch is recorded straight into
+	 * the immediate context. The per-draw first transform goes into the object constant buffer,
+	 * mapped with WRITE_DISCARD on the recording context, which D3D11 allows on deferred contexts.
+	 * Without driver command lists the runtime emulates them: recording still runs in parallel,
+	 * but executing costs about as much as recording on the immediate context would have.
+	 * The tables and pass state are set on the render thread between frames. Frames are split into
+	 * as many batches as there are deferred contexts, none at all if they could not be created.
+	 */
+	class D3DCommandBackend : public CommandListBackend {
+	public:
+		~D3DCommandBackend() override;
+		bool Init(ID3D11Device* device, ID3D11DeviceContext* immediateContext, ID3D11Buffer* objectConstantBuffer);
+		bool HasDriverCommandLists() const { return driverCommandLists; }
+		uint32_t GetMaxBatchCount() const override { return deferredContextCount; }
+
+		void SetPassState(const D3DPassState& state) { passState = state; }
+		void SetPipeline(PipelineHandle handle, const D3DPipeline& pipeline);
+		void SetMaterial(MaterialHandle handle, const D3DMaterial& material);
+		void SetMesh(MeshHandle handle, const D3DMesh& mesh);
+
+		void BeginFrame(uint32_t batchCount) override;
+		void Record(uint32_t batch, const CommandList& commands) override;
+		void Execute(uint32_t batchCount) override;
+
+	private:
+		struct Batch {
+			ID3D11DeviceContext* context{ nullptr };
+			ID3D11CommandList* commandList{ nullptr };
+			ConstantBufferShadow<ObjectConstantsLayout> objectConstants;
+		};
+
+		void ApplyPassState(ID3D11DeviceContext* context);
+		void Replay(ID3D11DeviceContext* context, Batch& batch, const CommandList& commands);
+
+		ID3D11Device* device{ nullptr };
+		ID3D11DeviceContext* immediateContext{ nullptr };
+		ID3D11Buffer* objectConstantBuffer{ nullptr };
+		bool driverCommandLists{ false };
+		uint32_t deferredContextCount{ 0 };
+		bool recordImmediate{ false };  // this frame is a single batch
+		D3DPassState passState;
+		std::vector<D3DPipeline> pipelines;
+		std::vector<D3DMaterial> materials;
+		std::vector<D3DMesh> meshes;
+		Batch immediateBatch;
+		Batch batches[CommandRecorder::MAX_BATCHES];
+	};
+
+} // namespace awesome
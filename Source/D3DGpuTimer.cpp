@@ -0,0 +1,73 @@
+#include "D3DGpuTimer.h"
+#include <d3d11.h>
+
+namespace awesome {
+
+	D3DGpuTimerBackend::~D3DGpuTimerBackend() {
+		ReleaseQueries();
+	}
+
+	void D3DGpuTimerBackend::SetDevice(ID3D11Device* device, ID3D11DeviceContext* context) {
+		this->device = device;
+		this->context = context;
+	}
+
+	void D3DGpuTimerBackend::ReleaseQueries() {
+		for (ID3D11Query* query : disjointQueries)
+			if (query)
+				query->Release();
+		for (ID3D11Query* query : timestampQueries)
+			if (query)
+				query->Release();
+		disjointQueries.clear();
+		timestampQueries.clear();
+	}
+
+	bool D3DGpuTimerBackend::CreateQueries(uint32_t frameSlots, uint32_t timestampsPerFrame) {
+		ReleaseQueries();
+		if (!device)
+			return false;
+		this->timestampsPerFrame = timestampsPerFrame;
+		disjointQueries.assign(frameSlots, nullptr);
+		timestampQueries.assign(static_cast<size_t>(frameSlots) * timestampsPerFrame, nullptr);
+
+		D3D11_QUERY_DESC disjointDesc = { D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+		D3D11_QUERY_DESC timestampDesc = { D3D11_QUERY_TIMESTAMP, 0 };
+		for (ID3D11Query*& query : disjointQueries)
+			if (FAILED(device->CreateQuery(&disjointDesc, &query)))
+				return false;
+		for (ID3D11Query*& query : timestampQueries)
+			if (FAILED(device->CreateQuery(&timestampDesc, &query)))
+				return false;
+		return true;
+	}
+
+	void D3DGpuTimerBackend::BeginFrame(uint32_t slot) {
+		context->Begin(disjointQueries[slot]);
+	}
+
+	void D3DGpuTimerBackend::WriteTimestamp(uint32_t slot, uint32_t index) {
+		context->End(timestampQueries[slot * timestampsPerFrame + index]);
+	}
+
+	void D3DGpuTimerBackend::EndFrame(uint32_t slot) {
+		context->End(disjointQueries[slot]);
+	}
+
+	bool D3DGpuTimerBackend::TryReadFrame(uint32_t slot, uint32_t timestampCount, uint64_t* timestamps, uint64_t& frequency, bool& disjoint) {
+		/* The disjoint query ends after every timestamp, once it is done they all are */
+		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjointData;
+		if (context->GetData(disjointQueries[slot], &disjointData, sizeof(disjointData), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+			return false;
+		for (uint32_t i = 0; i < timestampCount; ++i) {
+			UINT64 timestamp;
+			if (context->GetData(timestampQueries[slot * timestampsPerFrame + i], &timestamp, sizeof(timestamp), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+				return false;
+			timestamps[i] = timestamp;
+		}
+		frequency = disjointData.Frequency;
+		disjoint = disjointData.Disjoint != FALSE;
+		return true;
+	}
+
+} // namespace awesome
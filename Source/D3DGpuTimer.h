@@ -0,0 +1,33 @@
+#pragma once
+#include "GpuTimer.h"
+#include <vector>
+
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+struct ID3D11Query;
+
+namespace awesome {
+
+	/* Disjoint and timestamp queries on a D3D11 device, read back with DONOTFLUSH so reads never block */
+	class D3DGpuTimerBackend : public GpuTimerBackend {
+	public:
+		~D3DGpuTimerBackend() override;
+		void SetDevice(ID3D11Device* device, ID3D11DeviceContext* context);
+
+		bool CreateQueries(uint32_t frameSlots, uint32_t timestampsPerFrame) override;
+		void BeginFrame(uint32_t slot) override;
+		void WriteTimestamp(uint32_t slot, uint32_t index) override;
+		void EndFrame(uint32_t slot) override;
+		bool TryReadFrame(uint32_t slot, uint32_t timestampCount, uint64_t* timestamps, uint64_t& frequency, bool& disjoint) override;
+
+	private:
+		void ReleaseQueries();
+
+		ID3D11Device* device{ nullptr };
+		ID3D11DeviceContext* context{ nullptr };
+		uint32_t timestampsPerFrame{ 0 };
+		std::vector<ID3D11Query*> disjointQueries;
+		std::vector<ID3D11Query*> timestampQueries; // slot * timestampsPerFrame + index
+	};
+
+} // namespace awesome
@@ -2,85 +2,149 @@
 
 #include <windows.h>
 #include <d3d11_1.h>
-#include <d3dcompiler.h>
 #include <assert.h>
+#include <stdio.h>
+#include <chrono>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
-#include "TimeManager.h"
-#include "InputManager.h"
-#include "Camera.h"
+#include "VertexFormat.h"
+#include "TransformBuffer.h"
+#include "Profiler.h"
+#include "LatencyTracker.h"
+#include "JobSystem.h"
 
 namespace awesome {
 
-    /* elements need to be 16-byte aligned */
-    struct Constants
-    {
-        float4x4 modelViewProj;
-    };
+    constexpr unsigned long long TEXTURE_BUDGET_BYTES = 256ULL * 1024 * 1024;
+    constexpr UINT MAX_OBJECT_TRANSFORMS = 65536;
+    constexpr float VERTICAL_FOV_DEGREES = 84.0f;
+    constexpr float NEAR_PLANE = 0.1f;
+    constexpr float FAR_PLANE = 1000.0f;
+
+    /* Handles into the command backend's tables */
+    constexpr PipelineHandle SURFACE_PIPELINE = 0;
+    constexpr PipelineHandle FALLBACK_PIPELINE = 1;
+    constexpr MaterialHandle SURFACE_MATERIAL = 0;
+    constexpr MeshHandle QUAD_MESH = 0;
+
+    /* The UVs only need 0..1 at texel precision, half floats halve their size */
+    using SurfaceVertexFormat = VertexFormat<Pos<float2>, Tex<half2>>;
+
+    DXGI_FORMAT GetDxgiFormat(VertexElementFormat format) {
+        switch (format) {
+        case VertexElementFormat::Float2: return DXGI_FORMAT_R32G32_FLOAT;
+        case VertexElementFormat::Float3: return DXGI_FORMAT_R32G32B32_FLOAT;
+        case VertexElementFormat::Float4: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+        case VertexElementFormat::Half2: return DXGI_FORMAT_R16G16_FLOAT;
+        case VertexElementFormat::Half4: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+        case VertexElementFormat::UNorm8x4: return DXGI_FORMAT_R8G8B8A8_UNORM;
+        }
+        return DXGI_FORMAT_UNKNOWN;
+    }
+
+    template<typename Format>
+    std::array<D3D11_INPUT_ELEMENT_DESC, Format::ELEMENT_COUNT> MakeInputElementDescs() {
+        std::array<D3D11_INPUT_ELEMENT_DESC, Format::ELEMENT_COUNT> descs;
+        for (uint32_t i = 0; i < Format::ELEMENT_COUNT; ++i) {
+            const VertexElementDesc& element = Format::ELEMENTS[i];
+            descs[i] = { element.semantic, element.semanticIndex, GetDxgiFormat(element.format), 0, element.offset, D3D11_INPUT_PER_VERTEX_DATA, 0 };
+        }
+        return descs;
+    }
 
-    void D3DRenderer::Init(HWND windowHandle, TimeManager* timeManager, InputManager* inputManager, Camera* camera) {
+    void D3DRenderer::Init(HWND windowHandle, LatencyTracker* latencyTracker, JobSystem* jobSystem) {
+        PROFILE_SCOPE("D3DRenderer::Init");
         this->windowHandle = windowHandle;
-        this->timeManager = timeManager;
-        this->inputManager = inputManager;
-        this->camera = camera;
+        this->latencyTracker = latencyTracker;
+        this->jobSystem = jobSystem;
         RegisterDirect3DDevice();
         SetupDebugLayer();
+        gpuTimerBackend.SetDevice(d3d11Device, d3d11DeviceContext);
+        if (!gpuProfiler.Init())
+            OutputDebugStringA("GPU timestamp queries unavailable, GPU timings disabled\n");
         CreateSwapChain();
         CreateFrameBuffer();
-        ID3DBlob* vsBlob = CreateVertexShader();
-        CreatePixelShader();
-        CreateInputLayout(vsBlob);
+        LoadShaderPack();
         CreateVertexBuffer();
         LoadTextures();
         CreateSamplerState();
-        CreateConstantBuffer();
+        CreateConstantBuffers();
+        CreateTransformBuffer();
         CreateRasterizerState();
+        CreateCommandBackend();
     }
 
-    void D3DRenderer::Render(unsigned long long deltaTimeMs) {
+    void D3DRenderer::Render(const FrameSnapshot& snapshot) {
+        PROFILE_SCOPE("D3DRenderer::Render");
         CheckWindowResize();
-        camera->UpdateCamera(deltaTimeMs);
-        
-        float4x4 modelMat = rotateYMat(0.0002f * static_cast<float>(M_PI * timeManager->GetCurrentTimeMs())); // Spin the quad
-        float4x4 modelViewProj = modelMat * camera->GetViewMatrix() * camera->GetPerspectiveMatrix();
-        {
-            D3D11_MAPPED_SUBRESOURCE mappedSubresource;
-            d3d11DeviceContext->Map(constantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedSubresource);
-            Constants* constants = (Constants*)(mappedSubresource.pData);
-            constants->modelViewProj = modelViewProj;
-            d3d11DeviceContext->Unmap(constantBuffer, 0);
-        }
+        gpuProfiler.BeginFrame();
+
+        frameConstants.Set(&FrameConstants::timeSec, static_cast<float>(snapshot.timeSec));
+        frameConstants.Set(&FrameConstants::deltaTimeSec, static_cast<float>(snapshot.deltaTimeSec));
+        UploadConstants(constantBuffers[CBUFFER_SLOT_FRAME], frameConstants);
+
+        viewConstants.Set(&ViewConstants::viewProj, snapshot.viewMatrix * perspectiveMatrix);
+        viewConstants.Set(&ViewConstants::cameraPosition, snapshot.cameraPosition);
+        UploadConstants(constantBuffers[CBUFFER_SLOT_VIEW], viewConstants);
+
+        materialConstants.Set(&MaterialConstants::baseColor, float4{ 1.0f, 1.0f, 1.0f, 1.0f });
+        UploadConstants(constantBuffers[CBUFFER_SLOT_MATERIAL], materialConstants);
+
+        UploadObjectTransforms(snapshot.objectTransforms);
         FLOAT backgroundColor[4] = { 0.1f, 0.2f, 0.6f, 1.0f };
+        gpuProfiler.BeginPass("Clear");
         d3d11DeviceContext->ClearRenderTargetView(d3d11FrameBufferView, backgroundColor);
+        gpuProfiler.EndPass();
 
         RECT winRect;
         GetClientRect(windowHandle, &winRect);
         D3D11_VIEWPORT viewport = { 0.0f, 0.0f, (FLOAT)(winRect.right - winRect.left), (FLOAT)(winRect.bottom - winRect.top), 0.0f, 1.0f };
 
-        d3d11DeviceContext->RSSetViewports(1, &viewport);
-        d3d11DeviceContext->RSSetState(rasterizerState);
-
-        d3d11DeviceContext->OMSetRenderTargets(1, &d3d11FrameBufferView, nullptr);
-        d3d11DeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        d3d11DeviceContext->IASetInputLayout(inputLayout);
-
-        d3d11DeviceContext->VSSetShader(vertexShader, nullptr, 0);
-        d3d11DeviceContext->PSSetShader(pixelShader, nullptr, 0);
+        gpuProfiler.BeginPass("Surface");
+        /* Never wait for a compile: draw with the fallback, or not at all, until the shaders are ready */
+        DrawShaderChoice shaderChoice = UpdateSurfaceShaders();
+        SubmitDraws(static_cast<uint32_t>(snapshot.objectTransforms.size()), shaderChoice, viewport.Width, viewport.Height);
+        gpuProfiler.EndPass();
+        gpuProfiler.EndFrame();
+        UpdateTextureResidency(viewport.Width * viewport.Height);
 
-        d3d11DeviceContext->VSSetConstantBuffers(0, 1, &constantBuffer);
-        d3d11DeviceContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-
-        d3d11DeviceContext->PSSetShaderResources(0, 1, &textureView);
-        d3d11DeviceContext->PSSetSamplers(0, 1, &samplerState);
+        latencyTracker->OnSubmitted(snapshot.frame);
+        {
+            PROFILE_SCOPE("Present");
+            d3d11SwapChain->Present(1, 0);
+        }
+        latencyTracker->OnPresented();
+        ++frameIndex;
+    }
 
-        d3d11DeviceContext->Draw(numVerts, 0);
+    void D3DRenderer::UpdateTextureResidency(float coveredPixels) {
+        textureResidency.MarkUsed(textureHandle, frameIndex, coveredPixels);
+        residencyChanges.clear();
+        textureResidency.Update(frameIndex, residencyChanges);
+        if (residencyChanges.empty())
+            return;
+
+        for (const ResidencyChange& change : residencyChanges) {
+            if (change.texture != textureHandle)
+                continue;
+            /* The texture is immutable with a single mip, so it can only go away completely or come back */
+            if (change.topMip > 0 && textureView) {
+                textureView->Release();
+                textureView = nullptr;
+            }
+            else if (change.topMip == 0 && !textureView) {
+                CreateTextureView();
+            }
+        }
 
-        d3d11SwapChain->Present(1, 0);
+        char statsLine[256];
+        textureResidency.FormatStats(statsLine, sizeof(statsLine));
+        OutputDebugStringA(statsLine);
     }    
 
     void D3DRenderer::CheckWindowResize() {
-        if (windowResized)
+        if (windowResized.exchange(false)) // cleared first, a resize arriving meanwhile is picked up next frame
         {
             d3d11DeviceContext->OMSetRenderTargets(0, 0, 0);
             d3d11FrameBufferView->Release();
@@ -105,9 +169,8 @@ namespace awesome {
                 windowWidth = clientRect.right - clientRect.left;
                 windowHeight = clientRect.bottom - clientRect.top;
                 windowAspectRatio = (float)windowWidth / (float)windowHeight;
-                camera->UpdatePerspectiveMatrix(windowAspectRatio);
+                perspectiveMatrix = makePerspectiveMat(windowAspectRatio, degreesToRadians(VERTICAL_FOV_DEGREES), NEAR_PLANE, FAR_PLANE);
             } 
-            windowResized = false;
         }
     }
 
@@ -225,81 +288,158 @@ namespace awesome {
         return 0;
     }
 
-    ID3DBlob* D3DRenderer::CreateVertexShader() {
-        ID3DBlob* vsBlob;
-        ID3DBlob* shaderCompileErrorsBlob;
-        HRESULT hResult = D3DCompileFromFile(L"Shaders/textured_surface.hlsl", nullptr, nullptr, "vs_main", "vs_5_0", 0, 0, &vsBlob, &shaderCompileErrorsBlob);
-        if (FAILED(hResult))
-        {
-            const char* errorString = NULL;
-            if (hResult == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND))
-                errorString = "Could not compile shader; file not found";
-            else if (shaderCompileErrorsBlob) {
-                errorString = (const char*)shaderCompileErrorsBlob->GetBufferPointer();
-                shaderCompileErrorsBlob->Release();
-            }
-            MessageBoxA(0, errorString, "Shader Compiler Error", MB_ICONERROR | MB_OK);
-            return nullptr;
+    namespace {
+        const char* SURFACE_PACK_PATH = "Shaders/surface.pack";
+        /* The untextured permutation doubles as the fallback while other permutations compile */
+        constexpr PermutationKey FALLBACK_PERMUTATION = 0;
+
+        PermutationPackDesc GetSurfacePackDesc() {
+            PermutationPackDesc packDesc;
+            packDesc.sourcePath = "Shaders/surface.hlsl";
+            packDesc.entryPoints[SHADER_STAGE_VERTEX] = "vs_main";
+            packDesc.profiles[SHADER_STAGE_VERTEX] = "vs_5_0";
+            packDesc.entryPoints[SHADER_STAGE_PIXEL] = "ps_main";
+            packDesc.profiles[SHADER_STAGE_PIXEL] = "ps_5_0";
+            return packDesc;
         }
 
-        hResult = d3d11Device->CreateVertexShader(vsBlob->GetBufferPointer(), vsBlob->GetBufferSize(), nullptr, &vertexShader);
-        assert(SUCCEEDED(hResult));
-        return vsBlob;
+        /* Only what the materials actually use gets compiled into the pack */
+        std::vector<PermutationKey> GetUsedSurfacePermutations() {
+            return { FALLBACK_PERMUTATION, SHADER_FEATURE_TEXTURED };
+        }
     }
 
-    int D3DRenderer::CreatePixelShader() {
-        ID3DBlob* psBlob;
-        ID3DBlob* shaderCompileErrorsBlob;
-        HRESULT hResult = D3DCompileFromFile(L"Shaders/textured_surface.hlsl", nullptr, nullptr, "ps_main", "ps_5_0", 0, 0, &psBlob, &shaderCompileErrorsBlob);
-        if (FAILED(hResult))
-        {
-            const char* errorString = NULL;
-            if (hResult == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND))
-                errorString = "Could not compile shader; file not found";
-            else if (shaderCompileErrorsBlob) {
-                errorString = (const char*)shaderCompileErrorsBlob->GetBufferPointer();
-                shaderCompileErrorsBlob->Release();
+    int D3DRenderer::LoadShaderPack() {
+        PROFILE_SCOPE("D3DRenderer::LoadShaderPack");
+        PermutationPackDesc packDesc = GetSurfacePackDesc();
+        std::vector<PermutationKey> usedPermutations = GetUsedSurfacePermutations();
+
+        /* Without the sources (shipped build) the pack is taken as is, otherwise rebuilt when it is stale */
+        std::string errors;
+        uint64_t sourceHash;
+        bool haveSources = ShaderPermutationPack::ComputeSourceHash(packDesc, usedPermutations, shaderCache, sourceHash, errors);
+        bool loaded = surfaceShaders.Load(SURFACE_PACK_PATH);
+        if (loaded && (!haveSources || surfaceShaders.GetSourceHash() == sourceHash) && CreateSurfaceShaders() == 0)
+            return 0;
+        if (!haveSources) {
+            const char* message = loaded ? "Shaders/surface.pack lacks the surface permutation" : "Could not load Shaders/surface.pack";
+            MessageBoxA(0, errors.empty() ? message : errors.c_str(), "Shader Compiler Error", MB_ICONERROR | MB_OK);
+            return 1;
+        }
+
+        /* Stale, missing or without the drawn permutation: compile the small fallback now and the drawn permutation in the background */
+        ShaderBytecode fallbackBytecode[SHADER_STAGE_COUNT];
+        for (uint32_t stage = 0; stage < SHADER_STAGE_COUNT; ++stage) {
+            if (!shaderCache.GetBytecode(MakePermutationCompileDesc(packDesc, FALLBACK_PERMUTATION, static_cast<ShaderStage>(stage)), fallbackBytecode[stage], errors)) {
+                MessageBoxA(0, errors.c_str(), "Shader Compiler Error", MB_ICONERROR | MB_OK);
+                return 1;
             }
-            MessageBoxA(0, errorString, "Shader Compiler Error", MB_ICONERROR | MB_OK);
+        }
+        const ShaderBytecode& fallbackVs = fallbackBytecode[SHADER_STAGE_VERTEX];
+        const ShaderBytecode& fallbackPs = fallbackBytecode[SHADER_STAGE_PIXEL];
+        CreateVertexShader(fallbackVs.data(), fallbackVs.size(), &fallbackVertexShader);
+        CreatePixelShader(fallbackPs.data(), fallbackPs.size(), &fallbackPixelShader);
+        CreateInputLayout(fallbackVs.data(), fallbackVs.size(), &fallbackInputLayout);
+
+        ShaderCompileDesc stages[SHADER_STAGE_COUNT];
+        for (uint32_t stage = 0; stage < SHADER_STAGE_COUNT; ++stage)
+            stages[stage] = MakePermutationCompileDesc(packDesc, surfacePermutation, static_cast<ShaderStage>(stage));
+        surfaceProgram.Request(shaderCompileService, stages);
+        return 0;
+    }
+
+    int D3DRenderer::CreateSurfaceShaders() {
+        const uint8_t* vsBytecode;
+        const uint8_t* psBytecode;
+        size_t vsBytecodeSize, psBytecodeSize;
+        if (!surfaceShaders.Find(surfacePermutation, SHADER_STAGE_VERTEX, vsBytecode, vsBytecodeSize) ||
+            !surfaceShaders.Find(surfacePermutation, SHADER_STAGE_PIXEL, psBytecode, psBytecodeSize))
             return 1;
+
+        CreateVertexShader(vsBytecode, vsBytecodeSize, &vertexShader);
+        CreatePixelShader(psBytecode, psBytecodeSize, &pixelShader);
+        CreateInputLayout(vsBytecode, vsBytecodeSize, &inputLayout);
+
+        ShaderCacheStats stats = shaderCache.GetStats();
+        char statsLine[160];
+        snprintf(statsLine, sizeof(statsLine), "Shader pack: %u permutations; shader cache: %u compiled, %u from disk, %u from memory, %u source files read\n",
+            surfaceShaders.GetPermutationCount(), stats.compiles, stats.diskHits, stats.memoryHits, stats.sourceFileReads);
+        OutputDebugStringA(statsLine);
+        return 0;
+    }
+
+    DrawShaderChoice D3DRenderer::UpdateSurfaceShaders() {
+        if (surfacePackBuild.valid() && surfacePackBuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            const ShaderCompileResult& result = surfacePackBuild.get();
+            if (result.succeeded)
+                OutputDebugStringA("Rebuilt Shaders/surface.pack\n");
+            else
+                OutputDebugStringA(("Could not rebuild Shaders/surface.pack: " + result.errors + "\n").c_str());
+            surfacePackBuild = {};
         }
+        if (vertexShader)
+            return DrawShaderChoice::Program;
+
+        ShaderProgramState state = surfaceProgram.GetState();
+        if (state == ShaderProgramState::Compiling) {
+            state = surfaceProgram.Poll();
+            if (state == ShaderProgramState::Ready) {
+                const ShaderBytecode& vs = surfaceProgram.GetBytecode(SHADER_STAGE_VERTEX);
+                const ShaderBytecode& ps = surfaceProgram.GetBytecode(SHADER_STAGE_PIXEL);
+                CreateVertexShader(vs.data(), vs.size(), &vertexShader);
+                CreatePixelShader(ps.data(), ps.size(), &pixelShader);
+                CreateInputLayout(vs.data(), vs.size(), &inputLayout);
+                /* Every permutation is in the cache's memory now, the rebuild only writes the pack for the next start */
+                surfacePackBuild = shaderCompileService.RequestPackBuild(GetSurfacePackDesc(), GetUsedSurfacePermutations(), SURFACE_PACK_PATH);
+            }
+            else if (state == ShaderProgramState::Failed) {
+                /* Keep drawing with the fallback, a fixed source is picked up on the next start */
+                OutputDebugStringA(("Surface shaders failed to compile, drawing with the fallback:\n" + surfaceProgram.GetErrors() + "\n").c_str());
+            }
+        }
+        return ChooseDrawShader(vertexShader ? ShaderProgramState::Ready : state, fallbackVertexShader != nullptr);
+    }
 
-        hResult = d3d11Device->CreatePixelShader(psBlob->GetBufferPointer(), psBlob->GetBufferSize(), nullptr, &pixelShader);
+    int D3DRenderer::CreateVertexShader(const uint8_t* bytecode, size_t bytecodeSize, ID3D11VertexShader** shader) {
+        HRESULT hResult = d3d11Device->CreateVertexShader(bytecode, bytecodeSize, nullptr, shader);
         assert(SUCCEEDED(hResult));
-        psBlob->Release();
         return 0;
     }
 
-    int D3DRenderer::CreateInputLayout(ID3DBlob* vsBlob) {
-        D3D11_INPUT_ELEMENT_DESC inputElementDesc[] =
-        {
-            { "POS", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-            { "TEX", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
-        };
+    int D3DRenderer::CreatePixelShader(const uint8_t* bytecode, size_t bytecodeSize, ID3D11PixelShader** shader) {
+        HRESULT hResult = d3d11Device->CreatePixelShader(bytecode, bytecodeSize, nullptr, shader);
+        assert(SUCCEEDED(hResult));
+        return 0;
+    }
+
+    int D3DRenderer::CreateInputLayout(const uint8_t* vsBytecode, size_t vsBytecodeSize, ID3D11InputLayout** layout) {
+        /* Elements the vertex shader does not read are allowed, so the untextured fallback shares the layout */
+        auto inputElementDesc = MakeInputElementDescs<SurfaceVertexFormat>();
         HRESULT hResult = d3d11Device->CreateInputLayout(
-            inputElementDesc,
-            ARRAYSIZE(inputElementDesc),
-            vsBlob->GetBufferPointer(),
-            vsBlob->GetBufferSize(),
-            &inputLayout
+            inputElementDesc.data(),
+            static_cast<UINT>(inputElementDesc.size()),
+            vsBytecode,
+            vsBytecodeSize,
+            layout
         );
         assert(SUCCEEDED(hResult));
-        vsBlob->Release();
         return 0;
     }
 
     int D3DRenderer::CreateVertexBuffer() {
-        float vertexData[] = { // x, y, u, v
-            -0.5f,  0.5f, 0.f, 0.f,
-            0.5f, -0.5f, 1.f, 1.f,
-            -0.5f, -0.5f, 0.f, 1.f,
-            -0.5f,  0.5f, 0.f, 0.f,
-            0.5f,  0.5f, 1.f, 0.f,
-            0.5f, -0.5f, 1.f, 1.f
+        const float2 positions[] = {
+            { -0.5f,  0.5f }, { 0.5f, -0.5f }, { -0.5f, -0.5f },
+            { -0.5f,  0.5f }, { 0.5f,  0.5f }, { 0.5f, -0.5f }
         };
-        stride = 4 * sizeof(float);
+        const float2 uvs[] = {
+            { 0.f, 0.f }, { 1.f, 1.f }, { 0.f, 1.f },
+            { 0.f, 0.f }, { 1.f, 0.f }, { 1.f, 1.f }
+        };
+        numVerts = ARRAYSIZE(positions);
+        uint8_t vertexData[ARRAYSIZE(positions) * SurfaceVertexFormat::STRIDE];
+        SurfaceVertexFormat::PackVertices(vertexData, numVerts, positions, uvs);
+        stride = SurfaceVertexFormat::STRIDE;
         offset = 0;
-        numVerts = sizeof(vertexData) / stride;
 
         D3D11_BUFFER_DESC vertexBufferDesc = {};
         vertexBufferDesc.ByteWidth = sizeof(vertexData);
@@ -331,6 +471,34 @@ namespace awesome {
     }
 
     int D3DRenderer::LoadTextures() {
+        PROFILE_SCOPE("D3DRenderer::LoadTextures");
+        textureResidency.SetBudget(TEXTURE_BUDGET_BYTES);
+        int result = CreateTextureView();
+        if (result != 0)
+            return result;
+
+        D3D11_TEXTURE2D_DESC textureDesc;
+        {
+            ID3D11Resource* resource;
+            textureView->GetResource(&resource);
+            static_cast<ID3D11Texture2D*>(resource)->GetDesc(&textureDesc);
+            resource->Release();
+        }
+        TextureResidencyDesc residencyDesc;
+        residencyDesc.name = "Textures/texture1.png";
+        residencyDesc.width = textureDesc.Width;
+        residencyDesc.height = textureDesc.Height;
+        residencyDesc.mipCount = textureDesc.MipLevels;
+        residencyDesc.bytesPerBlock = 4;
+        textureHandle = textureResidency.Register(residencyDesc);
+
+        char statsLine[256];
+        textureResidency.FormatStats(statsLine, sizeof(statsLine));
+        OutputDebugStringA(statsLine);
+        return 0;
+    }
+
+    int D3DRenderer::CreateTextureView() {
         // Load Image
         int texWidth, texHeight, texNumChannels;
         int texForceNumChannels = 4;
@@ -365,22 +533,79 @@ namespace awesome {
 
         hResult = d3d11Device->CreateShaderResourceView(texture, nullptr, &textureView);
         assert(SUCCEEDED(hResult));
+        texture->Release(); // the view keeps it alive
         free(inputTextureBytes);
         return 0;
     }
 
-    int D3DRenderer::CreateConstantBuffer() {
-        D3D11_BUFFER_DESC constantBufferDesc = {};
-        constantBufferDesc.ByteWidth = sizeof(Constants);
-        constantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-        constantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-        constantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    int D3DRenderer::CreateConstantBuffers() {
+        const UINT sizes[CBUFFER_SLOT_COUNT] = {
+            FrameConstantsLayout::SIZE,
+            ViewConstantsLayout::SIZE,
+            MaterialConstantsLayout::SIZE,
+            ObjectConstantsLayout::SIZE
+        };
+        for (uint32_t slot = 0; slot < CBUFFER_SLOT_COUNT; ++slot) {
+            D3D11_BUFFER_DESC constantBufferDesc = {};
+            constantBufferDesc.ByteWidth = sizes[slot];
+            constantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+            constantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+            constantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+            HRESULT hResult = d3d11Device->CreateBuffer(&constantBufferDesc, nullptr, &constantBuffers[slot]);
+            assert(SUCCEEDED(hResult));
+        }
+        frameConstants.MarkDirty();
+        viewConstants.MarkDirty();
+        materialConstants.MarkDirty();
+        return 0;
+    }
 
-        HRESULT hResult = d3d11Device->CreateBuffer(&constantBufferDesc, nullptr, &constantBuffer);
+    int D3DRenderer::CreateTransformBuffer() {
+        D3D11_BUFFER_DESC transformBufferDesc = {};
+        transformBufferDesc.ByteWidth = MAX_OBJECT_TRANSFORMS * sizeof(float3x4);
+        transformBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+        transformBufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        transformBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        transformBufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+        transformBufferDesc.StructureByteStride = sizeof(float3x4);
+
+        HRESULT hResult = d3d11Device->CreateBuffer(&transformBufferDesc, nullptr, &transformBuffer);
+        assert(SUCCEEDED(hResult));
+
+        D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+        viewDesc.Format = DXGI_FORMAT_UNKNOWN;
+        viewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+        viewDesc.Buffer.FirstElement = 0;
+        viewDesc.Buffer.NumElements = MAX_OBJECT_TRANSFORMS;
+        hResult = d3d11Device->CreateShaderResourceView(transformBuffer, &viewDesc, &transformBufferView);
         assert(SUCCEEDED(hResult));
         return 0;
     }
 
+    void D3DRenderer::UploadObjectTransforms(const std::vector<float4x4>& objectTransforms) {
+        PROFILE_SCOPE("UploadObjectTransforms");
+        /* One map for every object of the frame instead of one constant buffer update per draw */
+        assert(objectTransforms.size() <= MAX_OBJECT_TRANSFORMS);
+        D3D11_MAPPED_SUBRESOURCE mappedSubresource;
+        HRESULT hResult = d3d11DeviceContext->Map(transformBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedSubresource);
+        assert(SUCCEEDED(hResult));
+        WriteObjectTransforms(static_cast<float3x4*>(mappedSubresource.pData), objectTransforms.data(),
+            static_cast<uint32_t>(objectTransforms.size()), *jobSystem);
+        d3d11DeviceContext->Unmap(transformBuffer, 0);
+    }
+
+    template<typename Layout>
+    void D3DRenderer::UploadConstants(ID3D11Buffer* buffer, ConstantBufferShadow<Layout>& constants) {
+        if (!constants.IsDirty())
+            return;
+        D3D11_MAPPED_SUBRESOURCE mappedSubresource;
+        HRESULT hResult = d3d11DeviceContext->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedSubresource);
+        assert(SUCCEEDED(hResult));
+        constants.Upload(mappedSubresource.pData);
+        d3d11DeviceContext->Unmap(buffer, 0);
+    }
+
     int D3DRenderer::CreateRasterizerState() {
         D3D11_RASTERIZER_DESC rasterizerDesc = {};
         rasterizerDesc.FillMode = D3D11_FILL_SOLID;
@@ -392,4 +617,48 @@ namespace awesome {
         return 0;
     }
 
+    int D3DRenderer::CreateCommandBackend() {
+        /* Without deferred contexts every frame is recorded on the immediate context, which still works */
+        bool deferred = commandBackend.Init(d3d11Device, d3d11DeviceContext, constantBuffers[CBUFFER_SLOT_OBJECT]);
+        commandBackend.SetMesh(QUAD_MESH, { vertexBuffer, stride, offset });
+        char line[160];
+        snprintf(line, sizeof(line), "Command lists: %u deferred contexts%s, %s\n", commandBackend.GetMaxBatchCount(),
+            deferred ? "" : " (CreateDeferredContext failed)",
+            commandBackend.HasDriverCommandLists() ? "driver command lists" : "emulated by the D3D11 runtime");
+        OutputDebugStringA(line);
+        return deferred ? 0 : 1;
+    }
+
+    void D3DRenderer::SubmitDraws(uint32_t objectCount, DrawShaderChoice shaderChoice, float viewportWidth, float viewportHeight) {
+        PROFILE_SCOPE("SubmitDraws");
+        D3DPassState passState;
+        passState.renderTarget = d3d11FrameBufferView;
+        passState.viewport[2] = viewportWidth;
+        passState.viewport[3] = viewportHeight;
+        passState.rasterizerState = rasterizerState;
+        for (uint32_t slot = 0; slot < CBUFFER_SLOT_COUNT; ++slot)
+            passState.constantBuffers[slot] = constantBuffers[slot];
+        passState.transforms = transformBufferView;
+        commandBackend.SetPassState(passState);
+        /* Shaders swap when a compile finishes and the texture view when residency changes, so these are refreshed every frame */
+        commandBackend.SetPipeline(SURFACE_PIPELINE, { vertexShader, pixelShader, inputLayout });
+        commandBackend.SetPipeline(FALLBACK_PIPELINE, { fallbackVertexShader, fallbackPixelShader, fallbackInputLayout });
+        commandBackend.SetMaterial(SURFACE_MATERIAL, { textureView, samplerState });
+
+        /* One item per object; objects next to each other in the transform buffer merge into one instanced draw */
+        drawItems.clear();
+        if (shaderChoice != DrawShaderChoice::Skip) {
+            DrawItem item;
+            item.pipeline = shaderChoice == DrawShaderChoice::Fallback ? FALLBACK_PIPELINE : SURFACE_PIPELINE;
+            item.material = SURFACE_MATERIAL;
+            item.mesh = QUAD_MESH;
+            item.vertexCount = numVerts;
+            for (uint32_t i = 0; i < objectCount; ++i) {
+                item.firstTransform = i;
+                drawItems.push_back(item);
+            }
+        }
+        commandRecorder.Submit(drawItems.data(), static_cast<uint32_t>(drawItems.size()), *jobSystem);
+    }
+
 } // namespace awesome
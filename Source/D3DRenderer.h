@@ -1,6 +1,17 @@
 #include <combaseapi.h>
 #include <corecrt_math_defines.h>
 #include "3DMaths.h"
+#include "TextureResidency.h"
+#include "ShaderCache.h"
+#include "D3DShaderCompiler.h"
+#include "ShaderPermutations.h"
+#include "ShaderCompileService.h"
+#include "ShaderConstants.h"
+#include "D3DGpuTimer.h"
+#include "D3DCommandList.h"
+#include "FrameSnapshot.h"
+#include <atomic>
+#include <vector>
 
 struct ID3D11Device1;
 struct ID3D11DeviceContext1;
@@ -14,36 +25,45 @@ struct ID3D11SamplerState;
 struct ID3D11ShaderResourceView;
 struct ID3D11RasterizerState;
 
-// Forward declaring ID3DBlob
-struct ID3D10Blob;
-typedef interface ID3D10Blob* LPD3D10BLOB;
-typedef ID3D10Blob ID3DBlob;
-
 namespace awesome { 
 
-	class TimeManager;
-	class InputManager;
-	class Camera;
+	class LatencyTracker;
+	class JobSystem;
 
 	class D3DRenderer {
 	public:
-		void Init(HWND windowHandle, TimeManager* gm, InputManager* im, Camera* c);
+		void Init(HWND windowHandle, LatencyTracker* lt, JobSystem* js);
+		/* Any thread, the window thread's resize reaches the renderer through this */
 		void SetWindowsResized(bool value) { windowResized = value; };
-		void Render(unsigned long long deltaTimeMs);
+		/* Render thread only, after Init */
+		void Render(const FrameSnapshot& snapshot);
+		void FormatGpuReport(char* buffer, size_t bufferSize) const { gpuProfiler.FormatReport(buffer, bufferSize); }
+		void FormatCommandStats(char* buffer, size_t bufferSize) const { commandRecorder.FormatStats(buffer, bufferSize); }
 
 	private:
 		int RegisterDirect3DDevice();
 		void SetupDebugLayer();
 		int CreateSwapChain();
 		int CreateFrameBuffer();
-		ID3DBlob* CreateVertexShader();
-		int CreatePixelShader();
-		int CreateInputLayout(ID3DBlob* vsBlob);
+		int LoadShaderPack();
+		int CreateSurfaceShaders();
+		DrawShaderChoice UpdateSurfaceShaders();
+		int CreateVertexShader(const uint8_t* bytecode, size_t bytecodeSize, ID3D11VertexShader** shader);
+		int CreatePixelShader(const uint8_t* bytecode, size_t bytecodeSize, ID3D11PixelShader** shader);
+		int CreateInputLayout(const uint8_t* vsBytecode, size_t vsBytecodeSize, ID3D11InputLayout** layout);
 		int CreateVertexBuffer();
 		int LoadTextures();
+		int CreateTextureView();
+		void UpdateTextureResidency(float coveredPixels);
 		int CreateSamplerState();
-		int CreateConstantBuffer();
+		int CreateConstantBuffers();
+		int CreateTransformBuffer();
+		void UploadObjectTransforms(const std::vector<float4x4>& objectTransforms);
+		template<typename Layout>
+		void UploadConstants(ID3D11Buffer* buffer, ConstantBufferShadow<Layout>& constants);
 		int CreateRasterizerState();
+		int CreateCommandBackend();
+		void SubmitDraws(uint32_t objectCount, DrawShaderChoice shaderChoice, float viewportWidth, float viewportHeight);
 		void CheckWindowResize();
 
 		HWND windowHandle{ nullptr };
@@ -61,15 +81,39 @@ namespace awesome {
 
 		ID3D11VertexShader* vertexShader{ nullptr };
 		ID3D11PixelShader* pixelShader{ nullptr };
+		D3DShaderCompiler shaderCompiler;
+		ShaderCache shaderCache{ "ShaderCache", &shaderCompiler };
+		ShaderCompileService shaderCompileService{ shaderCache, 2 };
+		ShaderPermutationPack surfaceShaders;
+		PermutationKey surfacePermutation{ SHADER_FEATURE_TEXTURED };
+		AsyncShaderProgram surfaceProgram;
+		ShaderCompileFuture surfacePackBuild;
+		ID3D11VertexShader* fallbackVertexShader{ nullptr };
+		ID3D11PixelShader* fallbackPixelShader{ nullptr };
+		ID3D11InputLayout* fallbackInputLayout{ nullptr };
 
 		ID3D11SamplerState* samplerState{ nullptr };
 		ID3D11ShaderResourceView* textureView{ nullptr };
-		ID3D11Buffer* constantBuffer{ nullptr };
+		TextureResidencyManager textureResidency;
+		TextureHandle textureHandle{ INVALID_TEXTURE_HANDLE };
+		std::vector<ResidencyChange> residencyChanges;
+		ID3D11Buffer* constantBuffers[CBUFFER_SLOT_COUNT]{};
+		ConstantBufferShadow<FrameConstantsLayout> frameConstants;
+		ConstantBufferShadow<ViewConstantsLayout> viewConstants;
+		ConstantBufferShadow<MaterialConstantsLayout> materialConstants;
+		ID3D11Buffer* transformBuffer{ nullptr };
+		ID3D11ShaderResourceView* transformBufferView{ nullptr };
+		D3DGpuTimerBackend gpuTimerBackend;
+		GpuProfiler gpuProfiler{ gpuTimerBackend };
+		D3DCommandBackend commandBackend;
+		CommandRecorder commandRecorder{ commandBackend };
+		std::vector<DrawItem> drawItems;
 
-		bool windowResized{ true };
+		std::atomic<bool> windowResized{ true };
+		float4x4 perspectiveMatrix{};
+		unsigned long long frameIndex{ 0 };
 
-		TimeManager* timeManager{ nullptr };
-		InputManager* inputManager{ nullptr };
-		Camera* camera{ nullptr };
+		LatencyTracker* latencyTracker{ nullptr };
+		JobSystem* jobSystem{ nullptr };
 	};
 }
\ No newline at end of file
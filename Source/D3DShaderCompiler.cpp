@@ -0,0 +1,38 @@
+#include "D3DShaderCompiler.h"
+#include <windows.h>
+#include <d3dcompiler.h>
+
+namespace awesome {
+
+	bool D3DShaderCompiler::Compile(const ShaderCompileDesc& desc, const std::string& source, ShaderBytecode& bytecode, std::string& errors) {
+		std::vector<D3D_SHADER_MACRO> macros;
+		for (const ShaderDefine& define : desc.defines)
+			macros.push_back({ define.name.c_str(), define.value.c_str() });
+		macros.push_back({ nullptr, nullptr });
+
+		ID3DBlob* shaderBlob = nullptr;
+		ID3DBlob* shaderCompileErrorsBlob = nullptr;
+		HRESULT hResult = D3DCompile(source.data(), source.size(), desc.sourcePath.c_str(), macros.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE,
+			desc.entryPoint.c_str(), desc.profile.c_str(), desc.flags, 0, &shaderBlob, &shaderCompileErrorsBlob);
+		if (FAILED(hResult)) {
+			if (shaderCompileErrorsBlob)
+				errors.assign(static_cast<const char*>(shaderCompileErrorsBlob->GetBufferPointer()), shaderCompileErrorsBlob->GetBufferSize());
+			else
+				errors = "Could not compile shader " + desc.sourcePath;
+		}
+		if (shaderCompileErrorsBlob)
+			shaderCompileErrorsBlob->Release(); // only warnings if the compile succeeded
+		if (FAILED(hResult))
+			return false;
+
+		const uint8_t* code = static_cast<const uint8_t*>(shaderBlob->GetBufferPointer());
+		bytecode.assign(code, code + shaderBlob->GetBufferSize());
+		shaderBlob->Release();
+		return true;
+	}
+
+	uint64_t D3DShaderCompiler::GetVersionHash() const {
+		return D3D_COMPILER_VERSION;
+	}
+
+} // namespace awesome
@@ -0,0 +1,13 @@
+#pragma once
+#include "ShaderCache.h"
+
+namespace awesome {
+
+	/* Compiles HLSL with D3DCompile, includes resolve relative to the source file */
+	class D3DShaderCompiler : public ShaderCompiler {
+	public:
+		bool Compile(const ShaderCompileDesc& desc, const std::string& source, ShaderBytecode& bytecode, std::string& errors) override;
+		uint64_t GetVersionHash() const override;
+	};
+
+} // namespace awesome
@@ -0,0 +1,38 @@
+#include "EventPump.h"
+#include "Clock.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace awesome {
+
+	EventPump::EventPump(InputEventQueue& queue, uint32_t maxEventsPerFrame)
+		: queue(queue),
+		maxEventsPerFrame(std::min<uint32_t>(std::max(1u, maxEventsPerFrame), INPUT_EVENT_QUEUE_SIZE)),
+		ticksToUs(1000000.0 / static_cast<double>(Clock::QueryTicksPerSec())) {}
+
+	unsigned long long EventPump::BeginDrain() {
+		queueDepth = static_cast<uint32_t>(queue.GetSize());
+		return Clock::QueryTicks();
+	}
+
+	void EventPump::EndDrain(unsigned long long startTicks, uint32_t count) {
+		double handleUs = (Clock::QueryTicks() - startTicks) * ticksToUs;
+		++stats.frames;
+		stats.events += count;
+		/* The depth was sampled before draining, events that arrived since do not count as over budget */
+		if (queueDepth > count)
+			++stats.budgetExceededFrames;
+		stats.maxQueueDepth = std::max(stats.maxQueueDepth, queueDepth);
+		stats.meanQueueDepth += (queueDepth - stats.meanQueueDepth) / static_cast<double>(stats.frames);
+		stats.meanHandleUs += (handleUs - stats.meanHandleUs) / static_cast<double>(stats.frames);
+		stats.maxHandleUs = std::max(stats.maxHandleUs, handleUs);
+	}
+
+	void EventPump::FormatStats(char* buffer, size_t bufferSize) const {
+		snprintf(buffer, bufferSize,
+			"Event pump: %llu events over %llu frames, queue depth mean %.2f max %u, %llu frames over the %u event budget, handling mean %.1f us max %.1f us\n",
+			static_cast<unsigned long long>(stats.events), static_cast<unsigned long long>(stats.frames), stats.meanQueueDepth, stats.maxQueueDepth,
+			static_cast<unsigned long long>(stats.budgetExceededFrames), maxEventsPerFrame, stats.meanHandleUs, stats.maxHandleUs);
+	}
+
+} // namespace awesome
@@ -0,0 +1,57 @@
+#pragma once
+#include "InputManager.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace awesome {
+
+	struct EventPumpStats {
+		uint64_t frames{ 0 };
+		uint64_t events{ 0 };
+		uint64_t budgetExceededFrames{ 0 }; // frames that left events queued for the next one
+		uint32_t maxQueueDepth{ 0 };        // events waiting when a frame started draining
+		double meanQueueDepth{ 0.0 };
+		double meanHandleUs{ 0.0 };         // per frame, draining and handling together
+		double maxHandleUs{ 0.0 };
+	};
+
+	/*
+	 * The first stage of a frame: takes everything the window thread queued since the last frame,
+	 * up to maxEventsPerFrame, in one batch and hands it to the handler before anything simulates.
+	 * Events over the budget stay queued for the next frame, so a flood can not stall one frame.
+	 */
+	class EventPump {
+	public:
+		static constexpr uint32_t DEFAULT_MAX_EVENTS_PER_FRAME = 256;
+
+		explicit EventPump(InputEventQueue& queue, uint32_t maxEventsPerFrame = DEFAULT_MAX_EVENTS_PER_FRAME);
+
+		/* Handler is called as handler(const InputEvent&) in queue order; returns the number handled */
+		template<typename Handler>
+		uint32_t Drain(Handler&& handler) {
+			unsigned long long startTicks = BeginDrain();
+			uint32_t count = 0;
+			while (count < maxEventsPerFrame && queue.TryPop(batch[count]))
+				++count;
+			for (uint32_t i = 0; i < count; ++i)
+				handler(batch[i]);
+			EndDrain(startTicks, count);
+			return count;
+		}
+
+		const EventPumpStats& GetStats() const { return stats; }
+		void FormatStats(char* buffer, size_t bufferSize) const;
+
+	private:
+		unsigned long long BeginDrain();
+		void EndDrain(unsigned long long startTicks, uint32_t count);
+
+		InputEventQueue& queue;
+		uint32_t maxEventsPerFrame;
+		InputEvent batch[INPUT_EVENT_QUEUE_SIZE];
+		uint32_t queueDepth{ 0 };
+		double ticksToUs;
+		EventPumpStats stats;
+	};
+
+} // namespace awesome
@@ -0,0 +1,26 @@
+#include "FixedTimestep.h"
+#include <algorithm>
+
+namespace awesome {
+
+	FixedTimestep::FixedTimestep(double stepSec, uint32_t maxStepsPerFrame)
+		: stepSec(stepSec), maxStepsPerFrame(std::max(1u, maxStepsPerFrame)) {}
+
+	uint32_t FixedTimestep::Advance(double deltaSec) {
+		accumulator += std::max(0.0, deltaSec);
+		uint32_t steps = 0;
+		while (accumulator >= stepSec && steps < maxStepsPerFrame) {
+			accumulator -= stepSec;
+			++steps;
+		}
+		if (accumulator >= stepSec) {
+			/* Keep the fraction so the alpha stays continuous, drop the whole steps */
+			double backlog = accumulator - static_cast<double>(static_cast<uint64_t>(accumulator / stepSec)) * stepSec;
+			droppedSec += accumulator - backlog;
+			accumulator = backlog;
+		}
+		totalSteps += steps;
+		return steps;
+	}
+
+} // namespace awesome
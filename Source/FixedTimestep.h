@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+
+namespace awesome {
+
+	/*
+	 * Fixed-step simulation driven by variable frame times. Each frame's delta goes into an
+	 * accumulator, Advance says how many whole steps to simulate, and the remainder becomes the
+	 * interpolation alpha between the previous and the current simulation state for rendering.
+	 * After a long stall at most maxStepsPerFrame steps run and the rest of the backlog is dropped,
+	 * so a slow frame can not make every following frame slower.
+	 */
+	class FixedTimestep {
+	public:
+		explicit FixedTimestep(double stepSec, uint32_t maxStepsPerFrame = 8);
+
+		/* Adds a frame's delta and returns the number of steps to simulate now */
+		uint32_t Advance(double deltaSec);
+		double GetStepSec() const { return stepSec; }
+		/* Fraction of a step the render time is past the latest simulated state, 0 to 1 */
+		double GetAlpha() const { return accumulator / stepSec; }
+		uint64_t GetTotalSteps() const { return totalSteps; }
+		double GetDroppedSec() const { return droppedSec; }
+
+	private:
+		double stepSec;
+		uint32_t maxStepsPerFrame;
+		double accumulator{ 0.0 };
+		uint64_t totalSteps{ 0 };
+		double droppedSec{ 0.0 };
+	};
+
+} // namespace awesome
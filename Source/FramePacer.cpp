@@ -0,0 +1,126 @@
+#include "FramePacer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+namespace awesome {
+
+	namespace {
+		/* Start pessimistic, the estimate settles within a few frames */
+		constexpr double INITIAL_OVERSLEEP_US = 1000.0;
+		constexpr double MAX_SPIN_MARGIN_US = 4000.0;
+		/* Weight of the newest sample in the running oversleep estimate */
+		constexpr double OVERSLEEP_SMOOTHING = 0.1;
+
+		double ToUs(FramePacer::Clock::duration d) {
+			return std::chrono::duration<double, std::micro>(d).count();
+		}
+	}
+
+	FramePacer::FramePacer() : oversleepMeanUs(INITIAL_OVERSLEEP_US) {
+#ifdef _WIN32
+		/* Windows 10 1803 and later; older versions fall back to Sleep with a 1 ms timer period */
+		waitableTimer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		if (!waitableTimer)
+			timeBeginPeriod(1);
+#endif
+	}
+
+	FramePacer::~FramePacer() {
+#ifdef _WIN32
+		if (waitableTimer)
+			CloseHandle(waitableTimer);
+		else
+			timeEndPeriod(1);
+#endif
+	}
+
+	void FramePacer::SetTargetFrameTime(double seconds) {
+		std::chrono::duration<double> target(std::max(0.0, seconds));
+		if (target == targetFrameTime)
+			return;
+		targetFrameTime = target;
+		haveDeadline = false;
+	}
+
+	void FramePacer::SleepFor(Clock::duration duration) {
+#ifdef _WIN32
+		if (waitableTimer) {
+			LARGE_INTEGER dueTime;
+			dueTime.QuadPart = -static_cast<LONGLONG>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count() / 100); // relative, 100 ns units
+			if (SetWaitableTimerEx(waitableTimer, &dueTime, 0, nullptr, nullptr, nullptr, 0)) {
+				WaitForSingleObject(waitableTimer, INFINITE);
+				return;
+			}
+		}
+		Sleep(static_cast<DWORD>(std::chrono::duration_cast<std::chrono::milliseconds>(duration).count()));
+#else
+		std::this_thread::sleep_for(duration);
+#endif
+	}
+
+	void FramePacer::Wait() {
+		if (targetFrameTime.count() <= 0.0)
+			return;
+
+		Clock::duration target = std::chrono::duration_cast<Clock::duration>(targetFrameTime);
+		Clock::time_point now = Clock::now();
+		if (!haveDeadline) {
+			deadline = now + target;
+			haveDeadline = true;
+		}
+		++stats.frames;
+		if (now >= deadline) {
+			++stats.missedDeadlines;
+			deadline = now + target;
+			return;
+		}
+
+		/* Sleep until the learned margin before the deadline, never longer than the whole wait */
+		double marginUs = std::min(MAX_SPIN_MARGIN_US, oversleepMeanUs + 2.0 * oversleepDeviationUs);
+		Clock::time_point wakeAt = deadline - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::micro>(marginUs));
+		if (wakeAt > now) {
+			Clock::duration requested = wakeAt - now;
+			SleepFor(requested);
+			Clock::time_point woke = Clock::now();
+			double oversleepUs = std::max(0.0, ToUs(woke - now - requested));
+			double error = oversleepUs - oversleepMeanUs;
+			oversleepMeanUs += OVERSLEEP_SMOOTHING * error;
+			oversleepDeviationUs += OVERSLEEP_SMOOTHING * (std::fabs(error) - oversleepDeviationUs);
+			++stats.sleeps;
+			stats.meanOversleepUs += (oversleepUs - stats.meanOversleepUs) / static_cast<double>(stats.sleeps);
+			stats.maxOversleepUs = std::max(stats.maxOversleepUs, oversleepUs);
+			stats.sleptMs += ToUs(woke - now) / 1000.0;
+			now = woke;
+		}
+
+		Clock::time_point spinStart = now;
+		while (now < deadline) {
+			std::this_thread::yield();
+			now = Clock::now();
+		}
+		stats.spunMs += ToUs(now - spinStart) / 1000.0;
+
+		double wakeupErrorUs = ToUs(now - deadline);
+		uint64_t pacedFrames = stats.frames - stats.missedDeadlines;
+		stats.meanWakeupErrorUs += (wakeupErrorUs - stats.meanWakeupErrorUs) / static_cast<double>(pacedFrames);
+		stats.maxWakeupErrorUs = std::max(stats.maxWakeupErrorUs, wakeupErrorUs);
+		deadline += target;
+	}
+
+	void FramePacer::FormatStats(char* buffer, size_t bufferSize) const {
+		snprintf(buffer, bufferSize,
+			"Frame pacer: target %.2f ms, %llu frames, %llu missed, wakeup error mean %.1f us max %.1f us, oversleep mean %.1f us max %.1f us, slept %.1f ms, spun %.1f ms\n",
+			targetFrameTime.count() * 1000.0, static_cast<unsigned long long>(stats.frames), static_cast<unsigned long long>(stats.missedDeadlines),
+			stats.meanWakeupErrorUs, stats.maxWakeupErrorUs, stats.meanOversleepUs, stats.maxOversleepUs, stats.sleptMs, stats.spunMs);
+	}
+
+} // namespace awesome
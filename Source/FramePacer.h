@@ -0,0 +1,59 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace awesome {
+
+	struct FramePacerStats {
+		uint64_t frames{ 0 };
+		uint64_t missedDeadlines{ 0 };   // the frame itself took longer than the target
+		uint64_t sleeps{ 0 };
+		double meanWakeupErrorUs{ 0.0 }; // how late Wait returned relative to the deadline
+		double maxWakeupErrorUs{ 0.0 };
+		double meanOversleepUs{ 0.0 };   // how much later than asked the OS sleep woke up
+		double maxOversleepUs{ 0.0 };
+		double sleptMs{ 0.0 };           // totals, to see how much of the wait was spent off the CPU
+		double spunMs{ 0.0 };
+	};
+
+	/*
+	 * Holds frames to a target frame time without burning a core. Most of the wait is an OS
+	 * sleep (a high resolution waitable timer on Windows), woken early by a margin learned from
+	 * the measured oversleep, and the last part is a spin for precision. Deadlines advance by
+	 * the target each frame so jitter does not accumulate; after a missed deadline pacing
+	 * restarts from now instead of rushing to catch up.
+	 */
+	class FramePacer {
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		FramePacer();
+		~FramePacer();
+		FramePacer(const FramePacer&) = delete;
+		FramePacer& operator=(const FramePacer&) = delete;
+
+		/* 0 turns pacing off, Wait then returns immediately */
+		void SetTargetFrameTime(double seconds);
+		double GetTargetFrameTime() const { return targetFrameTime.count(); }
+		/* Call once per frame after Present, returns once the next frame should start */
+		void Wait();
+
+		const FramePacerStats& GetStats() const { return stats; }
+		void ResetStats() { stats = {}; }
+		void FormatStats(char* buffer, size_t bufferSize) const;
+
+	private:
+		void SleepFor(Clock::duration duration);
+
+		std::chrono::duration<double> targetFrameTime{ 0.0 };
+		Clock::time_point deadline{};
+		bool haveDeadline{ false };
+		/* Running estimate of oversleep, the sleep ends this much before the deadline */
+		double oversleepMeanUs{ 0.0 };
+		double oversleepDeviationUs{ 0.0 };
+		FramePacerStats stats;
+		void* waitableTimer{ nullptr };
+	};
+
+} // namespace awesome
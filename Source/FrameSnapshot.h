@@ -0,0 +1,24 @@
+#pragma once
+#include "3DMaths.h"
+#include "TripleBuffer.h"
+#include <cstdint>
+#include <vector>
+
+namespace awesome {
+
+	/*
+	 * Everything the renderer needs from one simulated frame, already interpolated for display.
+	 * Written by the simulation thread and read-only once published.
+	 */
+	struct FrameSnapshot {
+		uint64_t frame{ 0 };     // increases by one per published snapshot
+		double timeSec{ 0.0 };   // simulation time being displayed
+		double deltaTimeSec{ 0.0 };
+		float4x4 viewMatrix{};
+		float3 cameraPosition{};
+		std::vector<float4x4> objectTransforms;
+	};
+
+	using FrameSnapshotBuffer = TripleBuffer<FrameSnapshot>;
+
+} // namespace awesome
@@ -0,0 +1,138 @@
+#include "FrameStats.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace awesome {
+
+	double Percentile(const std::vector<double>& sorted, double p) {
+		if (sorted.empty())
+			return 0.0;
+		size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(sorted.size())));
+		return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+	}
+
+	FrameStats::FrameStats(uint32_t windowSize, double hitchFactor)
+		: windowSize(std::max(1u, windowSize)), hitchFactor(hitchFactor), histogram(BUCKET_COUNT, 0) {
+		window.reserve(this->windowSize);
+	}
+
+	uint32_t FrameStats::GetBucket(double frameMs) {
+		return std::min(BUCKET_COUNT - 1, static_cast<uint32_t>(std::max(0.0, frameMs) / BUCKET_MS));
+	}
+
+	double FrameStats::GetMedianMs() const {
+		/* Upper edge of the bucket holding the middle frame, good to a quarter millisecond */
+		uint32_t middle = static_cast<uint32_t>(window.size() + 1) / 2;
+		uint32_t seen = 0;
+		for (uint32_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+			seen += histogram[bucket];
+			if (seen >= middle && seen > 0)
+				return (bucket + 1) * BUCKET_MS;
+		}
+		return 0.0;
+	}
+
+	bool FrameStats::AddFrame(double frameTimeSec) {
+		double frameMs = frameTimeSec * 1000.0;
+		bool hitch = false;
+		if (window.size() >= MIN_FRAMES_FOR_HITCHES) {
+			double medianMs = GetMedianMs();
+			if (frameMs > hitchFactor * medianMs) {
+				hitch = true;
+				++totalHitches;
+				if (hitches.size() == MAX_RECORDED_HITCHES)
+					hitches.erase(hitches.begin());
+				hitches.push_back({ totalFrames, frameMs, medianMs });
+			}
+		}
+
+		if (window.size() < windowSize) {
+			window.push_back(frameMs);
+		}
+		else {
+			--histogram[GetBucket(window[next])];
+			window[next] = frameMs;
+		}
+		next = (next + 1) % windowSize;
+		++histogram[GetBucket(frameMs)];
+		++totalFrames;
+		return hitch;
+	}
+
+	std::vector<double> FrameStats::GetWindowInOrder() const {
+		if (window.size() < windowSize)
+			return window;
+		std::vector<double> ordered(window.begin() + next, window.end());
+		ordered.insert(ordered.end(), window.begin(), window.begin() + next);
+		return ordered;
+	}
+
+	FrameStatsSummary FrameStats::Summarize() const {
+		FrameStatsSummary summary;
+		summary.frames = static_cast<uint32_t>(window.size());
+		summary.hitches = totalHitches;
+		if (window.empty())
+			return summary;
+
+		std::vector<double> sorted = window;
+		std::sort(sorted.begin(), sorted.end());
+		double sum = 0.0;
+		for (double ms : sorted)
+			sum += ms;
+		summary.meanMs = sum / static_cast<double>(sorted.size());
+		summary.p50Ms = Percentile(sorted, 50.0);
+		summary.p95Ms = Percentile(sorted, 95.0);
+		summary.p99Ms = Percentile(sorted, 99.0);
+		summary.maxMs = sorted.back();
+		return summary;
+	}
+
+	bool FrameStats::WriteCsv(const std::string& path) const {
+		FILE* file = fopen(path.c_str(), "w");
+		if (!file)
+			return false;
+		std::vector<double> ordered = GetWindowInOrder();
+		uint64_t firstFrame = totalFrames - ordered.size();
+		size_t hitch = 0;
+		fprintf(file, "frame,ms,hitch\n");
+		for (size_t i = 0; i < ordered.size(); ++i) {
+			uint64_t frame = firstFrame + i;
+			while (hitch < hitches.size() && hitches[hitch].frame < frame)
+				++hitch;
+			bool isHitch = hitch < hitches.size() && hitches[hitch].frame == frame;
+			fprintf(file, "%llu,%.4f,%d\n", static_cast<unsigned long long>(frame), ordered[i], isHitch ? 1 : 0);
+		}
+		return fclose(file) == 0;
+	}
+
+	bool FrameStats::WriteJson(const std::string& path) const {
+		FILE* file = fopen(path.c_str(), "w");
+		if (!file)
+			return false;
+		FrameStatsSummary summary = Summarize();
+		fprintf(file, "{\n  \"frames\": %u,\n  \"totalFrames\": %llu,\n  \"meanMs\": %.4f,\n  \"p50Ms\": %.4f,\n  \"p95Ms\": %.4f,\n  \"p99Ms\": %.4f,\n  \"maxMs\": %.4f,\n",
+			summary.frames, static_cast<unsigned long long>(totalFrames), summary.meanMs, summary.p50Ms, summary.p95Ms, summary.p99Ms, summary.maxMs);
+		fprintf(file, "  \"hitchFactor\": %.2f,\n  \"hitchCount\": %llu,\n  \"hitches\": [", hitchFactor, static_cast<unsigned long long>(summary.hitches));
+		for (size_t i = 0; i < hitches.size(); ++i)
+			fprintf(file, "%s{\"frame\": %llu, \"ms\": %.4f, \"medianMs\": %.4f}", i ? ", " : "",
+				static_cast<unsigned long long>(hitches[i].frame), hitches[i].frameMs, hitches[i].medianMs);
+
+		/* Only non-empty buckets, keyed by their lower edge */
+		fprintf(file, "],\n  \"histogramBucketMs\": %.2f,\n  \"histogram\": {", BUCKET_MS);
+		bool first = true;
+		for (uint32_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+			if (!histogram[bucket])
+				continue;
+			fprintf(file, "%s\"%.2f\": %u", first ? "" : ", ", bucket * BUCKET_MS, histogram[bucket]);
+			first = false;
+		}
+		fprintf(file, "},\n  \"frameMs\": [");
+		std::vector<double> ordered = GetWindowInOrder();
+		for (size_t i = 0; i < ordered.size(); ++i)
+			fprintf(file, "%s%.4f", i ? ", " : "", ordered[i]);
+		fprintf(file, "]\n}\n");
+		return fclose(file) == 0;
+	}
+
+} // namespace awesome
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace awesome {
+
+	/* Nearest rank percentile (0..100) of an already sorted array, 0 when empty */
+	double Percentile(const std::vector<double>& sorted, double p);
+
+	struct FrameStatsSummary {
+		uint32_t frames{ 0 };
+		double meanMs{ 0.0 };
+		double p50Ms{ 0.0 };
+		double p95Ms{ 0.0 };
+		double p99Ms{ 0.0 };
+		double maxMs{ 0.0 };
+		uint64_t hitches{ 0 }; // since the start, not just in the window
+	};
+
+	struct FrameHitch {
+		uint64_t frame;
+		double frameMs;
+		double medianMs; // median of the window when the hitch happened
+	};
+
+	/*
+	 * Rolling window of frame times. Percentiles are exact over the window; a histogram of the
+	 * same window (fixed 0.25 ms buckets) gives the running median that hitch detection compares
+	 * against, so AddFrame stays cheap. A frame is a hitch when it takes longer than hitchFactor
+	 * times the median, once the window holds enough frames for the median to mean something.
+	 */
+	class FrameStats {
+	public:
+		static constexpr double BUCKET_MS = 0.25;
+		static constexpr uint32_t BUCKET_COUNT = 400; // the last bucket also holds everything above 100 ms
+		static constexpr uint32_t MIN_FRAMES_FOR_HITCHES = 30;
+		static constexpr size_t MAX_RECORDED_HITCHES = 256;
+
+		explicit FrameStats(uint32_t windowSize = 1024, double hitchFactor = 2.0);
+
+		/* Returns true if the frame was a hitch */
+		bool AddFrame(double frameTimeSec);
+		FrameStatsSummary Summarize() const;
+		double GetMedianMs() const;
+		const std::vector<uint32_t>& GetHistogram() const { return histogram; }
+		/* Most recent hitches, oldest first */
+		const std::vector<FrameHitch>& GetHitches() const { return hitches; }
+
+		/* One row per frame in the window */
+		bool WriteCsv(const std::string& path) const;
+		/* Summary, histogram, hitches and the window's frame times */
+		bool WriteJson(const std::string& path) const;
+
+	private:
+		static uint32_t GetBucket(double frameMs);
+		std::vector<double> GetWindowInOrder() const;
+
+		uint32_t windowSize;
+		double hitchFactor;
+		std::vector<double> window; // ring of frame times in ms
+		size_t next{ 0 };
+		uint64_t totalFrames{ 0 };
+		uint64_t totalHitches{ 0 };
+		std::vector<uint32_t> histogram;
+		std::vector<FrameHitch> hitches;
+	};
+
+} // namespace awesome
@@ -0,0 +1,172 @@
+#include "GpuTimer.h"
+#include "Clock.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+namespace awesome {
+
+	namespace {
+		/* Timestamps 0 and 1 bracket the frame, pass p uses 2 + 2p and 3 + 2p */
+		constexpr uint32_t TIMESTAMPS_PER_FRAME = 2 + 2 * GpuProfiler::MAX_PASSES;
+	}
+
+	GpuProfiler::GpuProfiler(GpuTimerBackend& backend) : backend(backend) {}
+
+	bool GpuProfiler::Init() {
+		initialised = backend.CreateQueries(FRAME_LATENCY, TIMESTAMPS_PER_FRAME);
+		return initialised;
+	}
+
+	void GpuProfiler::BeginFrame() {
+		recording = nullptr;
+		if (!initialised)
+			return;
+		CollectFinishedFrames();
+
+		recordingSlot = static_cast<uint32_t>(frameIndex++ % FRAME_LATENCY);
+		Slot& slot = slots[recordingSlot];
+		if (slot.pending) {
+			/* The GPU is more than FRAME_LATENCY frames behind, reusing the queries would stall */
+			++framesSkipped;
+			return;
+		}
+		slot.passCount = 0;
+		recording = &slot;
+		frameStartTicks = ProfileClock::QueryTicks();
+		backend.BeginFrame(recordingSlot);
+		backend.WriteTimestamp(recordingSlot, 0);
+	}
+
+	void GpuProfiler::BeginPass(const char* name) {
+		if (!recording || recording->passCount == MAX_PASSES)
+			return;
+		assert(!passOpen && "GPU passes can not nest");
+		passOpen = true;
+		recording->passNames[recording->passCount] = name;
+		passStartTicks = ProfileClock::QueryTicks();
+		backend.WriteTimestamp(recordingSlot, 2 + 2 * recording->passCount);
+	}
+
+	void GpuProfiler::EndPass() {
+		if (!recording || !passOpen)
+			return;
+		passOpen = false;
+		uint32_t pass = recording->passCount++;
+		backend.WriteTimestamp(recordingSlot, 3 + 2 * pass);
+		recording->cpuTicks[1 + pass] = ProfileClock::QueryTicks() - passStartTicks;
+	}
+
+	void GpuProfiler::EndFrame() {
+		if (!recording)
+			return;
+		EndPass();
+		backend.WriteTimestamp(recordingSlot, 1);
+		backend.EndFrame(recordingSlot);
+		recording->cpuTicks[0] = ProfileClock::QueryTicks() - frameStartTicks;
+		recording->pending = true;
+		recording = nullptr;
+	}
+
+	void GpuProfiler::CollectFinishedFrames() {
+		double cpuMsPerTick = 1000.0 / static_cast<double>(ProfileClock::QueryTicksPerSec());
+		uint64_t timestamps[TIMESTAMPS_PER_FRAME];
+
+		/* Oldest first, so the averages see frames in order */
+		for (uint32_t age = FRAME_LATENCY; age > 0; --age) {
+			if (frameIndex < age)
+				continue;
+			uint32_t index = static_cast<uint32_t>((frameIndex - age) % FRAME_LATENCY);
+			Slot& slot = slots[index];
+			if (!slot.pending)
+				continue;
+			uint32_t timestampCount = 2 + 2 * slot.passCount;
+			uint64_t frequency = 0;
+			bool disjoint = false;
+			if (!backend.TryReadFrame(index, timestampCount, timestamps, frequency, disjoint))
+				break; // later frames can not be done either
+			slot.pending = false;
+			if (disjoint || frequency == 0) {
+				++framesDisjoint;
+				continue;
+			}
+
+			double gpuMsPerTick = 1000.0 / static_cast<double>(frequency);
+			AddSample("Frame", (timestamps[1] - timestamps[0]) * gpuMsPerTick, slot.cpuTicks[0] * cpuMsPerTick);
+			for (uint32_t pass = 0; pass < slot.passCount; ++pass)
+				AddSample(slot.passNames[pass], (timestamps[3 + 2 * pass] - timestamps[2 + 2 * pass]) * gpuMsPerTick,
+					slot.cpuTicks[1 + pass] * cpuMsPerTick);
+			++framesRead;
+		}
+	}
+
+	void GpuProfiler::AddSample(const char* name, double gpuMs, double cpuMs) {
+		auto it = std::find_if(passStats.begin(), passStats.end(), [name](const GpuPassStats& s) { return s.name == name || !strcmp(s.name, name); });
+		if (it == passStats.end()) {
+			passStats.push_back({ name, gpuMs, cpuMs, 1 });
+			return;
+		}
+		it->gpuMs += SMOOTHING * (gpuMs - it->gpuMs);
+		it->cpuMs += SMOOTHING * (cpuMs - it->cpuMs);
+		++it->samples;
+	}
+
+	void GpuProfiler::FormatReport(char* buffer, size_t bufferSize) const {
+		if (bufferSize == 0)
+			return;
+		int written = snprintf(buffer, bufferSize, "GPU timings: %llu frames read, %llu skipped, %llu disjoint\n",
+			static_cast<unsigned long long>(framesRead), static_cast<unsigned long long>(framesSkipped), static_cast<unsigned long long>(framesDisjoint));
+		size_t used = written > 0 ? static_cast<size_t>(written) : 0;
+		for (const GpuPassStats& pass : passStats) {
+			if (used >= bufferSize)
+				break;
+			written = snprintf(buffer + used, bufferSize - used, "  %-20s gpu %7.3f ms  cpu %7.3f ms  %s-bound\n",
+				pass.name, pass.gpuMs, pass.cpuMs, pass.gpuMs > pass.cpuMs ? "GPU" : "CPU");
+			if (written < 0)
+				break;
+			used += static_cast<size_t>(written);
+		}
+	}
+
+	SimulatedGpuTimerBackend::SimulatedGpuTimerBackend(uint64_t frequency, uint32_t latencyFrames)
+		: frequency(frequency), latencyFrames(latencyFrames) {}
+
+	void SimulatedGpuTimerBackend::SetTimestampDelta(uint32_t index, uint64_t ticks) {
+		if (deltas.size() <= index)
+			deltas.resize(index + 1, 1);
+		deltas[index] = ticks;
+	}
+
+	bool SimulatedGpuTimerBackend::CreateQueries(uint32_t frameSlots, uint32_t timestampsPerFrame) {
+		slots.assign(frameSlots, SimulatedSlot{});
+		for (SimulatedSlot& slot : slots)
+			slot.timestamps.assign(timestampsPerFrame, 0);
+		return true;
+	}
+
+	void SimulatedGpuTimerBackend::BeginFrame(uint32_t slot) {
+		slots[slot].disjoint = disjointEvery && ++framesBegun % disjointEvery == 0;
+	}
+
+	void SimulatedGpuTimerBackend::WriteTimestamp(uint32_t slot, uint32_t index) {
+		/* The frame end is written last but has index 1, so order comes from the write, not the index */
+		clock += index < deltas.size() ? deltas[index] : 1;
+		slots[slot].timestamps[index] = clock;
+	}
+
+	void SimulatedGpuTimerBackend::EndFrame(uint32_t slot) {
+		slots[slot].readyAtFrame = presents + latencyFrames;
+	}
+
+	bool SimulatedGpuTimerBackend::TryReadFrame(uint32_t slot, uint32_t timestampCount, uint64_t* timestamps, uint64_t& frequencyOut, bool& disjoint) {
+		const SimulatedSlot& s = slots[slot];
+		if (presents < s.readyAtFrame)
+			return false;
+		std::copy(s.timestamps.begin(), s.timestamps.begin() + timestampCount, timestamps);
+		frequencyOut = frequency;
+		disjoint = s.disjoint;
+		return true;
+	}
+
+} // namespace awesome
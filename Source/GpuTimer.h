@@ -0,0 +1,122 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace awesome {
+
+	/*
+	 * Query objects of one graphics API. Every frame slot has a disjoint query around the frame
+	 * and timestampsPerFrame timestamp queries; TryReadFrame must never wait for the GPU.
+	 */
+	class GpuTimerBackend {
+	public:
+		virtual ~GpuTimerBackend() = default;
+		virtual bool CreateQueries(uint32_t frameSlots, uint32_t timestampsPerFrame) = 0;
+		virtual void BeginFrame(uint32_t slot) = 0;
+		virtual void WriteTimestamp(uint32_t slot, uint32_t index) = 0;
+		virtual void EndFrame(uint32_t slot) = 0;
+		/* False while the GPU has not finished the slot; disjoint means the timestamps are unusable */
+		virtual bool TryReadFrame(uint32_t slot, uint32_t timestampCount, uint64_t* timestamps, uint64_t& frequency, bool& disjoint) = 0;
+	};
+
+	struct GpuPassStats {
+		const char* name;
+		double gpuMs;    // averaged over the last results
+		double cpuMs;    // time the CPU spent recording the pass, same averaging
+		uint32_t samples;
+	};
+
+	/*
+	 * Per-pass GPU timing without stalls. Queries are issued into one of FRAME_LATENCY slots and
+	 * read back frames later; a slot the GPU still has not finished when it comes round again is
+	 * left alone and that frame goes untimed. Pass names must be string literals, passes may not
+	 * nest and there are at most MAX_PASSES per frame.
+	 */
+	class GpuProfiler {
+	public:
+		static constexpr uint32_t FRAME_LATENCY = 4;
+		static constexpr uint32_t MAX_PASSES = 32;
+		/* Weight of the newest result in the running averages */
+		static constexpr double SMOOTHING = 0.05;
+
+		explicit GpuProfiler(GpuTimerBackend& backend);
+
+		bool Init();
+		void BeginFrame();
+		void BeginPass(const char* name);
+		void EndPass();
+		void EndFrame();
+
+		/* The whole frame first, then every pass seen so far in first-seen order */
+		const std::vector<GpuPassStats>& GetPassStats() const { return passStats; }
+		uint64_t GetFramesRead() const { return framesRead; }
+		uint64_t GetFramesSkipped() const { return framesSkipped; }
+		uint64_t GetFramesDisjoint() const { return framesDisjoint; }
+		void FormatReport(char* buffer, size_t bufferSize) const;
+
+	private:
+		struct Slot {
+			bool pending{ false };
+			uint32_t passCount{ 0 };
+			const char* passNames[MAX_PASSES]{};
+			unsigned long long cpuTicks[MAX_PASSES + 1]{}; // index 0 is the frame
+		};
+
+		void CollectFinishedFrames();
+		void AddSample(const char* name, double gpuMs, double cpuMs);
+
+		GpuTimerBackend& backend;
+		bool initialised{ false };
+		uint64_t frameIndex{ 0 };
+		Slot slots[FRAME_LATENCY];
+		Slot* recording{ nullptr };
+		uint32_t recordingSlot{ 0 };
+		unsigned long long frameStartTicks{ 0 };
+		unsigned long long passStartTicks{ 0 };
+		bool passOpen{ false };
+		std::vector<GpuPassStats> passStats;
+		uint64_t framesRead{ 0 };
+		uint64_t framesSkipped{ 0 };
+		uint64_t framesDisjoint{ 0 };
+	};
+
+	/*
+	 * Synthetic timings for testing the ring and readback anywhere: each timestamp is the previous
+	 * one plus a configurable delta, and a frame only becomes readable latencyFrames Presents later.
+	 */
+	class SimulatedGpuTimerBackend : public GpuTimerBackend {
+	public:
+		SimulatedGpuTimerBackend(uint64_t frequency, uint32_t latencyFrames);
+
+		/* Ticks between timestamp index - 1 and index; unset deltas default to one tick */
+		void SetTimestampDelta(uint32_t index, uint64_t ticks);
+		/* Every nth frame reports disjoint, 0 never */
+		void SetDisjointEvery(uint32_t n) { disjointEvery = n; }
+		/* The simulated GPU finishing a frame, call once per frame whether or not it was timed */
+		void Present() { ++presents; }
+
+		bool CreateQueries(uint32_t frameSlots, uint32_t timestampsPerFrame) override;
+		void BeginFrame(uint32_t slot) override;
+		void WriteTimestamp(uint32_t slot, uint32_t index) override;
+		void EndFrame(uint32_t slot) override;
+		bool TryReadFrame(uint32_t slot, uint32_t timestampCount, uint64_t* timestamps, uint64_t& frequency, bool& disjoint) override;
+
+	private:
+		struct SimulatedSlot {
+			std::vector<uint64_t> timestamps;
+			uint64_t readyAtFrame{ 0 };
+			bool disjoint{ false };
+		};
+
+		uint64_t frequency;
+		uint32_t latencyFrames;
+		uint32_t disjointEvery{ 0 };
+		std::vector<uint64_t> deltas;
+		std::vector<SimulatedSlot> slots;
+		uint64_t clock{ 0 };
+		uint64_t presents{ 0 };
+		uint64_t framesBegun{ 0 };
+	};
+
+} // namespace awesome
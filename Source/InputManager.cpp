@@ -1,42 +1,206 @@
 #include "InputManager.h"
 #include <windows.h>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 namespace awesome {
 
-	void InputManager::OnWindowMessage(unsigned int uMsg, unsigned int wParam) {
-		bool isDown = (uMsg == WM_KEYDOWN);
-		if (wParam == 'W')
-			Keys[MoveCameraForward] = isDown;
-		else if (wParam == 'S')
-			Keys[MoveCameraBack] = isDown;
-		else if (wParam == 'A')
-			Keys[MoveCameraLeft] = isDown;
-		else if (wParam == 'D')
-			Keys[MoveCameraRight] = isDown;
-		else if (wParam == 'Q')
-			Keys[RaiseCamera] = isDown;
-		else if (wParam == 'E')
-			Keys[LowerCamera] = isDown;
-		else if (wParam == VK_UP)
-			Keys[LookCameraUp] = isDown;
-		else if (wParam == VK_DOWN)
-			Keys[LookCameraDown] = isDown;
-		else if (wParam == VK_LEFT)
-			Keys[TurnCameraLeft] = isDown;
-		else if (wParam == VK_RIGHT)
-			Keys[TurnCameraRight] = isDown;
+	static_assert(InputAction::Count <= 32, "The action mask has one bit per action");
+	static_assert(InputAction::Count < UNBOUND_KEY, "Actions must fit the key map entries");
+
+	namespace {
+		const char* const ACTION_NAMES[InputAction::Count] = {
+			"RaiseCamera",
+			"LowerCamera",
+			"MoveCameraLeft",
+			"MoveCameraRight",
+			"MoveCameraForward",
+			"MoveCameraBack",
+			"TurnCameraLeft",
+			"TurnCameraRight",
+			"LookCameraUp",
+			"LookCameraDown",
+		};
+
+		struct NamedKey {
+			const char* name;
+			uint8_t key;
+		};
+
+		const NamedKey KEY_NAMES[] = {
+			{ "Up", VK_UP }, { "Down", VK_DOWN }, { "Left", VK_LEFT }, { "Right", VK_RIGHT },
+			{ "Space", VK_SPACE }, { "Shift", VK_SHIFT }, { "Control", VK_CONTROL }, { "Tab", VK_TAB }, { "Enter", VK_RETURN },
+		};
+
+		bool ParseKey(const char* text, uint8_t& key) {
+			if (text[0] && !text[1] && isalnum(static_cast<unsigned char>(text[0]))) {
+				key = static_cast<uint8_t>(toupper(static_cast<unsigned char>(text[0]))); // VK codes of letters and digits are their ASCII
+				return true;
+			}
+			for (const NamedKey& named : KEY_NAMES) {
+				if (!_stricmp(text, named.name)) {
+					key = named.key;
+					return true;
+				}
+			}
+			if ((text[0] == 'F' || text[0] == 'f') && isdigit(static_cast<unsigned char>(text[1]))) {
+				int number = atoi(text + 1);
+				if (number < 1 || number > 12)
+					return false;
+				key = static_cast<uint8_t>(VK_F1 + number - 1);
+				return true;
+			}
+			if (text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+				char* end = nullptr;
+				unsigned long code = strtoul(text + 2, &end, 16);
+				if (end == text + 2 || *end || code == 0 || code >= KEY_COUNT)
+					return false;
+				key = static_cast<uint8_t>(code);
+				return true;
+			}
+			return false;
+		}
+
+		bool ParseAction(const char* text, InputAction& action) {
+			for (uint32_t a = 0; a < InputAction::Count; ++a) {
+				if (!strcmp(text, ACTION_NAMES[a])) {
+					action = static_cast<InputAction>(a);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		/* Trims in place and returns the start */
+		char* Trim(char* text) {
+			while (isspace(static_cast<unsigned char>(*text)))
+				++text;
+			char* end = text + strlen(text);
+			while (end > text && isspace(static_cast<unsigned char>(end[-1])))
+				*--end = '\0';
+			return text;
+		}
+	}
+
+	const char* GetInputActionName(InputAction a) {
+		return a < InputAction::Count ? ACTION_NAMES[a] : "Unknown";
+	}
+
+	InputManager::InputManager() {
+		ResetKeyMap();
+	}
+
+	void InputManager::ResetKeyMap() {
+		ClearKeys();
+		memset(keyToAction, UNBOUND_KEY, sizeof(keyToAction));
+		keyToAction['W'] = MoveCameraForward;
+		keyToAction['S'] = MoveCameraBack;
+		keyToAction['A'] = MoveCameraLeft;
+		keyToAction['D'] = MoveCameraRight;
+		keyToAction['Q'] = RaiseCamera;
+		keyToAction['E'] = LowerCamera;
+		keyToAction[VK_UP] = LookCameraUp;
+		keyToAction[VK_DOWN] = LookCameraDown;
+		keyToAction[VK_LEFT] = TurnCameraLeft;
+		keyToAction[VK_RIGHT] = TurnCameraRight;
+	}
+
+	void InputManager::BindKey(uint8_t key, InputAction a) {
+		ClearKeys();
+		keyToAction[key] = static_cast<uint8_t>(a);
+	}
+
+	void InputManager::UnbindKey(uint8_t key) {
+		ClearKeys();
+		keyToAction[key] = UNBOUND_KEY;
+	}
+
+	bool InputManager::LoadKeyMap(const char* path) {
+		FILE* file = fopen(path, "r");
+		if (!file)
+			return false;
+		uint8_t loaded[KEY_COUNT];
+		memset(loaded, UNBOUND_KEY, sizeof(loaded));
+		bool ok = true;
+		char line[256];
+		while (ok && fgets(line, sizeof(line), file)) {
+			if (char* comment = strchr(line, '#'))
+				*comment = '\0';
+			char* text = Trim(line);
+			if (!*text)
+				continue;
+			char* separator = strchr(text, '=');
+			if (!separator) {
+				ok = false;
+				break;
+			}
+			*separator = '\0';
+			uint8_t key;
+			InputAction action;
+			ok = ParseKey(Trim(text), key) && ParseAction(Trim(separator + 1), action);
+			if (ok)
+				loaded[key] = static_cast<uint8_t>(action);
+		}
+		fclose(file);
+		if (!ok)
+			return false;
+		ClearKeys();
+		memcpy(keyToAction, loaded, sizeof(keyToAction));
+		return true;
+	}
+
+	void InputManager::ApplyEvent(const InputEvent& event) {
+		if (event.type == InputEventType::FocusLost)
+			ClearKeys(); // the key ups go to whichever window has focus now
+		else if ((event.type == InputEventType::KeyDown || event.type == InputEventType::KeyUp) && event.key < KEY_COUNT)
+			OnKey(static_cast<uint8_t>(event.key), event.type == InputEventType::KeyDown);
+	}
+
+	void InputManager::OnKey(uint8_t key, bool isDown) {
+		uint64_t bit = 1ull << (key & 63);
+		uint64_t& word = keysDown[key >> 6];
+		if (((word & bit) != 0) == isDown)
+			return; // repeats, or a key up for a key that went down before the last ClearKeys
+		word ^= bit;
+
+		uint8_t action = keyToAction[key];
+		if (action == UNBOUND_KEY)
+			return;
+		/* The action follows its keys: held while any of them is down */
+		uint8_t& count = heldKeyCount[action];
+		count = isDown ? count + 1 : count - 1;
+		if (count == (isDown ? 1 : 0))
+			SetActionHeld(static_cast<InputAction>(action), isDown);
+	}
+
+	void InputManager::SetActionHeld(InputAction a, bool held) {
+		InputActionMask bit = ActionBit(a);
+		if (((heldActions & bit) != 0) == held)
+			return;
+		heldActions ^= bit;
+		if (held)
+			pressedActions |= bit;
+		else
+			releasedActions |= bit;
 	}
 
 	void InputManager::SetKeyDown(InputAction a, bool value) {
-		Keys[a] = value; 
+		SetActionHeld(a, value);
 	}
 
-	void InputManager::ClearKeys() {
-		ZeroMemory(Keys, sizeof(Keys));
+	void InputManager::SetHeldActions(InputActionMask mask) {
+		pressedActions |= mask & ~heldActions;
+		releasedActions |= heldActions & ~mask;
+		heldActions = mask;
 	}
 
-	bool InputManager::IsKeyDown(InputAction a) const { 
-		return Keys[a]; 
+	void InputManager::ClearKeys() {
+		releasedActions |= heldActions;
+		heldActions = 0;
+		memset(keysDown, 0, sizeof(keysDown));
+		memset(heldKeyCount, 0, sizeof(heldKeyCount));
 	}
 
 	float InputManager::GetPlayerSpeed(unsigned long long deltaMs) const {
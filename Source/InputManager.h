@@ -1,4 +1,6 @@
 #pragma once
+#include "SpscQueue.h"
+#include <cstdint>
 
 namespace awesome {
 
@@ -16,15 +18,86 @@ namespace awesome {
 		Count
 	};
 
+	enum class InputEventType : uint32_t {
+		KeyDown,
+		KeyUp,
+		FocusLost,
+		Resize
+	};
+
+	/* Stamped with Clock ticks on the window thread when the message arrives */
+	struct InputEvent {
+		unsigned long long timestampTicks;
+		InputEventType type;
+		uint32_t key; // virtual key code for KeyDown and KeyUp
+	};
+
+	constexpr size_t INPUT_EVENT_QUEUE_SIZE = 1024;
+	/* Written by the window thread, drained by the simulation thread at the start of each frame */
+	using InputEventQueue = SpscQueue<InputEvent, INPUT_EVENT_QUEUE_SIZE>;
+
+	/* Bit n is InputAction n */
+	using InputActionMask = uint32_t;
+	constexpr uint32_t KEY_COUNT = 256;
+	constexpr uint8_t UNBOUND_KEY = 0xFF;
+
+	constexpr InputActionMask ActionBit(InputAction a) { return 1u << a; }
+	/* +1, -1 or 0 when neither or both are held */
+	inline float GetActionAxis(InputActionMask held, InputAction positive, InputAction negative) {
+		return static_cast<float>(static_cast<int>((held >> positive) & 1) - static_cast<int>((held >> negative) & 1));
+	}
+	const char* GetInputActionName(InputAction a);
+
+	/*
+	 * Keys map to actions through a 256 entry table indexed by virtual key code, several keys may
+	 * share an action. Held actions are a bitmask; pressed and released edge bits collect until
+	 * the next simulation step has seen them (ClearEdges), so a tap shorter than a frame still
+	 * shows up as both a press and a release.
+	 */
 	class InputManager {
 	public:
-		void OnWindowMessage(unsigned int uMsg, unsigned int wParam);
+		InputManager();
+
+		/* Simulation thread only, events other than key changes and focus loss are ignored */
+		void ApplyEvent(const InputEvent& event);
 		void SetKeyDown(InputAction a, bool value);
+		/* Releases everything, e.g. when the window loses focus and the key ups go elsewhere */
 		void ClearKeys();
-		bool IsKeyDown(InputAction a) const;
+		void ClearEdges() { pressedActions = releasedActions = 0; }
+
+		bool IsKeyDown(InputAction a) const { return (heldActions & ActionBit(a)) != 0; }
+		bool WasPressed(InputAction a) const { return (pressedActions & ActionBit(a)) != 0; }
+		bool WasReleased(InputAction a) const { return (releasedActions & ActionBit(a)) != 0; }
+		InputActionMask GetHeldActions() const { return heldActions; }
+		InputActionMask GetPressedActions() const { return pressedActions; }
+		InputActionMask GetReleasedActions() const { return releasedActions; }
+		bool AreAnyHeld(InputActionMask mask) const { return (heldActions & mask) != 0; }
+		bool AreAllHeld(InputActionMask mask) const { return (heldActions & mask) == mask; }
+		/* For replays, which bypass the keys; edges come from the difference to the current state */
+		void SetHeldActions(InputActionMask mask);
+
+		/* Rebinding releases every key, a held key's action may have changed */
+		void BindKey(uint8_t key, InputAction a);
+		void UnbindKey(uint8_t key);
+		void ResetKeyMap();
+		/*
+		 * Lines of "<key> = <action>", '#' starts a comment. Keys are a letter or digit, a name
+		 * (Up, Down, Left, Right, Space, Shift, Control, Tab, Enter, F1-F12) or a hex code like 0x26;
+		 * actions use the InputAction names. Leaves the map untouched and returns false on any error.
+		 */
+		bool LoadKeyMap(const char* path);
 		float GetPlayerSpeed(unsigned long long deltaMs) const;
+
 	private:
-		bool Keys[InputAction::Count];
+		void OnKey(uint8_t key, bool isDown);
+		void SetActionHeld(InputAction a, bool held);
+
+		uint8_t keyToAction[KEY_COUNT];
+		uint64_t keysDown[KEY_COUNT / 64]{};
+		uint8_t heldKeyCount[InputAction::Count]{}; // keys down per action
+		InputActionMask heldActions{ 0 };
+		InputActionMask pressedActions{ 0 };
+		InputActionMask releasedActions{ 0 };
 		float PlayerSpeed{ 1.5f };
 	};
 
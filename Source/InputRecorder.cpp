@@ -0,0 +1,115 @@
+#include "InputRecorder.h"
+#include <cstring>
+
+namespace awesome {
+
+	namespace {
+		bool ReadVarint(const std::vector<uint8_t>& data, size_t& pos, unsigned long long& value) {
+			value = 0;
+			for (uint32_t shift = 0; shift < 64 && pos < data.size(); shift += 7) {
+				uint8_t byte = data[pos++];
+				value |= static_cast<unsigned long long>(byte & 0x7F) << shift;
+				if (!(byte & 0x80))
+					return true;
+			}
+			return false;
+		}
+	}
+
+	InputRecorder::~InputRecorder() {
+		Close();
+	}
+
+	bool InputRecorder::Open(const std::string& path, uint32_t actionCount) {
+		Close();
+		file = fopen(path.c_str(), "wb");
+		if (!file)
+			return false;
+		lastMask = 0;
+		frameCount = 0;
+		writeFailed = false;
+		uint32_t header[3] = { INPUT_RECORDING_MAGIC, INPUT_RECORDING_VERSION, actionCount };
+		writeFailed = fwrite(header, sizeof(header), 1, file) != 1;
+		return !writeFailed;
+	}
+
+	void InputRecorder::WriteVarint(unsigned long long value) {
+		uint8_t bytes[10];
+		size_t count = 0;
+		do {
+			bytes[count] = static_cast<uint8_t>(value & 0x7F);
+			value >>= 7;
+			if (value)
+				bytes[count] |= 0x80;
+			++count;
+		} while (value);
+		writeFailed |= fwrite(bytes, 1, count, file) != count;
+	}
+
+	void InputRecorder::RecordFrame(const InputFrame& frame) {
+		if (!file)
+			return;
+		bool maskChanged = frame.actionMask != lastMask;
+		WriteVarint(frame.deltaNs << 1 | (maskChanged ? 1 : 0));
+		if (maskChanged)
+			WriteVarint(frame.actionMask);
+		lastMask = frame.actionMask;
+		++frameCount;
+	}
+
+	bool InputRecorder::Close() {
+		if (!file)
+			return !writeFailed;
+		bool closed = fclose(file) == 0;
+		file = nullptr;
+		return closed && !writeFailed;
+	}
+
+	bool InputReplay::Load(const std::string& path, uint32_t actionCount) {
+		frames.clear();
+		position = 0;
+		loaded = false;
+
+		FILE* file = fopen(path.c_str(), "rb");
+		if (!file)
+			return false;
+		std::vector<uint8_t> data;
+		uint8_t chunk[4096];
+		size_t read;
+		while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+			data.insert(data.end(), chunk, chunk + read);
+		fclose(file);
+
+		uint32_t header[3];
+		if (data.size() < sizeof(header))
+			return false;
+		memcpy(header, data.data(), sizeof(header));
+		if (header[0] != INPUT_RECORDING_MAGIC || header[1] != INPUT_RECORDING_VERSION || header[2] != actionCount)
+			return false;
+
+		size_t pos = sizeof(header);
+		uint32_t mask = 0;
+		while (pos < data.size()) {
+			unsigned long long value;
+			if (!ReadVarint(data, pos, value))
+				return false;
+			if (value & 1) {
+				unsigned long long newMask;
+				if (!ReadVarint(data, pos, newMask))
+					return false;
+				mask = static_cast<uint32_t>(newMask);
+			}
+			frames.push_back({ value >> 1, mask });
+		}
+		loaded = true;
+		return true;
+	}
+
+	bool InputReplay::NextFrame(InputFrame& frame) {
+		if (position == frames.size())
+			return false;
+		frame = frames[position++];
+		return true;
+	}
+
+} // namespace awesome
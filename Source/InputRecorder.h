@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace awesome {
+
+	/* What the simulation saw in one frame: the time it advanced by and the actions held */
+	struct InputFrame {
+		unsigned long long deltaNs;
+		uint32_t actionMask; // bit n is InputAction n
+	};
+
+	/*
+	 * Input recordings are a small header followed by one record per frame: a varint of
+	 * deltaNs << 1 with the low bit set when the action mask changed, then the new mask as a
+	 * varint if it did. A frame with no change in held keys costs about four bytes.
+	 */
+	constexpr uint32_t INPUT_RECORDING_MAGIC = 0x52494157; // "WAIR" little endian
+	constexpr uint32_t INPUT_RECORDING_VERSION = 1;
+
+	class InputRecorder {
+	public:
+		~InputRecorder();
+
+		/* actionCount is stored so a replay built with a different action set is rejected */
+		bool Open(const std::string& path, uint32_t actionCount);
+		void RecordFrame(const InputFrame& frame);
+		bool Close();
+		bool IsOpen() const { return file != nullptr; }
+		uint64_t GetFrameCount() const { return frameCount; }
+
+	private:
+		void WriteVarint(unsigned long long value);
+
+		FILE* file{ nullptr };
+		uint32_t lastMask{ 0 };
+		uint64_t frameCount{ 0 };
+		bool writeFailed{ false };
+	};
+
+	/* Loads a whole recording up front so replay never touches the disk mid-run */
+	class InputReplay {
+	public:
+		/* False if the file is missing, truncated or recorded with another action count */
+		bool Load(const std::string& path, uint32_t actionCount);
+		/* False once every frame has been replayed */
+		bool NextFrame(InputFrame& frame);
+		bool IsLoaded() const { return loaded; }
+		size_t GetFrameCount() const { return frames.size(); }
+		size_t GetPosition() const { return position; }
+
+	private:
+		std::vector<InputFrame> frames;
+		size_t position{ 0 };
+		bool loaded{ false };
+	};
+
+} // namespace awesome
@@ -0,0 +1,366 @@
+#include "JobSystem.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace awesome {
+
+	namespace {
+		constexpr int64_t DEQUE_MASK = WorkStealingDeque::CAPACITY - 1;
+		static_assert((WorkStealingDeque::CAPACITY & DEQUE_MASK) == 0, "Deque capacity must be a power of two");
+		static_assert((JobSystem::JOBS_PER_THREAD & (JobSystem::JOBS_PER_THREAD - 1)) == 0, "Job slots must be a power of two");
+
+		/* Empty searches before an idle worker sleeps */
+		constexpr uint32_t IDLE_SPINS = 64;
+		/* Ranges per thread ParallelFor aims for, so a slow range can be balanced by stealing the rest */
+		constexpr uint32_t RANGES_PER_THREAD = 4;
+		constexpr uint32_t NO_DEQUE = ~0u;
+
+		struct ThreadContext {
+			const JobSystem* system{ nullptr };
+			uint32_t dequeIndex{ NO_DEQUE };
+			uint32_t nextVictim{ 0 };
+		};
+
+		thread_local ThreadContext threadContext;
+	}
+
+	bool WorkStealingDeque::Push(Job* job) {
+		int64_t b = bottom.load(std::memory_order_relaxed);
+		int64_t t = top.load(std::memory_order_acquire);
+		if (b - t >= CAPACITY)
+			return false;
+		jobs[b & DEQUE_MASK].store(job, std::memory_order_release);
+		bottom.store(b + 1, std::memory_order_release);
+		return true;
+	}
+
+	Job* WorkStealingDeque::Pop() {
+		int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+		bottom.store(b, std::memory_order_relaxed);
+		/* Orders the bottom store before the top load against Steal, which does the opposite */
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = top.load(std::memory_order_relaxed);
+		if (t > b) {
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+		Job* job = jobs[b & DEQUE_MASK].load(std::memory_order_relaxed);
+		if (t == b) {
+			/* Last job, a thief may be taking it right now */
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				job = nullptr;
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return job;
+	}
+
+	Job* WorkStealingDeque::Steal() {
+		int64_t t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = bottom.load(std::memory_order_acquire);
+		if (t >= b)
+			return nullptr;
+		Job* job = jobs[t & DEQUE_MASK].load(std::memory_order_acquire);
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return nullptr; // lost the race to the owner or another thief
+		return job;
+	}
+
+	bool WorkStealingDeque::IsEmpty() const {
+		return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+	}
+
+	JobSystem::JobSystem(uint32_t requestedWorkers) {
+		workerCount = requestedWorkers;
+		if (workerCount == 0) {
+			uint32_t hardwareThreads = std::thread::hardware_concurrency();
+			workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+		deques.reserve(workerCount + MAX_ATTACHED_THREADS);
+		for (uint32_t i = 0; i < workerCount + MAX_ATTACHED_THREADS; ++i)
+			deques.push_back(std::make_unique<WorkStealingDeque>());
+		threadStates = std::make_unique<ThreadState[]>(workerCount + MAX_ATTACHED_THREADS + 1);
+		jobs = std::make_unique<Job[]>(size_t(workerCount + MAX_ATTACHED_THREADS + 1) * JOBS_PER_THREAD);
+		sharedJobs.reserve(JOBS_PER_THREAD);
+		workers.reserve(workerCount);
+		for (uint32_t i = 0; i < workerCount; ++i)
+			workers.emplace_back(&JobSystem::WorkerMain, this, i);
+	}
+
+	JobSystem::~JobSystem() {
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			stopping.store(true);
+		}
+		wake.notify_all();
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	bool JobSystem::AttachThread() {
+		if (GetDequeIndex() != NO_DEQUE)
+			return true;
+		uint32_t slot = attachedThreads.load(std::memory_order_relaxed);
+		do {
+			if (slot == MAX_ATTACHED_THREADS)
+				return false;
+		} while (!attachedThreads.compare_exchange_weak(slot, slot + 1, std::memory_order_acq_rel));
+		threadContext.system = this;
+		threadContext.dequeIndex = GetWorkerCount() + slot;
+		threadContext.nextVictim = threadContext.dequeIndex + 1;
+		return true;
+	}
+
+	void JobSystem::SetMainThread() {
+		AttachThread();
+		mainThreadId = std::this_thread::get_id();
+	}
+
+	void JobSystem::Wait(const JobCounter& counter) {
+		while (counter.pending.load(std::memory_order_acquire) != 0)
+			if (!RunOneJob())
+				std::this_thread::yield();
+		/* The last job may still be releasing the continuation lock, after this the counter can go away */
+		LockContinuations(counter);
+		counter.continuationLock.clear(std::memory_order_release);
+	}
+
+	uint32_t JobSystem::RunMainThreadJobs() {
+		if (!IsMainThread() || mainThreadJobCount.load(std::memory_order_acquire) == 0)
+			return 0;
+		{
+			std::lock_guard<std::mutex> lock(sharedMutex);
+			runningMainThreadJobs.swap(mainThreadJobs);
+			mainThreadJobCount.store(0, std::memory_order_relaxed);
+		}
+		/* Jobs these submit for the main thread run on the next call */
+		for (Job* job : runningMainThreadJobs)
+			Execute(job);
+		uint32_t count = static_cast<uint32_t>(runningMainThreadJobs.size());
+		runningMainThreadJobs.clear();
+		return count;
+	}
+
+	JobSystemStats JobSystem::GetStats() const {
+		JobSystemStats stats;
+		for (uint32_t i = 0; i < GetWorkerCount() + MAX_ATTACHED_THREADS + 1; ++i) {
+			stats.jobsRun += threadStates[i].jobsRun.load(std::memory_order_relaxed);
+			stats.jobsStolen += threadStates[i].jobsStolen.load(std::memory_order_relaxed);
+		}
+		stats.jobsRunInline = jobsRunInline.load(std::memory_order_relaxed);
+		stats.workerSleeps = workerSleeps.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+	void JobSystem::FormatStats(char* buffer, size_t bufferSize) const {
+		JobSystemStats stats = GetStats();
+		snprintf(buffer, bufferSize, "Jobs on %u threads: %llu run, %llu stolen, %llu run inline, %llu worker sleeps\n",
+			GetThreadCount(), static_cast<unsigned long long>(stats.jobsRun), static_cast<unsigned long long>(stats.jobsStolen),
+			static_cast<unsigned long long>(stats.jobsRunInline), static_cast<unsigned long long>(stats.workerSleeps));
+	}
+
+	void JobSystem::LockContinuations(const JobCounter& counter) {
+		while (counter.continuationLock.test_and_set(std::memory_order_acquire))
+			std::this_thread::yield();
+	}
+
+	uint32_t JobSystem::GetDequeIndex() const {
+		return threadContext.system == this ? threadContext.dequeIndex : NO_DEQUE;
+	}
+
+	uint32_t JobSystem::GetThreadStateIndex() const {
+		uint32_t dequeIndex = GetDequeIndex();
+		return dequeIndex != NO_DEQUE ? dequeIndex : GetWorkerCount() + MAX_ATTACHED_THREADS;
+	}
+
+	Job* JobSystem::AllocateJob() {
+		/*
+		 * Slots are recycled in allocation order, the shared set by several threads at once. A slot still in
+		 * use is skipped rather than waited for, its job may be the one running further up this thread's stack.
+		 */
+		ThreadState& state = threadStates[GetThreadStateIndex()];
+		Job* slots = &jobs[size_t(&state - threadStates.get()) * JOBS_PER_THREAD];
+		for (uint32_t attempt = 1;; ++attempt) {
+			Job* job = &slots[state.nextJob.fetch_add(1, std::memory_order_relaxed) & (JOBS_PER_THREAD - 1)];
+			bool expected = true;
+			if (job->finished.compare_exchange_strong(expected, false, std::memory_order_acquire, std::memory_order_relaxed)) {
+				job->next = nullptr;
+				return job;
+			}
+			/* Every slot is taken, make room by running jobs */
+			if (attempt % JOBS_PER_THREAD == 0 && !RunOneJob())
+				std::this_thread::yield();
+		}
+	}
+
+	void JobSystem::Schedule(Job* job, JobCounter* dependency) {
+		if (dependency) {
+			LockContinuations(*dependency);
+			bool waiting = dependency->pending.load(std::memory_order_acquire) != 0;
+			if (waiting) {
+				job->next = dependency->continuations;
+				dependency->continuations = job;
+			}
+			dependency->continuationLock.clear(std::memory_order_release);
+			if (waiting)
+				return;
+		}
+		Enqueue(job);
+	}
+
+	void JobSystem::Enqueue(Job* job) {
+		if (job->mainThread) {
+			std::lock_guard<std::mutex> lock(sharedMutex);
+			mainThreadJobs.push_back(job);
+			mainThreadJobCount.fetch_add(1, std::memory_order_release);
+			return;
+		}
+
+		/* Counted before it becomes visible, so a thief never takes it below zero */
+		queuedJobs.fetch_add(1);
+		uint32_t dequeIndex = GetDequeIndex();
+		if (dequeIndex != NO_DEQUE) {
+			if (!deques[dequeIndex]->Push(job)) {
+				queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+				jobsRunInline.fetch_add(1, std::memory_order_relaxed);
+				Execute(job);
+				return;
+			}
+		} else {
+			std::lock_guard<std::mutex> lock(sharedMutex);
+			sharedJobs.push_back(job);
+			sharedCount.fetch_add(1, std::memory_order_release);
+		}
+		WakeWorker();
+	}
+
+	void JobSystem::Execute(Job* job) {
+		job->run(*job);
+		JobCounter* counter = job->counter;
+		/* The slot can be reused from here on */
+		job->finished.store(true, std::memory_order_release);
+		threadStates[GetThreadStateIndex()].jobsRun.fetch_add(1, std::memory_order_relaxed);
+		if (counter)
+			Finish(*counter);
+	}
+
+	void JobSystem::Finish(JobCounter& counter) {
+		/* The decrement happens under the lock so Wait can tell when the counter is no longer touched */
+		LockContinuations(counter);
+		Job* ready = nullptr;
+		if (counter.pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			ready = counter.continuations;
+			counter.continuations = nullptr;
+		}
+		counter.continuationLock.clear(std::memory_order_release);
+		while (ready) {
+			Job* next = ready->next;
+			Enqueue(ready);
+			ready = next;
+		}
+	}
+
+	bool JobSystem::RunOneJob() {
+		if (mainThreadJobCount.load(std::memory_order_relaxed) != 0 && IsMainThread()) {
+			Job* job = nullptr;
+			{
+				std::lock_guard<std::mutex> lock(sharedMutex);
+				if (!mainThreadJobs.empty()) {
+					job = mainThreadJobs.back();
+					mainThreadJobs.pop_back();
+					mainThreadJobCount.fetch_sub(1, std::memory_order_relaxed);
+				}
+			}
+			if (job) {
+				Execute(job);
+				return true;
+			}
+		}
+		Job* job = FindJob();
+		if (!job)
+			return false;
+		Execute(job);
+		return true;
+	}
+
+	Job* JobSystem::FindJob() {
+		if (queuedJobs.load(std::memory_order_relaxed) == 0)
+			return nullptr;
+
+		uint32_t dequeIndex = GetDequeIndex();
+		if (dequeIndex != NO_DEQUE) {
+			if (Job* job = deques[dequeIndex]->Pop()) {
+				queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+				return job;
+			}
+		}
+
+		if (sharedCount.load(std::memory_order_acquire) != 0) {
+			std::lock_guard<std::mutex> lock(sharedMutex);
+			if (sharedHead < sharedJobs.size()) {
+				Job* job = sharedJobs[sharedHead++];
+				if (sharedHead == sharedJobs.size()) {
+					sharedJobs.clear();
+					sharedHead = 0;
+				}
+				sharedCount.fetch_sub(1, std::memory_order_relaxed);
+				queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+				return job;
+			}
+		}
+
+		/* Round robin over the other deques, starting where the last search stopped */
+		uint32_t dequeCount = GetWorkerCount() + attachedThreads.load(std::memory_order_acquire);
+		for (uint32_t i = 0; i < dequeCount; ++i) {
+			uint32_t victim = threadContext.nextVictim++ % dequeCount;
+			if (victim == dequeIndex)
+				continue;
+			if (Job* job = deques[victim]->Steal()) {
+				queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+				threadStates[GetThreadStateIndex()].jobsStolen.fetch_add(1, std::memory_order_relaxed);
+				return job;
+			}
+		}
+		return nullptr;
+	}
+
+	void JobSystem::WakeWorker() {
+		/* Pairs with the sleeping count going up before a worker checks queuedJobs */
+		if (sleepingWorkers.load() == 0)
+			return;
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		wake.notify_one();
+	}
+
+	void JobSystem::WorkerMain(uint32_t workerIndex) {
+		threadContext.system = this;
+		threadContext.dequeIndex = workerIndex;
+		threadContext.nextVictim = workerIndex + 1;
+
+		uint32_t idleSpins = 0;
+		while (!stopping.load(std::memory_order_relaxed)) {
+			if (RunOneJob()) {
+				idleSpins = 0;
+				continue;
+			}
+			if (++idleSpins < IDLE_SPINS) {
+				std::this_thread::yield();
+				continue;
+			}
+			idleSpins = 0;
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			sleepingWorkers.fetch_add(1);
+			if (queuedJobs.load() == 0 && !stopping.load()) {
+				workerSleeps.fetch_add(1, std::memory_order_relaxed);
+				wake.wait(lock, [this] { return queuedJobs.load() != 0 || stopping.load(); });
+			}
+			sleepingWorkers.fetch_sub(1);
+		}
+	}
+
+	uint32_t JobSystem::GetRangeCount(uint32_t count, uint32_t minItemsPerJob) const {
+		uint32_t byItems = std::max(1u, count / std::max(1u, minItemsPerJob));
+		return std::min(byItems, GetThreadCount() * RANGES_PER_THREAD);
+	}
+
+} // namespace awesome
@@ -0,0 +1,233 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace awesome {
+
+	class JobSystem;
+	struct Job;
+
+	/*
+	 * Counts unfinished jobs. Submitting with a counter adds one, the job finishing takes it away;
+	 * Wait on the counter and jobs submitted with it as a dependency start once it reaches zero.
+	 * A counter can be reused once it is back at zero.
+	 */
+	class JobCounter {
+	public:
+		JobCounter() = default;
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+
+		/* Only a snapshot; free a counter that had jobs only after Wait returned for it */
+		bool IsDone() const { return pending.load(std::memory_order_acquire) == 0; }
+		uint32_t GetPending() const { return pending.load(std::memory_order_acquire); }
+
+	private:
+		friend class JobSystem;
+
+		std::atomic<uint32_t> pending{ 0 };
+		mutable std::atomic_flag continuationLock = ATOMIC_FLAG_INIT;
+		Job* continuations{ nullptr }; // jobs waiting for zero, guarded by continuationLock
+	};
+
+	/* Large enough for a lambda capturing a few pointers and a range */
+	constexpr size_t JOB_PAYLOAD_SIZE = 64;
+
+	struct alignas(64) Job {
+		void (*run)(Job& job){ nullptr };  // calls and destroys the payload
+		JobCounter* counter{ nullptr };
+		Job* next{ nullptr };              // in a counter's continuation list
+		std::atomic<bool> finished{ true };
+		bool mainThread{ false };
+		alignas(16) unsigned char payload[JOB_PAYLOAD_SIZE];
+	};
+
+	/*
+	 * Bounded Chase-Lev work-stealing deque of jobs (Le, Pop, Cohen, Zappa Nardelli 2013). The owning
+	 * thread pushes and pops at the bottom without atomic read-modify-writes unless it competes for
+	 * the last job; any other thread steals from the top with one compare-exchange. Push fails
+	 * instead of growing when the deque is full.
+	 */
+	class WorkStealingDeque {
+	public:
+		static constexpr int64_t CAPACITY = 4096;
+
+		/* Owner only */
+		bool Push(Job* job);
+		/* Owner only, newest first */
+		Job* Pop();
+		/* Any thread, oldest first */
+		Job* Steal();
+		/* Only a snapshot when other threads are running */
+		bool IsEmpty() const;
+
+	private:
+		alignas(64) std::atomic<int64_t> top{ 0 };
+		alignas(64) std::atomic<int64_t> bottom{ 0 };
+		alignas(64) std::atomic<Job*> jobs[CAPACITY]{};
+	};
+
+	struct JobSystemStats {
+		uint64_t jobsRun{ 0 };
+		uint64_t jobsStolen{ 0 };
+		uint64_t jobsRunInline{ 0 };  // submitted to a full deque
+		uint64_t workerSleeps{ 0 };
+	};
+
+	/*
+	 * Work-stealing job scheduler. Worker threads, and every thread that calls AttachThread, own a
+	 * WorkStealingDeque: jobs they submit go to their own deque and idle workers steal from the others.
+	 * Jobs submitted from other threads go through a shared queue. Jobs marked for the main thread,
+	 * for API calls that must stay on one thread like the D3D11 immediate context, only ever run on
+	 * the thread that called SetMainThread, when it calls RunMainThreadJobs or waits.
+	 * Waiting never just blocks: the waiting thread runs jobs until the counter reaches zero, so
+	 * jobs may wait on the jobs they submit. Idle workers spin briefly, then sleep until work arrives.
+	 */
+	class JobSystem {
+	public:
+		/* Owner-thread deques for threads other than the workers */
+		static constexpr uint32_t MAX_ATTACHED_THREADS = 8;
+		/* Job slots per deque, plus one set shared by the threads without one; with all of its slots in use a thread runs jobs until one is free */
+		static constexpr uint32_t JOBS_PER_THREAD = 1024;
+
+		/* 0 workers means one worker per hardware thread except the caller's */
+		explicit JobSystem(uint32_t requestedWorkers = 0);
+		~JobSystem();
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		/* Gives the calling thread its own deque; returns false when every slot is taken */
+		bool AttachThread();
+		/* The calling thread runs the main-thread jobs, it is attached as well; call before any is submitted */
+		void SetMainThread();
+		bool IsMainThread() const { return std::this_thread::get_id() == mainThreadId; }
+
+		template<typename F>
+		void Submit(F&& function, JobCounter* counter = nullptr) {
+			Schedule(MakeJob(std::forward<F>(function), counter, false), nullptr);
+		}
+
+		/* Runs once dependency reaches zero, right away if it already has */
+		template<typename F>
+		void SubmitAfter(JobCounter& dependency, F&& function, JobCounter* counter = nullptr) {
+			Schedule(MakeJob(std::forward<F>(function), counter, false), &dependency);
+		}
+
+		template<typename F>
+		void SubmitToMainThread(F&& function, JobCounter* counter = nullptr) {
+			Schedule(MakeJob(std::forward<F>(function), counter, true), nullptr);
+		}
+
+		/* Runs jobs on the calling thread until counter reaches zero */
+		void Wait(const JobCounter& counter);
+		/* Main thread only; returns how many ran */
+		uint32_t RunMainThreadJobs();
+
+		/*
+		 * Calls function(begin, end) over [0, count) in ranges of at least minItemsPerJob items and
+		 * returns once all have run, the calling thread takes part. A few ranges per thread leave
+		 * room for stealing when some ranges take longer than others.
+		 */
+		template<typename F>
+		void ParallelFor(uint32_t count, uint32_t minItemsPerJob, const F& function) {
+			if (count == 0)
+				return;
+			uint32_t jobCount = GetRangeCount(count, minItemsPerJob);
+			if (jobCount == 1) {
+				function(0u, count);
+				return;
+			}
+			JobCounter counter;
+			uint32_t perJob = (count + jobCount - 1) / jobCount;
+			for (uint32_t begin = perJob; begin < count; begin += perJob) {
+				uint32_t end = begin + perJob < count ? begin + perJob : count;
+				Submit([&function, begin, end] { function(begin, end); }, &counter);
+			}
+			function(0u, perJob);
+			Wait(counter);
+		}
+
+		uint32_t GetWorkerCount() const { return workerCount; }
+		/* Workers and the caller */
+		uint32_t GetThreadCount() const { return GetWorkerCount() + 1; }
+		JobSystemStats GetStats() const;
+		void FormatStats(char* buffer, size_t bufferSize) const;
+
+	private:
+		struct alignas(64) ThreadState {
+			std::atomic<uint32_t> nextJob{ 0 };
+			std::atomic<uint64_t> jobsRun{ 0 };
+			std::atomic<uint64_t> jobsStolen{ 0 };
+		};
+
+		template<typename F>
+		Job* MakeJob(F&& function, JobCounter* counter, bool mainThread) {
+			using Function = std::decay_t<F>;
+			static_assert(sizeof(Function) <= JOB_PAYLOAD_SIZE, "Job captures too much, capture a pointer to the data instead");
+			static_assert(alignof(Function) <= 16, "Job payload is over-aligned");
+			Job* job = AllocateJob();
+			new (job->payload) Function(std::forward<F>(function));
+			job->run = [](Job& self) {
+				Function* stored = std::launder(reinterpret_cast<Function*>(self.payload));
+				(*stored)();
+				stored->~Function();
+			};
+			job->counter = counter;
+			job->mainThread = mainThread;
+			if (counter)
+				counter->pending.fetch_add(1, std::memory_order_relaxed);
+			return job;
+		}
+
+		static void LockContinuations(const JobCounter& counter);
+		uint32_t GetDequeIndex() const;
+		uint32_t GetThreadStateIndex() const;
+		Job* AllocateJob();
+		void Schedule(Job* job, JobCounter* dependency);
+		void Enqueue(Job* job);
+		void Execute(Job* job);
+		void Finish(JobCounter& counter);
+		/* Runs at most one job the calling thread may run; returns false when it found none */
+		bool RunOneJob();
+		Job* FindJob();
+		void WakeWorker();
+		void WorkerMain(uint32_t workerIndex);
+		uint32_t GetRangeCount(uint32_t count, uint32_t minItemsPerJob) const;
+
+		uint32_t workerCount{ 0 };         // set before the workers start
+		std::vector<std::thread> workers;
+		/* Workers first, then attached threads */
+		std::vector<std::unique_ptr<WorkStealingDeque>> deques;
+		std::atomic<uint32_t> attachedThreads{ 0 };
+		/* Per deque, the last one is shared by the threads without a deque */
+		std::unique_ptr<ThreadState[]> threadStates;
+		std::unique_ptr<Job[]> jobs;       // JOBS_PER_THREAD per thread state
+
+		std::mutex sharedMutex;
+		std::vector<Job*> sharedJobs;      // from threads without a deque, FIFO from sharedHead
+		size_t sharedHead{ 0 };
+		std::atomic<uint32_t> sharedCount{ 0 };
+		std::vector<Job*> mainThreadJobs;
+		std::vector<Job*> runningMainThreadJobs;
+		std::atomic<uint32_t> mainThreadJobCount{ 0 };
+		std::thread::id mainThreadId;
+
+		std::mutex sleepMutex;
+		std::condition_variable wake;
+		std::atomic<uint32_t> queuedJobs{ 0 };    // runnable by workers, not taken yet
+		std::atomic<uint32_t> sleepingWorkers{ 0 };
+		std::atomic<uint64_t> jobsRunInline{ 0 };
+		std::atomic<uint64_t> workerSleeps{ 0 };
+		std::atomic<bool> stopping{ false };
+	};
+
+} // namespace awesome
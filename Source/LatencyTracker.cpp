@@ -0,0 +1,85 @@
+#include "LatencyTracker.h"
+#include "Clock.h"
+#include "FrameStats.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace awesome {
+
+	LatencyTracker::LatencyTracker() : ticksPerSec(Clock::QueryTicksPerSec()) {
+		pending.reserve(MAX_PENDING);
+		submitted.reserve(MAX_IN_FLIGHT);
+	}
+
+	void LatencyTracker::OnInput(unsigned long long inputTicks) {
+		if (pending.size() == MAX_PENDING) {
+			droppedEvents.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		pending.push_back(inputTicks);
+	}
+
+	void LatencyTracker::OnSimulated(uint64_t frame) {
+		for (unsigned long long inputTicks : pending)
+			if (!simulated.TryPush({ inputTicks, frame }))
+				droppedEvents.fetch_add(1, std::memory_order_relaxed);
+		pending.clear();
+	}
+
+	void LatencyTracker::OnSubmitted(uint64_t frame) {
+		/* Snapshots the renderer skipped still count, their input is part of every later one */
+		unsigned long long now = Clock::QueryTicks();
+		SimulatedInput input;
+		while (simulated.TryPeek(input) && input.frame <= frame) {
+			simulated.TryPop(input);
+			AddSample(submitMs, TicksToMs(input.inputTicks, now));
+			submitted.push_back(input.inputTicks);
+		}
+	}
+
+	void LatencyTracker::OnPresented() {
+		if (submitted.empty())
+			return;
+		unsigned long long now = Clock::QueryTicks();
+		for (unsigned long long inputTicks : submitted)
+			AddSample(presentMs, TicksToMs(inputTicks, now));
+		submitted.clear();
+	}
+
+	double LatencyTracker::TicksToMs(unsigned long long fromTicks, unsigned long long toTicks) const {
+		return toTicks > fromTicks ? static_cast<double>(toTicks - fromTicks) * 1000.0 / static_cast<double>(ticksPerSec) : 0.0;
+	}
+
+	void LatencyTracker::AddSample(Samples& samples, double ms) {
+		if (samples.ms.size() < MAX_SAMPLES)
+			samples.ms.push_back(ms);
+		else
+			samples.ms[samples.next] = ms;
+		samples.next = (samples.next + 1) % MAX_SAMPLES;
+	}
+
+	LatencySummary LatencyTracker::Summarize(const Samples& samples) {
+		LatencySummary summary;
+		summary.samples = static_cast<uint32_t>(samples.ms.size());
+		if (samples.ms.empty())
+			return summary;
+		std::vector<double> sorted = samples.ms;
+		std::sort(sorted.begin(), sorted.end());
+		summary.p50Ms = Percentile(sorted, 50.0);
+		summary.p95Ms = Percentile(sorted, 95.0);
+		summary.p99Ms = Percentile(sorted, 99.0);
+		summary.maxMs = sorted.back();
+		return summary;
+	}
+
+	void LatencyTracker::FormatStats(char* buffer, size_t bufferSize) const {
+		LatencySummary submit = SummarizeSubmit();
+		LatencySummary present = SummarizePresent();
+		snprintf(buffer, bufferSize,
+			"Input latency over %u events: to submit p50 %.2f ms, p95 %.2f, p99 %.2f, max %.2f; "
+			"to present p50 %.2f ms, p95 %.2f, p99 %.2f, max %.2f; %llu dropped\n",
+			present.samples, submit.p50Ms, submit.p95Ms, submit.p99Ms, submit.maxMs,
+			present.p50Ms, present.p95Ms, present.p99Ms, present.maxMs, static_cast<unsigned long long>(GetDroppedEvents()));
+	}
+
+} // namespace awesome
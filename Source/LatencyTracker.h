@@ -0,0 +1,74 @@
+#pragma once
+#include "SpscQueue.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace awesome {
+
+	struct LatencySummary {
+		uint32_t samples{ 0 };
+		double p50Ms{ 0.0 };
+		double p95Ms{ 0.0 };
+		double p99Ms{ 0.0 };
+		double maxMs{ 0.0 };
+	};
+
+	/*
+	 * Input latency per event, measured from the Clock timestamp the window thread gave the event.
+	 * An event is followed through the first frame snapshot simulated with it: the input state
+	 * changes in OnInput, the effect exists once a simulation step has read it (OnSimulated, which
+	 * may be a frame later when the frame ran no step), reaches the GPU when the renderer submits
+	 * that snapshot or any later one (OnSubmitted) and leaves the app in OnPresented. With vsync on,
+	 * Present returning is not the photon time, the display adds up to a refresh more.
+	 * OnInput and OnSimulated belong to the simulation thread, everything else to the render thread.
+	 */
+	class LatencyTracker {
+	public:
+		/* Rolling window per metric */
+		static constexpr size_t MAX_SAMPLES = 4096;
+		/* Events waiting for a simulation step, beyond this they are counted as dropped */
+		static constexpr size_t MAX_PENDING = 256;
+		/* Simulated events the renderer has not submitted yet */
+		static constexpr size_t MAX_IN_FLIGHT = 1024;
+
+		LatencyTracker();
+
+		void OnInput(unsigned long long inputTicks);
+		/* The pending events are part of the snapshot with this frame number */
+		void OnSimulated(uint64_t frame);
+		/* The snapshot with this frame number was submitted, it includes every earlier one */
+		void OnSubmitted(uint64_t frame);
+		void OnPresented();
+
+		LatencySummary SummarizeSubmit() const { return Summarize(submitMs); }
+		LatencySummary SummarizePresent() const { return Summarize(presentMs); }
+		uint64_t GetDroppedEvents() const { return droppedEvents.load(std::memory_order_relaxed); }
+		void FormatStats(char* buffer, size_t bufferSize) const;
+
+	private:
+		struct SimulatedInput {
+			unsigned long long inputTicks;
+			uint64_t frame;
+		};
+
+		struct Samples {
+			std::vector<double> ms;
+			size_t next{ 0 };
+		};
+
+		static void AddSample(Samples& samples, double ms);
+		static LatencySummary Summarize(const Samples& samples);
+		double TicksToMs(unsigned long long fromTicks, unsigned long long toTicks) const;
+
+		unsigned long long ticksPerSec;
+		std::vector<unsigned long long> pending;   // applied, not simulated yet
+		SpscQueue<SimulatedInput, MAX_IN_FLIGHT> simulated;
+		std::vector<unsigned long long> submitted; // submitted, not presented yet
+		Samples submitMs;
+		Samples presentMs;
+		std::atomic<uint64_t> droppedEvents{ 0 };
+	};
+
+} // namespace awesome
@@ -3,21 +3,77 @@
 #endif // !UNICODE
 
 #include <windows.h>
+#include <shellapi.h>
 #include "TimeManager.h"
+#include "Clock.h"
 #include "D3DRenderer.h"
 #include "InputManager.h"
 #include "Camera.h"
+#include "FixedTimestep.h"
+#include "FramePacer.h"
+#include "Profiler.h"
+#include "FrameStats.h"
+#include "LatencyTracker.h"
+#include "InputRecorder.h"
+#include "EventPump.h"
+#include "FrameSnapshot.h"
+#include "JobSystem.h"
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
-void MainLoop();
+void MainLoop(HWND windowHandle);
+void SimulationLoop(HWND windowHandle);
+void RenderLoop();
+void WriteFrameStats();
+void PostInputEvent(awesome::InputEventType type, unsigned int key);
+bool ParseCommandLine();
 
 awesome::TimeManager timeManager{};
+awesome::TimeManager renderTimeManager{};
 awesome::D3DRenderer renderer{};
 awesome::InputManager inputManager{};
 awesome::Camera camera{ &inputManager };
+awesome::FixedTimestep simulationStep{ 1.0 / 120.0 };
+awesome::FramePacer framePacer{};
+awesome::FrameStats frameStats{};
+awesome::LatencyTracker latencyTracker{};
+awesome::InputEventQueue inputEvents{};
+awesome::EventPump eventPump{ inputEvents };
+awesome::JobSystem jobSystem{};
+std::atomic<bool> quitRequested{ false };
+std::atomic<unsigned long long> droppedInputEvents{ 0 };
+awesome::InputRecorder inputRecorder{};
+awesome::InputReplay inputReplay{};
+unsigned long long fixedDeltaNs{ 0 }; // --fixed-dt, 0 simulates with the measured or recorded frame time
+awesome::FrameSnapshotBuffer frameSnapshots{};
+uint64_t publishedSnapshots{ 0 }; // simulation thread
+uint64_t skippedSnapshots{ 0 };   // simulation thread
+/* Only to put the render thread to sleep until there is something to draw, the handoff itself is lock-free */
+std::mutex snapshotMutex;
+std::condition_variable snapshotPublished;
+bool simulationFinished{ false }; // guarded by snapshotMutex
+std::atomic<bool> statsDumpRequested{ false };
+
+/* Posted by the game thread once it has stopped touching the window, which may then be destroyed */
+constexpr UINT WM_APP_GAME_THREAD_EXITED = WM_APP + 1;
+
+/* Vsync still applies on top, the target only matters when it is off or slower than the display */
+constexpr double TARGET_FRAME_TIME_SEC = 1.0 / 144.0;
+constexpr double MINIMIZED_FRAME_TIME_SEC = 1.0 / 10.0;
 
 int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE /*hPrevInstance*/, _In_ LPWSTR /*lpCmdLine*/, _In_ int nShowCmd)
 {
+    if (!ParseCommandLine()) {
+        MessageBoxA(0, "Usage: Direct3d11Renderer [--record <file>] [--replay <file>] [--keymap <file>] [--fixed-dt <seconds>]\n"
+            "A recording or key map could not be opened, or a recording was made by a build with different input actions.", "Fatal Error", MB_OK);
+        return 1;
+    }
+
     const wchar_t CLASS_NAME[] = L"Direct 3D 11 renderer";
     /* register a windows class */
     WNDCLASSEXW winClass = {};
@@ -56,11 +112,65 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE /*hPrevInstance
         return GetLastError();
     }
 
-    renderer.Init(windowHandle, &timeManager, &inputManager, &camera);
-    MainLoop();
+    /* Simulation and rendering get their own thread, so a message loop stuck in a modal move or resize never holds up a frame */
+    std::thread gameThread([windowHandle] {
+        renderer.Init(windowHandle, &latencyTracker, &jobSystem);
+        MainLoop(windowHandle);
+        PostMessageW(windowHandle, WM_APP_GAME_THREAD_EXITED, 0, 0);
+    });
+
+    MSG msg = { };
+    while (GetMessageW(&msg, 0, 0, 0) > 0)
+    {
+        TranslateMessage(&msg);
+        DispatchMessageW(&msg);
+    }
+    quitRequested = true;
+    gameThread.join();
     return 0;
 }
 
+std::string ToNarrow(const wchar_t* text) {
+    int size = WideCharToMultiByte(CP_ACP, 0, text, -1, nullptr, 0, nullptr, nullptr);
+    std::string narrow(size > 0 ? size - 1 : 0, '\0');
+    if (size > 1)
+        WideCharToMultiByte(CP_ACP, 0, text, -1, &narrow[0], size, nullptr, nullptr);
+    return narrow;
+}
+
+/* --record <file> writes the simulated input and frame times, --replay <file> plays them back instead of the keyboard */
+bool ParseCommandLine() {
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if (!argv)
+        return false;
+    bool ok = true;
+    for (int i = 1; i < argc && ok; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!wcscmp(argv[i], L"--record") && hasValue)
+            ok = inputRecorder.Open(ToNarrow(argv[++i]), awesome::InputAction::Count);
+        else if (!wcscmp(argv[i], L"--replay") && hasValue)
+            ok = inputReplay.Load(ToNarrow(argv[++i]), awesome::InputAction::Count);
+        else if (!wcscmp(argv[i], L"--keymap") && hasValue)
+            ok = inputManager.LoadKeyMap(ToNarrow(argv[++i]).c_str());
+        else if (!wcscmp(argv[i], L"--fixed-dt") && hasValue) {
+            double seconds = _wtof(argv[++i]);
+            fixedDeltaNs = static_cast<unsigned long long>(seconds * 1e9 + 0.5);
+            ok = fixedDeltaNs > 0;
+        }
+        else
+            ok = false;
+    }
+    LocalFree(argv);
+    return ok;
+}
+
+/* Window thread only, the one producer of inputEvents */
+void PostInputEvent(awesome::InputEventType type, unsigned int key) {
+    if (!inputEvents.TryPush({ awesome::Clock::QueryTicks(), type, key }))
+        droppedInputEvents.fetch_add(1, std::memory_order_relaxed);
+}
+
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
     LPCREATESTRUCT a = LPCREATESTRUCT(lParam);
@@ -68,6 +178,12 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
     LRESULT result = 0;
     switch (uMsg)
     {
+    case WM_CLOSE:
+        quitRequested = true; // destroyed once the game thread is done with it
+        break;
+    case WM_APP_GAME_THREAD_EXITED:
+        DestroyWindow(hwnd);
+        break;
     case WM_DESTROY:
         PostQuitMessage(0);
         break;
@@ -82,15 +198,20 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
     }
     case WM_SIZE:
     {
-        renderer.SetWindowsResized(true);
+        PostInputEvent(awesome::InputEventType::Resize, 0);
         break;
     }
+    case WM_KILLFOCUS:
+        PostInputEvent(awesome::InputEventType::FocusLost, 0);
+        break;
     case WM_KEYDOWN:
     case WM_KEYUP:
         if (wParam == VK_ESCAPE)
-            DestroyWindow(hwnd);
-        else
-            inputManager.OnWindowMessage(uMsg, static_cast<unsigned int>(wParam));
+            quitRequested = true;
+        else if (uMsg == WM_KEYUP)
+            PostInputEvent(awesome::InputEventType::KeyUp, static_cast<unsigned int>(wParam));
+        else if (!(lParam & (1 << 30))) // skip auto-repeat, the key is already down
+            PostInputEvent(awesome::InputEventType::KeyDown, static_cast<unsigned int>(wParam));
         break;
     default:
         result = DefWindowProc(hwnd, uMsg, wParam, lParam);
@@ -98,21 +219,184 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
     return result;
 }
 
-void MainLoop() {
-    MSG msg = { };
-    unsigned long long dt{ 0 };
+/* Runs on the game thread: simulation stays here, rendering gets its own thread */
+void MainLoop(HWND windowHandle) {
+    std::thread renderThread(RenderLoop);
+    SimulationLoop(windowHandle);
+    renderThread.join();
+
+    char statsLine[320];
+    framePacer.FormatStats(statsLine, sizeof(statsLine));
+    OutputDebugStringA(statsLine);
+    eventPump.FormatStats(statsLine, sizeof(statsLine));
+    OutputDebugStringA(statsLine);
+    snprintf(statsLine, sizeof(statsLine), "Frame snapshots: %llu published, %llu replaced before the renderer took them\n",
+        static_cast<unsigned long long>(publishedSnapshots), static_cast<unsigned long long>(skippedSnapshots));
+    OutputDebugStringA(statsLine);
+    jobSystem.FormatStats(statsLine, sizeof(statsLine));
+    OutputDebugStringA(statsLine);
+    if (inputRecorder.IsOpen()) {
+        unsigned long long recordedFrames = inputRecorder.GetFrameCount();
+        bool written = inputRecorder.Close();
+        snprintf(statsLine, sizeof(statsLine), "Input recording: %llu frames%s\n", recordedFrames, written ? "" : ", write failed");
+        OutputDebugStringA(statsLine);
+    }
+    if (inputReplay.IsLoaded()) {
+        /* Compare the final position between runs to check a replay stayed deterministic */
+        const float3& position = camera.GetPosition();
+        snprintf(statsLine, sizeof(statsLine), "Input replay: %zu of %zu frames, camera ends at (%.6f, %.6f, %.6f)\n",
+            inputReplay.GetPosition(), inputReplay.GetFrameCount(), position.x, position.y, position.z);
+        OutputDebugStringA(statsLine);
+    }
+    if (droppedInputEvents > 0) {
+        snprintf(statsLine, sizeof(statsLine), "Input queue overflowed, %llu events dropped\n", droppedInputEvents.load());
+        OutputDebugStringA(statsLine);
+    }
+    WriteFrameStats();
+
+#ifdef AWESOME_PROFILER
+    snprintf(statsLine, sizeof(statsLine), "Profile clock: %s, %llu ticks/s\n",
+        awesome::GetClockBackendName(awesome::ProfileClock::GetBackend()), awesome::ProfileClock::QueryTicksPerSec());
+    OutputDebugStringA(statsLine);
+    char hierarchy[4096];
+    awesome::Profiler::FormatFrameHierarchy(hierarchy, sizeof(hierarchy));
+    OutputDebugStringA(hierarchy);
+    awesome::Profiler::WriteChromeTrace("profile.json");
+#endif
+}
+
+/* Input, fixed steps and one published snapshot per frame; never waits for the renderer */
+void SimulationLoop(HWND windowHandle) {
+    double dt{ 0.0 };
     bool isRunning = true;
+    jobSystem.AttachThread();
+    timeManager.Tick(); // the first frame should not include window creation and Init
 
     while (isRunning)
     {
         dt = timeManager.Tick();
-        if (PeekMessageW(&msg, 0, 0, 0, PM_REMOVE))
+        /* Everything queued since the last frame is applied before the simulation reads it */
         {
-            if (msg.message == WM_QUIT)
+            PROFILE_SCOPE("Input");
+            eventPump.Drain([](const awesome::InputEvent& event) {
+                if (event.type == awesome::InputEventType::Resize)
+                    renderer.SetWindowsResized(true);
+                else if (event.type == awesome::InputEventType::KeyDown && event.key == VK_F2)
+                    statsDumpRequested = true; // the stats belong to the render thread
+                else if (!inputReplay.IsLoaded())
+                    inputManager.ApplyEvent(event);
+                if (event.type == awesome::InputEventType::KeyDown || event.type == awesome::InputEventType::KeyUp)
+                    latencyTracker.OnInput(event.timestampTicks);
+            });
+            if (quitRequested)
                 isRunning = false;
-            TranslateMessage(&msg);
-            DispatchMessage(&msg);
         }
-        renderer.Render(dt);
+
+        /* Replays see the recorded (or fixed) time instead of the wall clock, so the camera path is identical every run */
+        unsigned long long simDeltaNs = fixedDeltaNs > 0 ? fixedDeltaNs : timeManager.GetDeltaNs();
+        if (inputReplay.IsLoaded()) {
+            awesome::InputFrame frame;
+            if (!inputReplay.NextFrame(frame))
+                break;
+            inputManager.SetHeldActions(frame.actionMask);
+            if (fixedDeltaNs == 0)
+                simDeltaNs = frame.deltaNs;
+        }
+        inputRecorder.RecordFrame({ simDeltaNs, inputManager.GetHeldActions() });
+        double simDt = simDeltaNs * 1e-9;
+
+        /* Simulate in fixed steps, render in between the last two steps */
+        {
+            PROFILE_SCOPE("Simulation");
+            uint32_t steps = simulationStep.Advance(simDt);
+            for (uint32_t i = 0; i < steps; ++i) {
+                camera.UpdateCamera(static_cast<float>(simulationStep.GetStepSec()));
+                inputManager.ClearEdges(); // one step sees each press and release
+            }
+            if (steps > 0)
+                latencyTracker.OnSimulated(publishedSnapshots);
+            camera.Interpolate(static_cast<float>(simulationStep.GetAlpha()));
+        }
+
+        {
+            PROFILE_SCOPE("Publish snapshot");
+            awesome::FrameSnapshot& snapshot = frameSnapshots.GetWriteBuffer();
+            snapshot.frame = publishedSnapshots;
+            /* The camera is interpolated between the previous and the latest step, the animation time has to match it */
+            double interpolatedSteps = static_cast<double>(simulationStep.GetTotalSteps()) - 1.0 + simulationStep.GetAlpha();
+            snapshot.timeSec = std::max(0.0, interpolatedSteps) * simulationStep.GetStepSec();
+            snapshot.deltaTimeSec = simDt;
+            snapshot.viewMatrix = camera.GetViewMatrix();
+            snapshot.cameraPosition = camera.GetPosition();
+            snapshot.objectTransforms.clear();
+            snapshot.objectTransforms.push_back(rotateYMat(static_cast<float>(0.2 * M_PI * snapshot.timeSec))); // Spin the quad
+            if (frameSnapshots.Publish())
+                ++skippedSnapshots;
+            ++publishedSnapshots;
+            {
+                std::lock_guard<std::mutex> lock(snapshotMutex);
+            }
+            snapshotPublished.notify_one();
+        }
+
+        /* Nothing is visible while minimized, keep the loop alive without spinning a core */
+        {
+            PROFILE_SCOPE("FramePacer::Wait");
+            framePacer.SetTargetFrameTime(IsIconic(windowHandle) ? MINIMIZED_FRAME_TIME_SEC : TARGET_FRAME_TIME_SEC);
+            framePacer.Wait();
+        }
+        PROFILE_FRAME_END();
     }
+
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        simulationFinished = true;
+    }
+    snapshotPublished.notify_one();
+}
+
+/* Renders the newest snapshot, overlapping with the simulation of the next one; frame times are measured here */
+void RenderLoop() {
+    /* Jobs that need the immediate context are handed to this thread */
+    jobSystem.SetMainThread();
+    renderTimeManager.Tick();
+    for (;;)
+    {
+        {
+            PROFILE_SCOPE("Wait for snapshot");
+            std::unique_lock<std::mutex> lock(snapshotMutex);
+            snapshotPublished.wait(lock, [] { return frameSnapshots.HasNew() || simulationFinished; });
+        }
+        if (!frameSnapshots.AcquireLatest())
+            break; // the simulation has finished and everything it published was rendered
+        jobSystem.RunMainThreadJobs();
+        renderer.Render(frameSnapshots.GetReadBuffer());
+
+        double dt = renderTimeManager.Tick();
+        if (frameStats.AddFrame(dt)) {
+            char hitchLine[96];
+            snprintf(hitchLine, sizeof(hitchLine), "Hitch: %.2f ms frame, median %.2f ms\n", dt * 1000.0, frameStats.GetMedianMs());
+            OutputDebugStringA(hitchLine);
+        }
+        if (statsDumpRequested.exchange(false))
+            WriteFrameStats();
+    }
+}
+
+/* Written on exit and whenever F2 is pressed, each dump replaces the last. Render thread, or after it has stopped */
+void WriteFrameStats() {
+    awesome::FrameStatsSummary summary = frameStats.Summarize();
+    char statsLine[320];
+    snprintf(statsLine, sizeof(statsLine), "Frame times over %u frames: mean %.2f ms, p50 %.2f, p95 %.2f, p99 %.2f, max %.2f, %llu hitches\n",
+        summary.frames, summary.meanMs, summary.p50Ms, summary.p95Ms, summary.p99Ms, summary.maxMs, static_cast<unsigned long long>(summary.hitches));
+    OutputDebugStringA(statsLine);
+    latencyTracker.FormatStats(statsLine, sizeof(statsLine));
+    OutputDebugStringA(statsLine);
+    char gpuReport[1024];
+    renderer.FormatGpuReport(gpuReport, sizeof(gpuReport));
+    OutputDebugStringA(gpuReport);
+    renderer.FormatCommandStats(statsLine, sizeof(statsLine));
+    OutputDebugStringA(statsLine);
+    frameStats.WriteCsv("frame_stats.csv");
+    frameStats.WriteJson("frame_stats.json");
 }
@@ -0,0 +1,1084 @@
+#include "PixelConversion.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define AWESOME_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define AWESOME_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* MSVC lets any function use any intrinsic, GCC and Clang need to be told per function */
+#if defined(_MSC_VER) && !defined(__clang__)
+#define AWESOME_TARGET_SSE2
+#define AWESOME_TARGET_AVX2
+#else
+#define AWESOME_TARGET_SSE2 __attribute__((target("sse2")))
+#define AWESOME_TARGET_AVX2 __attribute__((target("avx2,f16c")))
+#endif
+
+namespace awesome {
+
+	/* ---- Scalar helpers and lookup tables ---- */
+
+	uint16_t FloatToHalf(float f) {
+		// Round to nearest even, overflow goes to infinity, NaN stays NaN (same as F16C)
+		uint32_t x;
+		memcpy(&x, &f, sizeof(x));
+		uint32_t sign = (x >> 16) & 0x8000u;
+		x &= 0x7FFFFFFFu;
+		if (x >= 0x47800000u) // too large for half, infinity or NaN
+			return static_cast<uint16_t>(sign | (x > 0x7F800000u ? 0x7E00u : 0x7C00u));
+		if (x < 0x38800000u) { // half denormal or zero, let the FPU do the rounding
+			const uint32_t denormMagicBits = ((127 - 15) + (23 - 10) + 1) << 23;
+			float denormMagic;
+			memcpy(&denormMagic, &denormMagicBits, sizeof(denormMagic));
+			float v;
+			memcpy(&v, &x, sizeof(v));
+			v += denormMagic;
+			memcpy(&x, &v, sizeof(x));
+			return static_cast<uint16_t>(sign | (x - denormMagicBits));
+		}
+		uint32_t mantissaOdd = (x >> 13) & 1u;
+		x += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFFu + mantissaOdd;
+		return static_cast<uint16_t>(sign | (x >> 13));
+	}
+
+	float HalfToFloat(uint16_t h) {
+		uint32_t sign = static_cast<uint32_t>(h & 0x8000u) << 16;
+		uint32_t exponent = (h >> 10) & 0x1Fu;
+		uint32_t mantissa = h & 0x3FFu;
+		uint32_t bits;
+		if (exponent == 0) {
+			float v = ldexpf(static_cast<float>(mantissa), -24);
+			memcpy(&bits, &v, sizeof(bits));
+		}
+		else if (exponent == 31) {
+			bits = 0x7F800000u | (mantissa << 13);
+		}
+		else {
+			bits = ((exponent + 112) << 23) | (mantissa << 13);
+		}
+		bits |= sign;
+		float f;
+		memcpy(&f, &bits, sizeof(f));
+		return f;
+	}
+
+	static float SrgbToLinear(float c) {
+		return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	static float LinearToSrgb(float c) {
+		return c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+	}
+
+	/* Unsigned float with a 5 bit exponent (bias 15) and mantissaBits of mantissa, as used by R11G11B10 */
+	static uint32_t FloatToSmallFloat(float f, int mantissaBits) {
+		if (!(f > 0.f))
+			return 0;
+		int e;
+		float m = frexpf(f, &e); // f = m * 2^e, m in [0.5, 1)
+		int exponent = e - 1 + 15;
+		if (exponent <= 0) // denormal, rounding up into the smallest normal still encodes correctly
+			return static_cast<uint32_t>(lrintf(ldexpf(f, 14 + mantissaBits)));
+		uint32_t mantissa = static_cast<uint32_t>(lrintf((m * 2.f - 1.f) * static_cast<float>(1 << mantissaBits)));
+		if (mantissa == (1u << mantissaBits)) {
+			mantissa = 0;
+			++exponent;
+		}
+		if (exponent >= 31)
+			return (30u << mantissaBits) | ((1u << mantissaBits) - 1); // largest finite value
+		return (static_cast<uint32_t>(exponent) << mantissaBits) | mantissa;
+	}
+
+	static float SmallFloatToFloat(uint32_t v, int mantissaBits) {
+		uint32_t exponent = v >> mantissaBits;
+		uint32_t mantissa = v & ((1u << mantissaBits) - 1);
+		if (exponent == 0)
+			return ldexpf(static_cast<float>(mantissa), -14 - mantissaBits);
+		if (exponent == 31)
+			return mantissa ? NAN : INFINITY;
+		return ldexpf(1.f + static_cast<float>(mantissa) / static_cast<float>(1 << mantissaBits), static_cast<int>(exponent) - 15);
+	}
+
+	static uint8_t FloatToUnorm8(float f) {
+		f = f > 0.f ? f : 0.f; // also maps NaN to 0
+		f = f < 1.f ? f : 1.f;
+		return static_cast<uint8_t>(lrintf(f * 255.f));
+	}
+
+	static constexpr int LINEAR_TO_SRGB_STEPS = 4096;
+
+	static uint8_t LinearFloatToSrgb8(float f, const int32_t* linear12ToSrgb) {
+		f = f > 0.f ? f : 0.f;
+		f = f < 1.f ? f : 1.f;
+		return static_cast<uint8_t>(linear12ToSrgb[lrintf(f * (LINEAR_TO_SRGB_STEPS - 1))]);
+	}
+
+	/* AVX2 gathers 32 bits per entry, the narrower tables it gathers from are padded so the last read stays inside them */
+	constexpr size_t GATHER_PADDING = 3;
+
+	struct ConversionTables {
+		uint8_t srgbToLinear[256];
+		uint8_t linearToSrgb[256];
+		uint16_t unormToHalf[256];
+		uint16_t srgbToHalf[256 + 1]{};
+		float srgbToFloat[256];
+		int32_t linear12ToSrgb[LINEAR_TO_SRGB_STEPS]; // 32 bit entries so AVX2 can gather them
+		uint32_t packR11[2][256];                     // [srgbDecode][byte], already shifted into place
+		uint32_t packG11[2][256];
+		uint32_t packB10[2][256];
+		uint8_t unpack11[2][2048 + GATHER_PADDING]{}; // [srgbEncode][value]
+		uint8_t unpack10[2][1024 + GATHER_PADDING]{};
+		uint8_t halfToUnorm[2][65536];                // [srgbEncode][half bits]
+		uint8_t srgbToHalfBytes[2][256];              // [low, high byte] of srgbToHalf, NEON looks up bytes
+		uint8_t srgbToR11Bytes[2][256];               // [low, high byte] of the 11 bit value in packR11[1]
+		uint8_t srgbToB10Bytes[2][256];               // [low, high byte] of the 10 bit value in packB10[1]
+
+		ConversionTables() {
+			for (int i = 0; i < 256; ++i) {
+				float unorm = static_cast<float>(i) / 255.f;
+				float linear = SrgbToLinear(unorm);
+				srgbToLinear[i] = FloatToUnorm8(linear);
+				linearToSrgb[i] = FloatToUnorm8(LinearToSrgb(unorm));
+				unormToHalf[i] = FloatToHalf(unorm);
+				srgbToHalf[i] = FloatToHalf(linear);
+				srgbToFloat[i] = linear;
+				for (int srgb = 0; srgb < 2; ++srgb) {
+					float v = srgb ? linear : unorm;
+					packR11[srgb][i] = FloatToSmallFloat(v, 6);
+					packG11[srgb][i] = FloatToSmallFloat(v, 6) << 11;
+					packB10[srgb][i] = FloatToSmallFloat(v, 5) << 22;
+				}
+				for (int byte = 0; byte < 2; ++byte) {
+					srgbToHalfBytes[byte][i] = static_cast<uint8_t>(srgbToHalf[i] >> (8 * byte));
+					srgbToR11Bytes[byte][i] = static_cast<uint8_t>(packR11[1][i] >> (8 * byte));
+					srgbToB10Bytes[byte][i] = static_cast<uint8_t>(packB10[1][i] >> (22 + 8 * byte));
+				}
+			}
+			for (int i = 0; i < LINEAR_TO_SRGB_STEPS; ++i)
+				linear12ToSrgb[i] = FloatToUnorm8(LinearToSrgb(static_cast<float>(i) / (LINEAR_TO_SRGB_STEPS - 1)));
+			for (uint32_t h = 0; h < 65536; ++h) {
+				float f = HalfToFloat(static_cast<uint16_t>(h));
+				halfToUnorm[0][h] = FloatToUnorm8(f);
+				halfToUnorm[1][h] = LinearFloatToSrgb8(f, linear12ToSrgb);
+			}
+			for (int srgb = 0; srgb < 2; ++srgb) {
+				for (uint32_t v = 0; v < 2048; ++v) {
+					float f = SmallFloatToFloat(v, 6);
+					unpack11[srgb][v] = FloatToUnorm8(srgb ? LinearToSrgb(f > 1.f ? 1.f : f) : f);
+				}
+				for (uint32_t v = 0; v < 1024; ++v) {
+					float f = SmallFloatToFloat(v, 5);
+					unpack10[srgb][v] = FloatToUnorm8(srgb ? LinearToSrgb(f > 1.f ? 1.f : f) : f);
+				}
+			}
+		}
+	};
+
+	static const ConversionTables& GetTables() {
+		static const ConversionTables tables;
+		return tables;
+	}
+
+	static inline uint8_t MulDiv255(uint32_t c, uint32_t a) {
+		uint32_t t = c * a + 128; // exact round(c * a / 255)
+		return static_cast<uint8_t>((t + (t >> 8)) >> 8);
+	}
+
+	/* ---- CPU detection ---- */
+
+#if AWESOME_SIMD_X86
+	static void Cpuid(int leaf, int subleaf, uint32_t regs[4]) {
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuidex(info, leaf, subleaf);
+		for (int i = 0; i < 4; ++i)
+			regs[i] = static_cast<uint32_t>(info[i]);
+#else
+		__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+	}
+
+	static uint64_t Xgetbv0() {
+#if defined(_MSC_VER)
+		return _xgetbv(0);
+#else
+		uint32_t eax, edx;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+	}
+#endif
+
+	static SimdLevel DetectSimdLevel() {
+#if AWESOME_SIMD_X86
+		uint32_t regs[4];
+		Cpuid(0, 0, regs);
+		uint32_t maxLeaf = regs[0];
+		Cpuid(1, 0, regs);
+		bool sse2 = (regs[3] & (1u << 26)) != 0;
+		bool osxsave = (regs[2] & (1u << 27)) != 0;
+		bool avx = (regs[2] & (1u << 28)) != 0;
+		bool f16c = (regs[2] & (1u << 29)) != 0;
+		bool avx2 = false;
+		if (maxLeaf >= 7) {
+			Cpuid(7, 0, regs);
+			avx2 = (regs[1] & (1u << 5)) != 0;
+		}
+		bool osSavesYmm = osxsave && (Xgetbv0() & 6) == 6;
+		if (avx && avx2 && f16c && osSavesYmm)
+			return SimdLevel::AVX2;
+		return sse2 ? SimdLevel::SSE2 : SimdLevel::Scalar;
+#elif AWESOME_SIMD_NEON
+		return SimdLevel::NEON;
+#else
+		return SimdLevel::Scalar;
+#endif
+	}
+
+	static SimdLevel& DetectedLevel() {
+		static SimdLevel level = DetectSimdLevel();
+		return level;
+	}
+
+	static SimdLevel& ActiveLevel() {
+		static SimdLevel level = DetectedLevel();
+		return level;
+	}
+
+	SimdLevel GetSimdLevel() {
+		return ActiveLevel();
+	}
+
+	SimdLevel ForceSimdLevel(SimdLevel level) {
+		SimdLevel detected = DetectedLevel();
+		if (level == SimdLevel::Scalar || level == detected)
+			ActiveLevel() = level;
+		else if (level == SimdLevel::SSE2 && detected == SimdLevel::AVX2)
+			ActiveLevel() = level;
+		return ActiveLevel();
+	}
+
+	const char* GetSimdLevelName(SimdLevel level) {
+		switch (level) {
+		case SimdLevel::SSE2: return "SSE2";
+		case SimdLevel::AVX2: return "AVX2";
+		case SimdLevel::NEON: return "NEON";
+		default: return "Scalar";
+		}
+	}
+
+	/* ---- Which kernel has a path for which level ---- */
+
+	static constexpr uint32_t LevelBit(SimdLevel level) {
+		return 1u << static_cast<uint32_t>(level);
+	}
+
+	static constexpr uint32_t EVERY_LEVEL = LevelBit(SimdLevel::SSE2) | LevelBit(SimdLevel::AVX2) | LevelBit(SimdLevel::NEON);
+
+	/*
+	 * In PixelKernel order. SSE2 has neither a byte shuffle nor a gather, so kernels that are one lookup per channel
+	 * into a 256 entry or larger table keep the table there; AVX2 gathers cost as much as those lookups for the 8 bit
+	 * sRGB curves, NEON does 256 entry byte lookups in registers. Each dispatch below switches on GetKernelSimdLevel,
+	 * a level added here without a case there only runs the scalar code.
+	 */
+	static const uint32_t KERNEL_LEVELS[] = {
+		EVERY_LEVEL,                                           // PremultiplyAlpha
+		EVERY_LEVEL,                                           // SwizzleRGBA8ToBGRA8
+		LevelBit(SimdLevel::NEON),                             // SrgbToLinearRGBA8
+		LevelBit(SimdLevel::NEON),                             // LinearToSrgbRGBA8
+		EVERY_LEVEL,                                           // RGBA8ToRGBA16F
+		LevelBit(SimdLevel::AVX2) | LevelBit(SimdLevel::NEON), // SrgbRGBA8ToRGBA16F
+		EVERY_LEVEL,                                           // RGBA16FToRGBA8
+		LevelBit(SimdLevel::AVX2),                             // RGBA16FToSrgbRGBA8
+		EVERY_LEVEL,                                           // RGBA8ToR11G11B10F
+		LevelBit(SimdLevel::AVX2) | LevelBit(SimdLevel::NEON), // SrgbRGBA8ToR11G11B10F
+		EVERY_LEVEL,                                           // R11G11B10FToRGBA8
+		LevelBit(SimdLevel::AVX2),                             // R11G11B10FToSrgbRGBA8
+	};
+	static_assert(sizeof(KERNEL_LEVELS) / sizeof(KERNEL_LEVELS[0]) == static_cast<size_t>(PixelKernel::Count), "one entry per kernel");
+
+	SimdLevel GetKernelSimdLevel(PixelKernel kernel) {
+		uint32_t levels = KERNEL_LEVELS[static_cast<size_t>(kernel)];
+		SimdLevel level = GetSimdLevel();
+		if (level == SimdLevel::AVX2 && !(levels & LevelBit(level)))
+			level = SimdLevel::SSE2;
+		return (levels & LevelBit(level)) ? level : SimdLevel::Scalar;
+	}
+
+	/* ---- Shared SIMD helpers ---- */
+
+	static const float UNORM8_SCALE = 1.f / 255.f;
+
+	/* The exponent bias of a 5 bit exponent float moved to that of a 32 bit float */
+	static constexpr uint32_t SMALL_FLOAT_REBIAS = static_cast<uint32_t>(127 - 15) << 23;
+
+	/*
+	 * Unorm8 to a 5 bit exponent float with MANTISSA_BITS of mantissa (10 for half, 6 and 5 for R11G11B10). Scaling
+	 * by 2^-112 on top of 1/255 lines the float exponent up with the small one, then the top bits are the result.
+	 * Checked for all 256 inputs against the tables: the reciprocal rounds like dividing by 255 and none of the
+	 * values falls exactly between two small floats, so rounding half up is rounding to nearest even.
+	 */
+	static const float UNORM8_TO_SMALL_FLOAT_SCALE = UNORM8_SCALE / static_cast<float>(1ull << 56) / static_cast<float>(1ull << 56);
+
+#if AWESOME_SIMD_X86
+	template <int MANTISSA_BITS>
+	AWESOME_TARGET_SSE2 static __m128i Unorm8ToSmallFloatSSE2(__m128i v) {
+		const int shift = 23 - MANTISSA_BITS;
+		__m128 f = _mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(UNORM8_TO_SMALL_FLOAT_SCALE));
+		return _mm_srli_epi32(_mm_add_epi32(_mm_castps_si128(f), _mm_set1_epi32(1 << (shift - 1))), shift);
+	}
+
+	template <int MANTISSA_BITS>
+	AWESOME_TARGET_AVX2 static __m256i Unorm8ToSmallFloatAVX2(__m256i v) {
+		const int shift = 23 - MANTISSA_BITS;
+		__m256 f = _mm256_mul_ps(_mm256_cvtepi32_ps(v), _mm256_set1_ps(UNORM8_TO_SMALL_FLOAT_SCALE));
+		return _mm256_srli_epi32(_mm256_add_epi32(_mm256_castps_si256(f), _mm256_set1_epi32(1 << (shift - 1))), shift);
+	}
+
+	/*
+	 * A 5 bit exponent float, zero extended to 32 bits, to unorm8 the way the tables round it: NaN to 0 and anything
+	 * from 1 up to 255. A half's sign bit puts negative values above infinity as well, so they become 0 too.
+	 * Denormals take the normal path, they scale to well below 0.5 either way.
+	 */
+	template <int MANTISSA_BITS>
+	AWESOME_TARGET_SSE2 static __m128i SmallFloatToUnorm8SSE2(__m128i v) {
+		v = _mm_andnot_si128(_mm_cmpgt_epi32(v, _mm_set1_epi32(31 << MANTISSA_BITS)), v);
+		__m128 f = _mm_castsi128_ps(_mm_add_epi32(_mm_slli_epi32(v, 23 - MANTISSA_BITS), _mm_set1_epi32(static_cast<int>(SMALL_FLOAT_REBIAS))));
+		return _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(f, _mm_set1_ps(1.f)), _mm_set1_ps(255.f)));
+	}
+
+	template <int MANTISSA_BITS>
+	AWESOME_TARGET_AVX2 static __m256i SmallFloatToUnorm8AVX2(__m256i v) {
+		v = _mm256_andnot_si256(_mm256_cmpgt_epi32(v, _mm256_set1_epi32(31 << MANTISSA_BITS)), v);
+		__m256 f = _mm256_castsi256_ps(_mm256_add_epi32(_mm256_slli_epi32(v, 23 - MANTISSA_BITS), _mm256_set1_epi32(static_cast<int>(SMALL_FLOAT_REBIAS))));
+		return _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_min_ps(f, _mm256_set1_ps(1.f)), _mm256_set1_ps(255.f)));
+	}
+#endif
+
+#if AWESOME_SIMD_NEON
+	template <int MANTISSA_BITS>
+	static uint32x4_t Unorm8ToSmallFloatNEON(uint32x4_t v) {
+		const int shift = 23 - MANTISSA_BITS;
+		float32x4_t f = vmulq_f32(vcvtq_f32_u32(v), vdupq_n_f32(UNORM8_TO_SMALL_FLOAT_SCALE));
+		return vshrq_n_u32(vaddq_u32(vreinterpretq_u32_f32(f), vdupq_n_u32(1u << (shift - 1))), shift);
+	}
+
+	template <int MANTISSA_BITS>
+	static uint32x4_t SmallFloatToUnorm8NEON(uint32x4_t v) {
+		v = vbicq_u32(v, vcgtq_u32(v, vdupq_n_u32(31u << MANTISSA_BITS)));
+		float32x4_t f = vreinterpretq_f32_u32(vaddq_u32(vshlq_n_u32(v, 23 - MANTISSA_BITS), vdupq_n_u32(SMALL_FLOAT_REBIAS)));
+		return vcvtnq_u32_f32(vmulq_f32(vminq_f32(f, vdupq_n_f32(1.f)), vdupq_n_f32(255.f)));
+	}
+
+	/* Unorm8 to float, four at a time */
+	static float32x4_t Unorm8ToFloatNEON(uint16x4_t v) {
+		return vmulq_f32(vcvtq_f32_u32(vmovl_u16(v)), vdupq_n_f32(UNORM8_SCALE));
+	}
+
+	struct NeonTable256 {
+		uint8x16x4_t quarters[4];
+	};
+
+	static NeonTable256 LoadTable256NEON(const uint8_t* table) {
+		NeonTable256 t;
+		for (int q = 0; q < 4; ++q) {
+			const uint8_t* quarter = table + q * 64;
+			t.quarters[q].val[0] = vld1q_u8(quarter);
+			t.quarters[q].val[1] = vld1q_u8(quarter + 16);
+			t.quarters[q].val[2] = vld1q_u8(quarter + 32);
+			t.quarters[q].val[3] = vld1q_u8(quarter + 48);
+		}
+		return t;
+	}
+
+	/* tbl gives 0 for an index past its 64 bytes and tbx leaves the lane alone, so each quarter only fills its own range */
+	static uint8x16_t Lookup256NEON(const NeonTable256& t, uint8x16_t index) {
+		const uint8x16_t quarter = vdupq_n_u8(64);
+		uint8x16_t r = vqtbl4q_u8(t.quarters[0], index);
+		index = vsubq_u8(index, quarter);
+		r = vqtbx4q_u8(r, t.quarters[1], index);
+		index = vsubq_u8(index, quarter);
+		r = vqtbx4q_u8(r, t.quarters[2], index);
+		index = vsubq_u8(index, quarter);
+		return vqtbx4q_u8(r, t.quarters[3], index);
+	}
+
+	/* A 16 bit value per byte from tables of its low and high bytes, as [first 8, last 8] */
+	static void Lookup256x16NEON(const NeonTable256& low, const NeonTable256& high, uint8x16_t index, uint16x8_t out[2]) {
+		uint8x16_t lo = Lookup256NEON(low, index);
+		uint8x16_t hi = Lookup256NEON(high, index);
+		out[0] = vreinterpretq_u16_u8(vzip1q_u8(lo, hi));
+		out[1] = vreinterpretq_u16_u8(vzip2q_u8(lo, hi));
+	}
+#endif
+
+	/* ---- Premultiplied alpha ---- */
+
+	static void PremultiplyAlphaScalar(uint8_t* p, size_t count) {
+		for (size_t i = 0; i < count; ++i, p += 4) {
+			uint32_t a = p[3];
+			p[0] = MulDiv255(p[0], a);
+			p[1] = MulDiv255(p[1], a);
+			p[2] = MulDiv255(p[2], a);
+		}
+	}
+
+#if AWESOME_SIMD_X86
+	AWESOME_TARGET_SSE2 static __m128i PremultiplyHalfSSE2(__m128i px16) {
+		__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(px16, 0xFF), 0xFF);
+		__m128i t = _mm_add_epi16(_mm_mullo_epi16(px16, alpha), _mm_set1_epi16(128));
+		return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+	}
+
+	AWESOME_TARGET_SSE2 static size_t PremultiplyAlphaSSE2(uint8_t* p, size_t count) {
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			__m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i * 4));
+			__m128i lo = PremultiplyHalfSSE2(_mm_unpacklo_epi8(px, zero));
+			__m128i hi = PremultiplyHalfSSE2(_mm_unpackhi_epi8(px, zero));
+			__m128i result = _mm_packus_epi16(lo, hi);
+			result = _mm_or_si128(_mm_andnot_si128(alphaMask, result), _mm_and_si128(alphaMask, px));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(p + i * 4), result);
+		}
+		return i;
+	}
+
+	AWESOME_TARGET_AVX2 static __m256i PremultiplyHalfAVX2(__m256i px16) {
+		__m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(px16, 0xFF), 0xFF);
+		__m256i t = _mm256_add_epi16(_mm256_mullo_epi16(px16, alpha), _mm256_set1_epi16(128));
+		return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+	}
+
+	AWESOME_TARGET_AVX2 static size_t PremultiplyAlphaAVX2(uint8_t* p, size_t count) {
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8) {
+			__m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i * 4));
+			__m256i lo = PremultiplyHalfAVX2(_mm256_unpacklo_epi8(px, zero));
+			__m256i hi = PremultiplyHalfAVX2(_mm256_unpackhi_epi8(px, zero));
+			__m256i result = _mm256_packus_epi16(lo, hi); // undoes the in-lane unpack
+			result = _mm256_or_si256(_mm256_andnot_si256(alphaMask, result), _mm256_and_si256(alphaMask, px));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(p + i * 4), result);
+		}
+		return i;
+	}
+#endif
+
+#if AWESOME_SIMD_NEON
+	static uint8x8_t MulDiv255NEON(uint8x8_t c, uint8x8_t a) {
+		uint16x8_t t = vmull_u8(c, a);
+		return vraddhn_u16(t, vrshrq_n_u16(t, 8));
+	}
+
+	static size_t PremultiplyAlphaNEON(uint8_t* p, size_t count) {
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16) {
+			uint8x16x4_t px = vld4q_u8(p + i * 4);
+			for (int c = 0; c < 3; ++c) {
+				uint8x8_t lo = MulDiv255NEON(vget_low_u8(px.val[c]), vget_low_u8(px.val[3]));
+				uint8x8_t hi = MulDiv255NEON(vget_high_u8(px.val[c]), vget_high_u8(px.val[3]));
+				px.val[c] = vcombine_u8(lo, hi);
+			}
+			vst4q_u8(p + i * 4, px);
+		}
+		return i;
+	}
+#endif
+
+	void PremultiplyAlphaRGBA8(uint8_t* pixels, size_t pixelCount) {
+		size_t done = 0;
+		switch (GetKernelSimdLevel(PixelKernel::PremultiplyAlpha)) {
+#if AWESOME_SIMD_X86
+		case SimdLevel::AVX2: done = PremultiplyAlphaAVX2(pixels, pixelCount); break;
+		case SimdLevel::SSE2: done = PremultiplyAlphaSSE2(pixels, pixelCount); break;
+#endif
+#if AWESOME_SIMD_NEON
+		case SimdLevel::NEON: done = PremultiplyAlphaNEON(pixels, pixelCount); break;
+#endif
+		default: break;
+		}
+		PremultiplyAlphaScalar(pixels + done * 4, pixelCount - done);
+	}
+
+	/* ---- RGBA <-> BGRA ---- */
+
+	static void SwizzleScalar(const uint8_t* src, uint8_t* dst, size_t count) {
+		for (size_t i = 0; i < count; ++i, src += 4, dst += 4) {
+			uint8_t r = src[0], g = src[1], b = src[2], a = src[3];
+			dst[0] = b;
+			dst[1] = g;
+			dst[2] = r;
+			dst[3] = a;
+		}
+	}
+
+#if AWESOME_SIMD_X86
+	AWESOME_TARGET_SSE2 static size_t SwizzleSSE2(const uint8_t* src, uint8_t* dst, size_t count) {
+		const __m128i keepMask = _mm_set1_epi32(static_cast<int>(0xFF00FF00u));
+		const __m128i lowMask = _mm_set1_epi32(0x000000FF);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			__m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+			__m128i ga = _mm_and_si128(px, keepMask);
+			__m128i r = _mm_slli_epi32(_mm_and_si128(px, lowMask), 16);
+			__m128i b = _mm_and_si128(_mm_srli_epi32(px, 16), lowMask);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_or_si128(ga, _mm_or_si128(r, b)));
+		}
+		return i;
+	}
+
+	AWESOME_TARGET_AVX2 static size_t SwizzleAVX2(const uint8_t* src, uint8_t* dst, size_t count) {
+		const __m256i shuffle = _mm256_setr_epi8(
+			2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+			2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16) {
+			__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+			__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4 + 32));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), _mm256_shuffle_epi8(a, shuffle));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4 + 32), _mm256_shuffle_epi8(b, shuffle));
+		}
+		return i;
+	}
+#endif
+
+#if AWESOME_SIMD_NEON
+	static size_t SwizzleNEON(const uint8_t* src, uint8_t* dst, size_t count) {
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16) {
+			uint8x16x4_t px = vld4q_u8(src + i * 4);
+			uint8x16_t r = px.val[0];
+			px.val[0] = px.val[2];
+			px.val[2] = r;
+			vst4q_u8(dst + i * 4, px);
+		}
+		return i;
+	}
+#endif
+
+	void SwizzleRGBA8ToBGRA8(const uint8_t* src, uint8_t* dst, size_t pixelCount) {
+		size_t done = 0;
+		switch (GetKernelSimdLevel(PixelKernel::SwizzleRGBA8ToBGRA8)) {
+#if AWESOME_SIMD_X86
+		case SimdLevel::AVX2: done = SwizzleAVX2(src, dst, pixelCount); break;
+		case SimdLevel::SSE2: done = SwizzleSSE2(src, dst, pixelCount); break;
+#endif
+#if AWESOME_SIMD_NEON
+		case SimdLevel::NEON: done = SwizzleNEON(src, dst, pixelCount); break;
+#endif
+		default: break;
+		}
+		SwizzleScalar(src + done * 4, dst + done * 4, pixelCount - done);
+	}
+
+	/* ---- sRGB <-> linear, 8 bit ---- */
+
+	static void ApplyColourTable(const uint8_t* table, const uint8_t* src, uint8_t* dst, size_t count) {
+		for (size_t i = 0; i < count; ++i, src += 4, dst += 4) {
+			uint8_t r = table[src[0]], g = table[src[1]], b = table[src[2]];
+			dst[3] = src[3];
+			dst[0] = r;
+			dst[1] = g;
+			dst[2] = b;
+		}
+	}
+
+#if AWESOME_SIMD_NEON
+	static size_t ApplyColourTableNEON(const uint8_t* table, const uint8_t* src, uint8_t* dst, size_t count) {
+		NeonTable256 t = LoadTable256NEON(table);
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16) {
+			uint8x16x4_t px = vld4q_u8(src + i * 4);
+			for (int c = 0; c < 3; ++c)
+				px.val[c] = Lookup256NEON(t, px.val[c]);
+			vst4q_u8(dst + i * 4, px);
+		}
+		return i;
+	}
+#endif
+
+	static void ConvertColours(PixelKernel kernel, const uint8_t* table, const uint8_t* src, uint8_t* dst, size_t pixelCount) {
+		size_t done = 0;
+#if AWESOME_SIMD_NEON
+		if (GetKernelSimdLevel(kernel) == SimdLevel::NEON)
+			done = ApplyColourTableNEON(table, src, dst, pixelCount);
+#else
+		(void)kernel;
+#endif
+		ApplyColourTable(table, src + done * 4, dst + done * 4, pixelCount - done);
+	}
+
+	void SrgbToLinearRGBA8(const uint8_t* src, uint8_t* dst, size_t pixelCount) {
+		ConvertColours(PixelKernel::SrgbToLinearRGBA8, GetTables().srgbToLinear, src, dst, pixelCount);
+	}
+
+	void LinearToSrgbRGBA8(const uint8_t* src, uint8_t* dst, size_t pixelCount) {
+		ConvertColours(PixelKernel::LinearToSrgbRGBA8, GetTables().linearToSrgb, src, dst, pixelCount);
+	}
+
+	/* ---- RGBA8 <-> RGBA16F ---- */
+
+	static void RGBA8ToRGBA16FScalar(const uint8_t* src, uint16_t* dst, size_t count, bool srgbDecode) {
+		const ConversionTables& tables = GetTables();
+		const uint16_t* colour = srgbDecode ? tables.srgbToHalf : tables.unormToHalf;
+		for (size_t i = 0; i < count; ++i, src += 4, dst += 4) {
+			dst[0] = colour[src[0]];
+			dst[1] = colour[src[1]];
+			dst[2] = colour[src[2]];
+			dst[3] = tables.unormToHalf[src[3]];
+		}
+	}
+
+	static void RGBA16FToRGBA8Scalar(const uint16_t* src, uint8_t* dst, size_t count, bool srgbEncode) {
+		const ConversionTables& tables = GetTables();
+		const uint8_t* colour = tables.halfToUnorm[srgbEncode];
+		for (size_t i = 0; i < count; ++i, src += 4, dst += 4) {
+			dst[0] = colour[src[0]];
+			dst[1] = colour[src[1]];
+			dst[2] = colour[src[2]];
+			dst[3] = tables.halfToUnorm[0][src[3]];
+		}
+	}
+
+#if AWESOME_SIMD_X86
+	AWESOME_TARGET_SSE2 static size_t RGBA8ToRGBA16FSSE2(const uint8_t* src, uint16_t* dst, size_t count) {
+		const __m128i zero = _mm_setzero_si128();
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			__m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+			__m128i words[2] = { _mm_unpacklo_epi8(px, zero), _mm_unpackhi_epi8(px, zero) };
+			for (int w = 0; w < 2; ++w) {
+				__m128i lo = Unorm8ToSmallFloatSSE2<10>(_mm_unpacklo_epi16(words[w], zero));
+				__m128i hi = Unorm8ToSmallFloatSSE2<10>(_mm_unpackhi_epi16(words[w], zero));
+				/* 1.0 is 0x3C00, nothing saturates */
+				__m128i halves = _mm_packs_epi32(lo, hi);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4 + w * 8), halves);
+			}
+		}
+		return i;
+	}
+
+	AWESOME_TARGET_SSE2 static size_t RGBA16FToRGBA8SSE2(const uint16_t* src, uint8_t* dst, size_t count) {
+		const __m128i zero = _mm_setzero_si128();
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			__m128i words[2];
+			for (int w = 0; w < 2; ++w) {
+				__m128i halves = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4 + w * 8));
+				__m128i lo = SmallFloatToUnorm8SSE2<10>(_mm_unpacklo_epi16(halves, zero));
+				__m128i hi = SmallFloatToUnorm8SSE2<10>(_mm_unpackhi_epi16(halves, zero));
+				words[w] = _mm_packs_epi32(lo, hi);
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_packus_epi16(words[0], words[1]));
+		}
+		return i;
+	}
+
+	AWESOME_TARGET_AVX2 static size_t RGBA8ToRGBA16FAVX2(const uint8_t* src, uint16_t* dst, size_t count) {
+		const __m256 scale = _mm256_set1_ps(UNORM8_SCALE);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8) {
+			for (int q = 0; q < 4; ++q) {
+				__m256i bytes = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i * 4 + q * 8)));
+				__m256 unorm = _mm256_mul_ps(_mm256_cvtepi32_ps(bytes), scale);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4 + q * 8), _mm256_cvtps_ph(unorm, _MM_FROUND_TO_NEAREST_INT));
+			}
+		}
+		return i;
+	}
+
+	AWESOME_TARGET_AVX2 static size_t SrgbRGBA8ToRGBA16FAVX2(const uint8_t* src, uint16_t* dst, size_t count) {
+		const int* srgbToHalf = reinterpret_cast<const int*>(GetTables().srgbToHalf);
+		const __m256i byteMask = _mm256_set1_epi32(0xFF);
+		const __m256i halfMask = _mm256_set1_epi32(0xFFFF);
+		const __m256 scale = _mm256_set1_ps(UNORM8_SCALE);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8) {
+			__m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+			__m256i r = _mm256_i32gather_epi32(srgbToHalf, _mm256_and_si256(px, byteMask), 2);
+			__m256i g = _mm256_i32gather_epi32(srgbToHalf, _mm256_and_si256(_mm256_srli_epi32(px, 8), byteMask), 2);
+			__m256i b = _mm256_i32gather_epi32(srgbToHalf, _mm256_and_si256(_mm256_srli_epi32(px, 16), byteMask), 2);
+			__m256 alpha = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(px, 24)), scale);
+			__m256i a = _mm256_cvtepu16_epi32(_mm256_cvtps_ph(alpha, _MM_FROUND_TO_NEAREST_INT));
+			__m256i rg = _mm256_or_si256(_mm256_and_si256(r, halfMask), _mm256_slli_epi32(g, 16));
+			__m256i ba = _mm256_or_si256(_mm256_and_si256(b, halfMask), _mm256_slli_epi32(a, 16));
+			/* In each 128 bit lane, pixels 0 and 1 then 2 and 3 */
+			__m256i lo = _mm256_unpacklo_epi32(rg, ba);
+			__m256i hi = _mm256_unpackhi_epi32(rg, ba);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), _mm256_permute2x128_si256(lo, hi, 0x20));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4 + 16), _mm256_permute2x128_si256(lo, hi, 0x31));
+		}
+		return i;
+	}
+
+	AWESOME_TARGET_AVX2 static void StoreUnorm8x8(uint8_t* dst, __m256i v) {
+		__m128i words = _mm_packs_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(words, words));
+	}
+
+	AWESOME_TARGET_AVX2 static size_t RGBA16FToRGBA8AVX2(const uint16_t* src, uint8_t* dst, size_t count, bool srgbEncode) {
+		const ConversionTables& tables = GetTables();
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.f);
+		const __m256 scale255 = _mm256_set1_ps(255.f);
+		const __m256 scaleSrgb = _mm256_set1_ps(static_cast<float>(LINEAR_TO_SRGB_STEPS - 1));
+		const __m256i alphaLanes = _mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1);
+		size_t i = 0;
+		for (; i + 2 <= count; i += 2) {
+			__m256 f = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4)));
+			f = _mm256_min_ps(_mm256_max_ps(f, zero), one); // max first so NaN becomes 0
+			__m256i unorm = _mm256_cvtps_epi32(_mm256_mul_ps(f, scale255));
+			if (srgbEncode) {
+				__m256i index = _mm256_cvtps_epi32(_mm256_mul_ps(f, scaleSrgb));
+				__m256i srgb = _mm256_i32gather_epi32(tables.linear12ToSrgb, index, 4);
+				unorm = _mm256_blendv_epi8(srgb, unorm, alphaLanes);
+			}
+			StoreUnorm8x8(dst + i * 4, unorm);
+		}
+		return i;
+	}
+#endif
+
+#if AWESOME_SIMD_NEON
+	static size_t RGBA8ToRGBA16FNEON(const uint8_t* src, uint16_t* dst, size_t count) {
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			uint8x16_t px = vld1q_u8(src + i * 4);
+			uint16x8_t words[2] = { vmovl_u8(vget_low_u8(px)), vmovl_u8(vget_high_u8(px)) };
+			for (int w = 0; w < 2; ++w) {
+				float16x4_t lo = vcvt_f16_f32(Unorm8ToFloatNEON(vget_low_u16(words[w])));
+				float16x4_t hi = vcvt_f16_f32(Unorm8ToFloatNEON(vget_high_u16(words[w])));
+				vst1q_u16(dst + i * 4 + w * 8, vreinterpretq_u16_f16(vcombine_f16(lo, hi)));
+			}
+		}
+		return i;
+	}
+
+	static size_t SrgbRGBA8ToRGBA16FNEON(const uint8_t* src, uint16_t* dst, size_t count) {
+		const ConversionTables& tables = GetTables();
+		NeonTable256 low = LoadTable256NEON(tables.srgbToHalfBytes[0]);
+		NeonTable256 high = LoadTable256NEON(tables.srgbToHalfBytes[1]);
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16) {
+			uint8x16x4_t px = vld4q_u8(src + i * 4);
+			uint16x8x4_t out[2];
+			for (int c = 0; c < 3; ++c) {
+				uint16x8_t halves[2];
+				Lookup256x16NEON(low, high, px.val[c], halves);
+				out[0].val[c] = halves[0];
+				out[1].val[c] = halves[1];
+			}
+			uint16x8_t alpha[2] = { vmovl_u8(vget_low_u8(px.val[3])), vmovl_u8(vget_high_u8(px.val[3])) };
+			for (int h = 0; h < 2; ++h) {
+				float16x4_t lo = vcvt_f16_f32(Unorm8ToFloatNEON(vget_low_u16(alpha[h])));
+				float16x4_t hi = vcvt_f16_f32(Unorm8ToFloatNEON(vget_high_u16(alpha[h])));
+				out[h].val[3] = vreinterpretq_u16_f16(vcombine_f16(lo, hi));
+				vst4q_u16(dst + i * 4 + h * 32, out[h]);
+			}
+		}
+		return i;
+	}
+
+	static size_t RGBA16FToRGBA8NEON(const uint16_t* src, uint8_t* dst, size_t count) {
+		const float32x4_t zero = vdupq_n_f32(0.f);
+		const float32x4_t one = vdupq_n_f32(1.f);
+		const float32x4_t scale = vdupq_n_f32(255.f);
+		size_t i = 0;
+		for (; i + 2 <= count; i += 2) {
+			float16x8_t h = vreinterpretq_f16_u16(vld1q_u16(src + i * 4));
+			float32x4_t lo = vcvt_f32_f16(vget_low_f16(h));
+			float32x4_t hi = vcvt_high_f32_f16(h);
+			lo = vminq_f32(vmaxnmq_f32(lo, zero), one);
+			hi = vminq_f32(vmaxnmq_f32(hi, zero), one);
+			uint32x4_t loI = vcvtnq_u32_f32(vmulq_f32(lo, scale));
+			uint32x4_t hiI = vcvtnq_u32_f32(vmulq_f32(hi, scale));
+			uint16x8_t words = vcombine_u16(vmovn_u32(loI), vmovn_u32(hiI));
+			vst1_u8(dst + i * 4, vmovn_u16(words));
+		}
+		return i;
+	}
+#endif
+
+	void ConvertRGBA8ToRGBA16F(const uint8_t* src, uint16_t* dst, size_t pixelCount, bool srgbDecode) {
+		size_t done = 0;
+		if (srgbDecode) {
+			switch (GetKernelSimdLevel(PixelKernel::SrgbRGBA8ToRGBA16F)) {
+#if AWESOME_SIMD_X86
+			case SimdLevel::AVX2: done = SrgbRGBA8ToRGBA16FAVX2(src, dst, pixelCount); break;
+#endif
+#if AWESOME_SIMD_NEON
+			case SimdLevel::NEON: done = SrgbRGBA8ToRGBA16FNEON(src, dst, pixelCount); break;
+#endif
+			default: break;
+			}
+		}
+		else {
+			switch (GetKernelSimdLevel(PixelKernel::RGBA8ToRGBA16F)) {
+#if AWESOME_SIMD_X86
+			case SimdLevel::AVX2: done = RGBA8ToRGBA16FAVX2(src, dst, pixelCount); break;
+			case SimdLevel::SSE2: done = RGBA8ToRGBA16FSSE2(src, dst, pixelCount); break;
+#endif
+#if AWESOME_SIMD_NEON
+			case SimdLevel::NEON: done = RGBA8ToRGBA16FNEON(src, dst, pixelCount); break;
+#endif
+			default: break;
+			}
+		}
+		RGBA8ToRGBA16FScalar(src + done * 4, dst + done * 4, pixelCount - done, srgbDecode);
+	}
+
+	void ConvertRGBA16FToRGBA8(const uint16_t* src, uint8_t* dst, size_t pixelCount, bool srgbEncode) {
+		size_t done = 0;
+		switch (GetKernelSimdLevel(srgbEncode ? PixelKernel::RGBA16FToSrgbRGBA8 : PixelKernel::RGBA16FToRGBA8)) {
+#if AWESOME_SIMD_X86
+		case SimdLevel::AVX2: done = RGBA16FToRGBA8AVX2(src, dst, pixelCount, srgbEncode); break;
+		case SimdLevel::SSE2: done = RGBA16FToRGBA8SSE2(src, dst, pixelCount); break;
+#endif
+#if AWESOME_SIMD_NEON
+		case SimdLevel::NEON: done = RGBA16FToRGBA8NEON(src, dst, pixelCount); break;
+#endif
+		default: break;
+		}
+		RGBA16FToRGBA8Scalar(src + done * 4, dst + done * 4, pixelCount - done, srgbEncode);
+	}
+
+	/* ---- RGBA8 <-> R11G11B10F ---- */
+
+	static void RGBA8ToR11G11B10FScalar(const uint8_t* src, uint32_t* dst, size_t count, bool srgbDecode) {
+		const ConversionTables& tables = GetTables();
+		const uint32_t* r = tables.packR11[srgbDecode];
+		const uint32_t* g = tables.packG11[srgbDecode];
+		const uint32_t* b = tables.packB10[srgbDecode];
+		for (size_t i = 0; i < count; ++i, src += 4)
+			dst[i] = r[src[0]] | g[src[1]] | b[src[2]];
+	}
+
+	static void R11G11B10FToRGBA8Scalar(const uint32_t* src, uint8_t* dst, size_t count, bool srgbEncode) {
+		const ConversionTables& tables = GetTables();
+		const uint8_t* c11 = tables.unpack11[srgbEncode];
+		const uint8_t* c10 = tables.unpack10[srgbEncode];
+		for (size_t i = 0; i < count; ++i, dst += 4) {
+			uint32_t v = src[i];
+			dst[0] = c11[v & 0x7FFu];
+			dst[1] = c11[(v >> 11) & 0x7FFu];
+			dst[2] = c10[v >> 22];
+			dst[3] = 255;
+		}
+	}
+
+#if AWESOME_SIMD_X86
+	AWESOME_TARGET_SSE2 static size_t RGBA8ToR11G11B10FSSE2(const uint8_t* src, uint32_t* dst, size_t count) {
+		const __m128i byteMask = _mm_set1_epi32(0xFF);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			__m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+			__m128i r = Unorm8ToSmallFloatSSE2<6>(_mm_and_si128(px, byteMask));
+			__m128i g = Unorm8ToSmallFloatSSE2<6>(_mm_and_si128(_mm_srli_epi32(px, 8), byteMask));
+			__m128i b = Unorm8ToSmallFloatSSE2<5>(_mm_and_si128(_mm_srli_epi32(px, 16), byteMask));
+			__m128i rg = _mm_or_si128(r, _mm_slli_epi32(g, 11));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_or_si128(rg, _mm_slli_epi32(b, 22)));
+		}
+		return i;
+	}
+
+	AWESOME_TARGET_SSE2 static size_t R11G11B10FToRGBA8SSE2(const uint32_t* src, uint8_t* dst, size_t count) {
+		const __m128i mask11 = _mm_set1_epi32(0x7FF);
+		const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			__m128i r = SmallFloatToUnorm8SSE2<6>(_mm_and_si128(v, mask11));
+			__m128i g = SmallFloatToUnorm8SSE2<6>(_mm_and_si128(_mm_srli_epi32(v, 11), mask11));
+			__m128i b = SmallFloatToUnorm8SSE2<5>(_mm_srli_epi32(v, 22));
+			__m128i rgba = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)), _mm_or_si128(_mm_slli_epi32(b, 16), alpha));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), rgba);
+		}
+		return i;
+	}
+
+	AWESOME_TARGET_AVX2 static size_t RGBA8ToR11G11B10FAVX2(const uint8_t* src, uint32_t* dst, size_t count) {
+		const __m256i byteMask = _mm256_set1_epi32(0xFF);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8) {
+			__m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+			__m256i r = Unorm8ToSmallFloatAVX2<6>(_mm256_and_si256(px, byteMask));
+			__m256i g = Unorm8ToSmallFloatAVX2<6>(_mm256_and_si256(_mm256_srli_epi32(px, 8), byteMask));
+			__m256i b = Unorm8ToSmallFloatAVX2<5>(_mm256_and_si256(_mm256_srli_epi32(px, 16), byteMask));
+			__m256i rg = _mm256_or_si256(r, _mm256_slli_epi32(g, 11));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_or_si256(rg, _mm256_slli_epi32(b, 22)));
+		}
+		return i;
+	}
+
+	AWESOME_TARGET_AVX2 static size_t SrgbRGBA8ToR11G11B10FAVX2(const uint8_t* src, uint32_t* dst, size_t count) {
+		const ConversionTables& tables = GetTables();
+		const int* r = reinterpret_cast<const int*>(tables.packR11[1]);
+		const int* g = reinterpret_cast<const int*>(tables.packG11[1]);
+		const int* b = reinterpret_cast<const int*>(tables.packB10[1]);
+		const __m256i byteMask = _mm256_set1_epi32(0xFF);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8) {
+			__m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+			__m256i rr = _mm256_i32gather_epi32(r, _mm256_and_si256(px, byteMask), 4);
+			__m256i gg = _mm256_i32gather_epi32(g, _mm256_and_si256(_mm256_srli_epi32(px, 8), byteMask), 4);
+			__m256i bb = _mm256_i32gather_epi32(b, _mm256_and_si256(_mm256_srli_epi32(px, 16), byteMask), 4);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_or_si256(rr, _mm256_or_si256(gg, bb)));
+		}
+		return i;
+	}
+
+	AWESOME_TARGET_AVX2 static size_t R11G11B10FToRGBA8AVX2(const uint32_t* src, uint8_t* dst, size_t count) {
+		const __m256i mask11 = _mm256_set1_epi32(0x7FF);
+		const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+			__m256i r = SmallFloatToUnorm8AVX2<6>(_mm256_and_si256(v, mask11));
+			__m256i g = SmallFloatToUnorm8AVX2<6>(_mm256_and_si256(_mm256_srli_epi32(v, 11), mask11));
+			__m256i b = SmallFloatToUnorm8AVX2<5>(_mm256_srli_epi32(v, 22));
+			__m256i rgba = _mm256_or_si256(_mm256_or_si256(r, _mm256_slli_epi32(g, 8)), _mm256_or_si256(_mm256_slli_epi32(b, 16), alpha));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), rgba);
+		}
+		return i;
+	}
+
+	AWESOME_TARGET_AVX2 static size_t R11G11B10FToSrgbRGBA8AVX2(const uint32_t* src, uint8_t* dst, size_t count) {
+		const ConversionTables& tables = GetTables();
+		const int* c11 = reinterpret_cast<const int*>(tables.unpack11[1]);
+		const int* c10 = reinterpret_cast<const int*>(tables.unpack10[1]);
+		const __m256i mask11 = _mm256_set1_epi32(0x7FF);
+		const __m256i byteMask = _mm256_set1_epi32(0xFF);
+		const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+			__m256i r = _mm256_and_si256(_mm256_i32gather_epi32(c11, _mm256_and_si256(v, mask11), 1), byteMask);
+			__m256i g = _mm256_and_si256(_mm256_i32gather_epi32(c11, _mm256_and_si256(_mm256_srli_epi32(v, 11), mask11), 1), byteMask);
+			__m256i b = _mm256_and_si256(_mm256_i32gather_epi32(c10, _mm256_srli_epi32(v, 22), 1), byteMask);
+			__m256i rgba = _mm256_or_si256(_mm256_or_si256(r, _mm256_slli_epi32(g, 8)), _mm256_or_si256(_mm256_slli_epi32(b, 16), alpha));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), rgba);
+		}
+		return i;
+	}
+#endif
+
+#if AWESOME_SIMD_NEON
+	static size_t RGBA8ToR11G11B10FNEON(const uint8_t* src, uint32_t* dst, size_t count) {
+		const uint32x4_t byteMask = vdupq_n_u32(0xFF);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			uint32x4_t px = vreinterpretq_u32_u8(vld1q_u8(src + i * 4));
+			uint32x4_t r = Unorm8ToSmallFloatNEON<6>(vandq_u32(px, byteMask));
+			uint32x4_t g = Unorm8ToSmallFloatNEON<6>(vandq_u32(vshrq_n_u32(px, 8), byteMask));
+			uint32x4_t b = Unorm8ToSmallFloatNEON<5>(vandq_u32(vshrq_n_u32(px, 16), byteMask));
+			uint32x4_t rg = vorrq_u32(r, vshlq_n_u32(g, 11));
+			vst1q_u32(dst + i, vorrq_u32(rg, vshlq_n_u32(b, 22)));
+		}
+		return i;
+	}
+
+	static size_t SrgbRGBA8ToR11G11B10FNEON(const uint8_t* src, uint32_t* dst, size_t count) {
+		const ConversionTables& tables = GetTables();
+		NeonTable256 low11 = LoadTable256NEON(tables.srgbToR11Bytes[0]);
+		NeonTable256 high11 = LoadTable256NEON(tables.srgbToR11Bytes[1]);
+		NeonTable256 low10 = LoadTable256NEON(tables.srgbToB10Bytes[0]);
+		NeonTable256 high10 = LoadTable256NEON(tables.srgbToB10Bytes[1]);
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16) {
+			uint8x16x4_t px = vld4q_u8(src + i * 4);
+			uint16x8_t r[2], g[2], b[2];
+			Lookup256x16NEON(low11, high11, px.val[0], r);
+			Lookup256x16NEON(low11, high11, px.val[1], g);
+			Lookup256x16NEON(low10, high10, px.val[2], b);
+			for (int q = 0; q < 4; ++q) {
+				uint16x4_t rq = (q & 1) ? vget_high_u16(r[q >> 1]) : vget_low_u16(r[q >> 1]);
+				uint16x4_t gq = (q & 1) ? vget_high_u16(g[q >> 1]) : vget_low_u16(g[q >> 1]);
+				uint16x4_t bq = (q & 1) ? vget_high_u16(b[q >> 1]) : vget_low_u16(b[q >> 1]);
+				uint32x4_t rg = vorrq_u32(vmovl_u16(rq), vshlq_n_u32(vmovl_u16(gq), 11));
+				vst1q_u32(dst + i + q * 4, vorrq_u32(rg, vshlq_n_u32(vmovl_u16(bq), 22)));
+			}
+		}
+		return i;
+	}
+
+	static size_t R11G11B10FToRGBA8NEON(const uint32_t* src, uint8_t* dst, size_t count) {
+		const uint32x4_t mask11 = vdupq_n_u32(0x7FF);
+		const uint32x4_t alpha = vdupq_n_u32(0xFF000000u);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			uint32x4_t v = vld1q_u32(src + i);
+			uint32x4_t r = SmallFloatToUnorm8NEON<6>(vandq_u32(v, mask11));
+			uint32x4_t g = SmallFloatToUnorm8NEON<6>(vandq_u32(vshrq_n_u32(v, 11), mask11));
+			uint32x4_t b = SmallFloatToUnorm8NEON<5>(vshrq_n_u32(v, 22));
+			uint32x4_t rgba = vorrq_u32(vorrq_u32(r, vshlq_n_u32(g, 8)), vorrq_u32(vshlq_n_u32(b, 16), alpha));
+			vst1q_u8(dst + i * 4, vreinterpretq_u8_u32(rgba));
+		}
+		return i;
+	}
+#endif
+
+	void ConvertRGBA8ToR11G11B10F(const uint8_t* src, uint32_t* dst, size_t pixelCount, bool srgbDecode) {
+		size_t done = 0;
+		if (srgbDecode) {
+			switch (GetKernelSimdLevel(PixelKernel::SrgbRGBA8ToR11G11B10F)) {
+#if AWESOME_SIMD_X86
+			case SimdLevel::AVX2: done = SrgbRGBA8ToR11G11B10FAVX2(src, dst, pixelCount); break;
+#endif
+#if AWESOME_SIMD_NEON
+			case SimdLevel::NEON: done = SrgbRGBA8ToR11G11B10FNEON(src, dst, pixelCount); break;
+#endif
+			default: break;
+			}
+		}
+		else {
+			switch (GetKernelSimdLevel(PixelKernel::RGBA8ToR11G11B10F)) {
+#if AWESOME_SIMD_X86
+			case SimdLevel::AVX2: done = RGBA8ToR11G11B10FAVX2(src, dst, pixelCount); break;
+			case SimdLevel::SSE2: done = RGBA8ToR11G11B10FSSE2(src, dst, pixelCount); break;
+#endif
+#if AWESOME_SIMD_NEON
+			case SimdLevel::NEON: done = RGBA8ToR11G11B10FNEON(src, dst, pixelCount); break;
+#endif
+			default: break;
+			}
+		}
+		RGBA8ToR11G11B10FScalar(src + done * 4, dst + done, pixelCount - done, srgbDecode);
+	}
+
+	void ConvertR11G11B10FToRGBA8(const uint32_t* src, uint8_t* dst, size_t pixelCount, bool srgbEncode) {
+		size_t done = 0;
+		if (srgbEncode) {
+#if AWESOME_SIMD_X86
+			if (GetKernelSimdLevel(PixelKernel::R11G11B10FToSrgbRGBA8) == SimdLevel::AVX2)
+				done = R11G11B10FToSrgbRGBA8AVX2(src, dst, pixelCount);
+#endif
+		}
+		else {
+			switch (GetKernelSimdLevel(PixelKernel::R11G11B10FToRGBA8)) {
+#if AWESOME_SIMD_X86
+			case SimdLevel::AVX2: done = R11G11B10FToRGBA8AVX2(src, dst, pixelCount); break;
+			case SimdLevel::SSE2: done = R11G11B10FToRGBA8SSE2(src, dst, pixelCount); break;
+#endif
+#if AWESOME_SIMD_NEON
+			case SimdLevel::NEON: done = R11G11B10FToRGBA8NEON(src, dst, pixelCount); break;
+#endif
+			default: break;
+			}
+		}
+		R11G11B10FToRGBA8Scalar(src + done, dst + done * 4, pixelCount - done, srgbEncode);
+	}
+
+} // namespace awesome
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace awesome {
+
+	/*
+	 * Pixel format conversions for texture import, run on the decoded stb_image output.
+	 * Every kernel runs the widest path it has for what the CPU supports and plain C++
+	 * otherwise; not every kernel has a path for every level, GetKernelSimdLevel says which
+	 * one runs. All paths produce identical results.
+	 * Alpha is always linear and never touched by the sRGB conversions.
+	 */
+	enum class SimdLevel {
+		Scalar,
+		SSE2,
+		AVX2, // also requires F16C
+		NEON,
+	};
+
+	SimdLevel GetSimdLevel();
+	/* Restricts the kernels to a lower level than detected, used to compare paths; returns the level in effect */
+	SimdLevel ForceSimdLevel(SimdLevel level);
+	const char* GetSimdLevelName(SimdLevel level);
+
+	/* One per conversion below, the srgb flag variants count as kernels of their own */
+	enum class PixelKernel {
+		PremultiplyAlpha,
+		SwizzleRGBA8ToBGRA8,
+		SrgbToLinearRGBA8,
+		LinearToSrgbRGBA8,
+		RGBA8ToRGBA16F,
+		SrgbRGBA8ToRGBA16F,
+		RGBA16FToRGBA8,
+		RGBA16FToSrgbRGBA8,
+		RGBA8ToR11G11B10F,
+		SrgbRGBA8ToR11G11B10F,
+		R11G11B10FToRGBA8,
+		R11G11B10FToSrgbRGBA8,
+		Count
+	};
+
+	/* The path the kernel takes at the current level, Scalar when it has none for it */
+	SimdLevel GetKernelSimdLevel(PixelKernel kernel);
+
+	void PremultiplyAlphaRGBA8(uint8_t* pixels, size_t pixelCount);
+	/* The same swap turns BGRA back into RGBA, src and dst may be the same buffer */
+	void SwizzleRGBA8ToBGRA8(const uint8_t* src, uint8_t* dst, size_t pixelCount);
+	void SrgbToLinearRGBA8(const uint8_t* src, uint8_t* dst, size_t pixelCount);
+	void LinearToSrgbRGBA8(const uint8_t* src, uint8_t* dst, size_t pixelCount);
+
+	void ConvertRGBA8ToRGBA16F(const uint8_t* src, uint16_t* dst, size_t pixelCount, bool srgbDecode);
+	void ConvertRGBA16FToRGBA8(const uint16_t* src, uint8_t* dst, size_t pixelCount, bool srgbEncode);
+	/* R11G11B10 has no alpha: it is dropped on the way in and set to 255 on the way out */
+	void ConvertRGBA8ToR11G11B10F(const uint8_t* src, uint32_t* dst, size_t pixelCount, bool srgbDecode);
+	void ConvertR11G11B10FToRGBA8(const uint32_t* src, uint8_t* dst, size_t pixelCount, bool srgbEncode);
+
+	uint16_t FloatToHalf(float f);
+	float HalfToFloat(uint16_t h);
+
+} // namespace awesome
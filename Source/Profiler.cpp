@@ -0,0 +1,223 @@
+#include "Profiler.h"
+#include "Clock.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace awesome {
+
+	namespace {
+		/* Single producer (the owning thread), single consumer (EndFrame) */
+		struct ThreadBuffer {
+			explicit ThreadBuffer(uint32_t index) : index(index), events(Profiler::EVENTS_PER_THREAD) {}
+
+			uint32_t index;
+			uint32_t depth{ 0 };
+			std::vector<ProfileEvent> events;
+			alignas(64) std::atomic<size_t> writePos{ 0 };
+			alignas(64) std::atomic<size_t> readPos{ 0 };
+			std::atomic<unsigned long long> dropped{ 0 };
+		};
+
+		struct ProfilerState {
+			std::mutex mutex; // registration and the captured frames, never taken by a scope
+			std::vector<std::unique_ptr<ThreadBuffer>> threads;
+			std::deque<ProfileFrame> frames;
+			unsigned long long frameStartTicks{ ProfileClock::QueryTicks() };
+			unsigned long long ticksPerSec{ ProfileClock::QueryTicksPerSec() };
+		};
+
+		ProfilerState& GetState() {
+			static ProfilerState state;
+			return state;
+		}
+
+		thread_local ThreadBuffer* threadBuffer = nullptr;
+
+		ThreadBuffer& GetThreadBuffer() {
+			if (!threadBuffer) {
+				ProfilerState& state = GetState();
+				std::lock_guard<std::mutex> lock(state.mutex);
+				state.threads.push_back(std::make_unique<ThreadBuffer>(static_cast<uint32_t>(state.threads.size())));
+				threadBuffer = state.threads.back().get();
+			}
+			return *threadBuffer;
+		}
+
+		void WriteJsonString(FILE* file, const char* s) {
+			fputc('"', file);
+			for (; *s; ++s) {
+				if (*s == '"' || *s == '\\')
+					fputc('\\', file);
+				if (static_cast<unsigned char>(*s) >= 0x20)
+					fputc(*s, file);
+			}
+			fputc('"', file);
+		}
+	}
+
+	ProfileScope::ProfileScope(const char* name) : name(name) {
+		Profiler::BeginScope();
+		startTicks = ProfileClock::QueryTicks();
+	}
+
+	ProfileScope::~ProfileScope() {
+		Profiler::EndScope(name, startTicks);
+	}
+
+	void Profiler::BeginScope() {
+		++GetThreadBuffer().depth;
+	}
+
+	void Profiler::EndScope(const char* name, unsigned long long startTicks) {
+		unsigned long long endTicks = ProfileClock::QueryTicks();
+		ThreadBuffer& buffer = GetThreadBuffer();
+		uint32_t depth = --buffer.depth;
+
+		size_t write = buffer.writePos.load(std::memory_order_relaxed);
+		if (write - buffer.readPos.load(std::memory_order_acquire) >= EVENTS_PER_THREAD) {
+			buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		buffer.events[write & (EVENTS_PER_THREAD - 1)] = { name, startTicks, endTicks, depth, buffer.index };
+		buffer.writePos.store(write + 1, std::memory_order_release);
+	}
+
+	void Profiler::EndFrame() {
+		ProfilerState& state = GetState();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		ProfileFrame frame;
+		frame.startTicks = state.frameStartTicks;
+		frame.endTicks = ProfileClock::QueryTicks();
+		state.frameStartTicks = frame.endTicks;
+
+		/* Scopes still open on other threads land in whichever frame they close in */
+		for (const std::unique_ptr<ThreadBuffer>& buffer : state.threads) {
+			size_t read = buffer->readPos.load(std::memory_order_relaxed);
+			size_t write = buffer->writePos.load(std::memory_order_acquire);
+			for (; read != write; ++read)
+				frame.events.push_back(buffer->events[read & (EVENTS_PER_THREAD - 1)]);
+			buffer->readPos.store(read, std::memory_order_release);
+		}
+
+		state.frames.push_back(std::move(frame));
+		if (state.frames.size() > MAX_CAPTURED_FRAMES)
+			state.frames.pop_front();
+	}
+
+	std::vector<ProfileNode> Profiler::GetFrameHierarchy(uint32_t threadIndex) {
+		std::vector<ProfileEvent> events;
+		{
+			ProfilerState& state = GetState();
+			std::lock_guard<std::mutex> lock(state.mutex);
+			if (state.frames.empty())
+				return {};
+			for (const ProfileEvent& event : state.frames.back().events)
+				if (event.threadIndex == threadIndex)
+					events.push_back(event);
+		}
+
+		/* Events arrive in closing order; sorted by start (outer first on ties) a stack rebuilds the tree */
+		std::sort(events.begin(), events.end(), [](const ProfileEvent& a, const ProfileEvent& b) {
+			return a.startTicks != b.startTicks ? a.startTicks < b.startTicks : a.depth < b.depth;
+		});
+		std::vector<ProfileNode> nodes;
+		std::vector<std::pair<int32_t, unsigned long long>> open; // node, end ticks
+		for (const ProfileEvent& event : events) {
+			while (!open.empty() && (event.startTicks >= open.back().second || event.depth <= nodes[open.back().first].depth))
+				open.pop_back();
+			int32_t parent = open.empty() ? -1 : open.back().first;
+			int32_t node = -1;
+			for (size_t i = 0; i < nodes.size(); ++i) {
+				if (nodes[i].parent == parent && nodes[i].name == event.name) {
+					node = static_cast<int32_t>(i);
+					break;
+				}
+			}
+			if (node < 0) {
+				node = static_cast<int32_t>(nodes.size());
+				nodes.push_back({ event.name, parent, event.depth, 0, 0 });
+			}
+			++nodes[node].calls;
+			nodes[node].totalTicks += event.endTicks - event.startTicks;
+			open.push_back({ node, event.endTicks });
+		}
+		return nodes;
+	}
+
+	void Profiler::FormatFrameHierarchy(char* buffer, size_t bufferSize, uint32_t threadIndex) {
+		if (bufferSize == 0)
+			return;
+		buffer[0] = '\0';
+		std::vector<ProfileNode> nodes = GetFrameHierarchy(threadIndex);
+		double msPerTick = 1000.0 / static_cast<double>(GetState().ticksPerSec);
+
+		/* Depth first, children in the order they first ran */
+		std::vector<int32_t> stack;
+		for (int32_t i = static_cast<int32_t>(nodes.size()) - 1; i >= 0; --i)
+			if (nodes[i].parent < 0)
+				stack.push_back(i);
+		size_t used = 0;
+		while (!stack.empty() && used < bufferSize) {
+			const ProfileNode& node = nodes[stack.back()];
+			int32_t index = stack.back();
+			stack.pop_back();
+			int written = snprintf(buffer + used, bufferSize - used, "%*s%s %.3f ms (%u)\n",
+				static_cast<int>(node.depth * 2), "", node.name, node.totalTicks * msPerTick, node.calls);
+			if (written < 0)
+				break;
+			used += static_cast<size_t>(written);
+			for (int32_t i = static_cast<int32_t>(nodes.size()) - 1; i > index; --i)
+				if (nodes[i].parent == index)
+					stack.push_back(i);
+		}
+	}
+
+	bool Profiler::WriteChromeTrace(const std::string& path) {
+		FILE* file = fopen(path.c_str(), "w");
+		if (!file)
+			return false;
+
+		ProfilerState& state = GetState();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		unsigned long long origin = state.frames.empty() ? 0 : state.frames.front().startTicks;
+		double usPerTick = 1000000.0 / static_cast<double>(state.ticksPerSec);
+		auto toUs = [&](unsigned long long ticks) { return (ticks >= origin ? ticks - origin : 0) * usPerTick; };
+
+		fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+		bool first = true;
+		for (const std::unique_ptr<ThreadBuffer>& buffer : state.threads) {
+			fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}",
+				first ? "" : ",\n", buffer->index, buffer->index == 0 ? "Main" : "Thread", buffer->index);
+			first = false;
+		}
+		uint64_t frameNumber = 0;
+		for (const ProfileFrame& frame : state.frames) {
+			/* Frames as their own track, so they line up above every thread */
+			fprintf(file, "%s{\"name\":\"Frame %llu\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f}",
+				first ? "" : ",\n", static_cast<unsigned long long>(frameNumber++), toUs(frame.startTicks), (frame.endTicks - frame.startTicks) * usPerTick);
+			first = false;
+			for (const ProfileEvent& event : frame.events) {
+				fprintf(file, ",\n{\"name\":");
+				WriteJsonString(file, event.name);
+				fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+					event.threadIndex, toUs(event.startTicks), (event.endTicks - event.startTicks) * usPerTick);
+			}
+		}
+		fprintf(file, "\n]}\n");
+		return fclose(file) == 0;
+	}
+
+	unsigned long long Profiler::GetDroppedEvents() {
+		ProfilerState& state = GetState();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		unsigned long long dropped = 0;
+		for (const std::unique_ptr<ThreadBuffer>& buffer : state.threads)
+			dropped += buffer->dropped.load(std::memory_order_relaxed);
+		return dropped;
+	}
+
+} // namespace awesome
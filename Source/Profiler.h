@@ -0,0 +1,84 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * CPU scope profiler. PROFILE_SCOPE("name") times the enclosing scope and PROFILE_FRAME_END()
+ * closes a frame; both compile to nothing unless AWESOME_PROFILER is defined, so instrumented
+ * code costs nothing in normal builds. The Profile|x64 configuration is Release with AWESOME_PROFILER
+ * defined. Names must be string literals, only the pointer is kept.
+ */
+#ifdef AWESOME_PROFILER
+#define AWESOME_PROFILE_CONCAT_INNER(a, b) a##b
+#define AWESOME_PROFILE_CONCAT(a, b) AWESOME_PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ::awesome::ProfileScope AWESOME_PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FRAME_END() ::awesome::Profiler::EndFrame()
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_FRAME_END() ((void)0)
+#endif
+
+namespace awesome {
+
+	/* One finished scope, written when the scope closes */
+	struct ProfileEvent {
+		const char* name;
+		unsigned long long startTicks;
+		unsigned long long endTicks;
+		uint32_t depth;
+		uint32_t threadIndex;
+	};
+
+	/* A scope in the frame's call tree, totals over every call with the same parent and name */
+	struct ProfileNode {
+		const char* name;
+		int32_t parent; // -1 for roots
+		uint32_t depth;
+		uint32_t calls;
+		unsigned long long totalTicks;
+	};
+
+	struct ProfileFrame {
+		unsigned long long startTicks{ 0 };
+		unsigned long long endTicks{ 0 };
+		std::vector<ProfileEvent> events;
+	};
+
+	/*
+	 * Every thread writes its scopes into its own lock-free single producer ring, registered on the
+	 * thread's first scope. EndFrame, called on one thread, drains all rings into the frame that just
+	 * ended and keeps the last MAX_CAPTURED_FRAMES frames for export. A full ring drops scopes (counted)
+	 * rather than block the thread being measured.
+	 */
+	class Profiler {
+	public:
+		static constexpr size_t MAX_CAPTURED_FRAMES = 600;
+		static constexpr size_t EVENTS_PER_THREAD = 1 << 16;
+
+		static void BeginScope();
+		static void EndScope(const char* name, unsigned long long startTicks);
+		static void EndFrame();
+
+		/* Call tree of one thread in the latest frame, parents before their children */
+		static std::vector<ProfileNode> GetFrameHierarchy(uint32_t threadIndex = 0);
+		static void FormatFrameHierarchy(char* buffer, size_t bufferSize, uint32_t threadIndex = 0);
+		/* Chrome/Perfetto JSON of all captured frames, open in chrome://tracing or ui.perfetto.dev */
+		static bool WriteChromeTrace(const std::string& path);
+		static unsigned long long GetDroppedEvents();
+	};
+
+	class ProfileScope {
+	public:
+		explicit ProfileScope(const char* name);
+		~ProfileScope();
+		ProfileScope(const ProfileScope&) = delete;
+		ProfileScope& operator=(const ProfileScope&) = delete;
+
+	private:
+		const char* name;
+		unsigned long long startTicks;
+	};
+
+} // namespace awesome
@@ -0,0 +1,221 @@
+#include "ShaderCache.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace awesome {
+
+	namespace {
+		constexpr uint32_t CACHE_FILE_MAGIC = 0x43535741; // "AWSC"
+		constexpr uint32_t CACHE_FILE_VERSION = 1;
+
+		struct CacheFileHeader {
+			uint32_t magic;
+			uint32_t version;
+			uint64_t key;
+			uint64_t size;
+		};
+
+		/* Extracts the file name from an #include line, quoted or angle bracketed */
+		bool ParseInclude(const std::string& line, std::string& file) {
+			size_t pos = line.find_first_not_of(" \t");
+			if (pos == std::string::npos || line[pos] != '#')
+				return false;
+			pos = line.find_first_not_of(" \t", pos + 1);
+			if (pos == std::string::npos || line.compare(pos, 7, "include") != 0)
+				return false;
+			size_t open = line.find_first_of("\"<", pos + 7);
+			if (open == std::string::npos)
+				return false;
+			size_t close = line.find(line[open] == '"' ? '"' : '>', open + 1);
+			if (close == std::string::npos)
+				return false;
+			file = line.substr(open + 1, close - open - 1);
+			return true;
+		}
+	}
+
+	uint64_t HashBytes(const void* data, size_t size, uint64_t seed) {
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		uint64_t hash = seed;
+		for (size_t i = 0; i < size; ++i) {
+			hash ^= bytes[i];
+			hash *= 0x100000001B3ULL;
+		}
+		return hash;
+	}
+
+	uint64_t HashString(const std::string& s, uint64_t seed) {
+		/* Include the length so "ab" + "c" and "a" + "bc" differ */
+		uint64_t length = s.size();
+		return HashBytes(s.data(), s.size(), HashBytes(&length, sizeof(length), seed));
+	}
+
+	ShaderCache::ShaderCache(std::string cacheDirectory, ShaderCompiler* compiler)
+		: cacheDirectory(std::move(cacheDirectory)), compiler(compiler) {}
+
+	const std::string* ShaderCache::ReadSource(const std::string& path) {
+		auto it = sources.find(path);
+		if (it != sources.end())
+			return &it->second;
+
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return nullptr;
+		std::ostringstream contents;
+		contents << file.rdbuf();
+		++stats.sourceFileReads;
+		return &sources.emplace(path, contents.str()).first->second;
+	}
+
+	bool ShaderCache::HashSourceTree(const std::string& path, uint64_t& hash, std::unordered_set<std::string>& visited, std::string& errors) {
+		if (!visited.insert(path).second)
+			return true; // already hashed, include guards or #pragma once
+		const std::string* source = ReadSource(path);
+		if (!source) {
+			errors = "Could not compile shader; file not found: " + path;
+			return false;
+		}
+		hash = HashString(path, hash);
+		hash = HashString(*source, hash);
+
+		/* Includes resolve relative to the including file, like D3D_COMPILE_STANDARD_FILE_INCLUDE */
+		std::filesystem::path directory = std::filesystem::path(path).parent_path();
+		std::istringstream lines(*source);
+		std::string line, include;
+		while (std::getline(lines, line)) {
+			if (!ParseInclude(line, include))
+				continue;
+			std::string includePath = (directory / include).generic_string();
+			if (!ReadSource(includePath)) {
+				/* Possibly inside an #if, let the compiler decide whether it matters */
+				hash = HashString("missing:" + includePath, hash);
+				continue;
+			}
+			if (!HashSourceTree(includePath, hash, visited, errors))
+				return false;
+		}
+		return true;
+	}
+
+	bool ShaderCache::ComputeKey(const ShaderCompileDesc& desc, uint64_t& key, std::string& errors) {
+		std::lock_guard<std::mutex> lock(mutex);
+		return ComputeKeyLocked(desc, key, errors);
+	}
+
+	ShaderCacheStats ShaderCache::GetStats() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return stats;
+	}
+
+	bool ShaderCache::ComputeKeyLocked(const ShaderCompileDesc& desc, uint64_t& key, std::string& errors) {
+		uint64_t hash = HASH_SEED;
+		std::unordered_set<std::string> visited;
+		if (!HashSourceTree(desc.sourcePath, hash, visited, errors))
+			return false;
+		hash = HashString(desc.entryPoint, hash);
+		hash = HashString(desc.profile, hash);
+		for (const ShaderDefine& define : desc.defines) {
+			hash = HashString(define.name, hash);
+			hash = HashString(define.value, hash);
+		}
+		hash = HashBytes(&desc.flags, sizeof(desc.flags), hash);
+		uint64_t compilerVersion = compiler ? compiler->GetVersionHash() : 0;
+		key = HashBytes(&compilerVersion, sizeof(compilerVersion), hash);
+		return true;
+	}
+
+	std::string ShaderCache::GetCachePath(uint64_t key) const {
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.dxbc", static_cast<unsigned long long>(key));
+		return (std::filesystem::path(cacheDirectory) / name).string();
+	}
+
+	bool ShaderCache::ReadCacheFile(uint64_t key, ShaderBytecode& bytecode) const {
+		std::ifstream file(GetCachePath(key), std::ios::binary);
+		if (!file)
+			return false;
+		CacheFileHeader header;
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+			return false;
+		if (header.magic != CACHE_FILE_MAGIC || header.version != CACHE_FILE_VERSION || header.key != key)
+			return false;
+		/* The size has to match what is actually left in the file, a corrupt header must not pick the allocation size */
+		std::streampos dataStart = file.tellg();
+		file.seekg(0, std::ios::end);
+		std::streamoff remaining = file.tellg() - dataStart;
+		if (remaining < 0 || header.size != static_cast<uint64_t>(remaining))
+			return false;
+		file.seekg(dataStart);
+		bytecode.resize(static_cast<size_t>(header.size));
+		return static_cast<bool>(file.read(reinterpret_cast<char*>(bytecode.data()), bytecode.size()));
+	}
+
+	void ShaderCache::WriteCacheFile(uint64_t key, const ShaderBytecode& bytecode) const {
+		std::error_code error;
+		std::filesystem::create_directories(cacheDirectory, error);
+
+		/* Write to a temporary name first so a crash never leaves a truncated entry behind */
+		std::string path = GetCachePath(key);
+		std::string tempPath = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file)
+				return;
+			CacheFileHeader header{ CACHE_FILE_MAGIC, CACHE_FILE_VERSION, key, bytecode.size() };
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(bytecode.data()), bytecode.size());
+			if (!file)
+				return;
+		}
+		std::filesystem::rename(tempPath, path, error);
+		if (error)
+			std::filesystem::remove(tempPath, error);
+	}
+
+	bool ShaderCache::GetBytecode(const ShaderCompileDesc& desc, ShaderBytecode& bytecode, std::string& errors) {
+		uint64_t key;
+		std::string source;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!ComputeKeyLocked(desc, key, errors)) {
+				++stats.failures;
+				return false;
+			}
+			auto it = memoryCache.find(key);
+			if (it != memoryCache.end()) {
+				bytecode = it->second;
+				++stats.memoryHits;
+				return true;
+			}
+			source = sources[desc.sourcePath];
+		}
+
+		bool fromDisk = ReadCacheFile(key, bytecode);
+		if (!fromDisk) {
+			if (!compiler) {
+				errors = "Shader " + desc.sourcePath + ":" + desc.entryPoint + " is not in the cache and there is no compiler";
+				std::lock_guard<std::mutex> lock(mutex);
+				++stats.failures;
+				return false;
+			}
+			if (!compiler->Compile(desc, source, bytecode, errors)) {
+				std::lock_guard<std::mutex> lock(mutex);
+				++stats.failures;
+				return false;
+			}
+			WriteCacheFile(key, bytecode);
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		memoryCache.emplace(key, bytecode);
+		if (fromDisk)
+			++stats.diskHits;
+		else
+			++stats.compiles;
+		return true;
+	}
+
+} // namespace awesome
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace awesome {
+
+	using ShaderBytecode = std::vector<uint8_t>;
+
+	struct ShaderDefine {
+		std::string name;
+		std::string value;
+	};
+
+	/* Everything that affects the compiled bytecode, apart from the source text and its includes */
+	struct ShaderCompileDesc {
+		std::string sourcePath;
+		std::string entryPoint;
+		std::string profile;
+		std::vector<ShaderDefine> defines;
+		uint32_t flags{ 0 };
+	};
+
+	/* The D3D compiler on Windows, a stand-in anywhere the cache logic is exercised without one */
+	class ShaderCompiler {
+	public:
+		virtual ~ShaderCompiler() = default;
+		virtual bool Compile(const ShaderCompileDesc& desc, const std::string& source, ShaderBytecode& bytecode, std::string& errors) = 0;
+		/* Part of every cache key, so a compiler update invalidates old bytecode */
+		virtual uint64_t GetVersionHash() const { return 0; }
+	};
+
+	struct ShaderCacheStats {
+		uint32_t memoryHits{ 0 };
+		uint32_t diskHits{ 0 };
+		uint32_t compiles{ 0 };
+		uint32_t failures{ 0 };
+		uint32_t sourceFileReads{ 0 };
+	};
+
+	/* 64 bit FNV-1a, chain calls by passing the previous result as the seed */
+	constexpr uint64_t HASH_SEED = 0xCBF29CE484222325ULL;
+	uint64_t HashBytes(const void* data, size_t size, uint64_t seed = HASH_SEED);
+	uint64_t HashString(const std::string& s, uint64_t seed = HASH_SEED);
+
+	/*
+	 * Compiled shader bytecode keyed by a hash of the source, every file it includes, the defines,
+	 * entry point, profile, flags and compiler version. Lookups go memory, then the cache directory,
+	 * and only then the compiler; compiled results are written back to the directory.
+	 * Source files are read once per run no matter how many entry points use them.
+	 * Safe to use from several threads, compiles run outside the lock.
+	 */
+	class ShaderCache {
+	public:
+		ShaderCache(std::string cacheDirectory, ShaderCompiler* compiler);
+
+		bool GetBytecode(const ShaderCompileDesc& desc, ShaderBytecode& bytecode, std::string& errors);
+		/* Returns false if the source or one of its includes can not be read */
+		bool ComputeKey(const ShaderCompileDesc& desc, uint64_t& key, std::string& errors);
+		std::string GetCachePath(uint64_t key) const;
+		ShaderCacheStats GetStats() const;
+
+	private:
+		bool ComputeKeyLocked(const ShaderCompileDesc& desc, uint64_t& key, std::string& errors);
+		const std::string* ReadSource(const std::string& path);
+		bool HashSourceTree(const std::string& path, uint64_t& hash, std::unordered_set<std::string>& visited, std::string& errors);
+		bool ReadCacheFile(uint64_t key, ShaderBytecode& bytecode) const;
+		void WriteCacheFile(uint64_t key, const ShaderBytecode& bytecode) const;
+
+		std::string cacheDirectory;
+		ShaderCompiler* compiler{ nullptr };
+		std::unordered_map<std::string, std::string> sources;
+		std::unordered_map<uint64_t, ShaderBytecode> memoryCache;
+		ShaderCacheStats stats{};
+		mutable std::mutex mutex;
+	};
+
+} // namespace awesome
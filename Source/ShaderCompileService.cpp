@@ -0,0 +1,123 @@
+#include "ShaderCompileService.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+
+namespace awesome {
+
+	ShaderCompileService::ShaderCompileService(ShaderCache& cache, uint32_t workerCount)
+		: cache(cache), workerCount(std::max(1u, workerCount)) {}
+
+	ShaderCompileService::~ShaderCompileService() {
+		std::deque<Job> abandoned;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+			abandoned.swap(queue);
+		}
+		wake.notify_all();
+		for (std::thread& worker : workers)
+			worker.join();
+
+		for (Job& job : abandoned) {
+			ShaderCompileResult result;
+			if (job.packPath.empty())
+				result.errors = "Shader compile service shut down before compiling " + job.desc.sourcePath + ":" + job.desc.entryPoint;
+			else
+				result.errors = "Shader compile service shut down before writing " + job.packPath;
+			job.promise.set_value(std::move(result));
+		}
+	}
+
+	ShaderCompileFuture ShaderCompileService::Request(const ShaderCompileDesc& desc) {
+		Job job;
+		job.desc = desc;
+		return Enqueue(std::move(job));
+	}
+
+	ShaderCompileFuture ShaderCompileService::RequestPackBuild(const PermutationPackDesc& desc, const std::vector<PermutationKey>& usedKeys,
+		const std::string& outputPath) {
+		Job job;
+		job.packDesc = desc;
+		job.packKeys = usedKeys;
+		job.packPath = outputPath;
+		return Enqueue(std::move(job));
+	}
+
+	ShaderCompileFuture ShaderCompileService::Enqueue(Job job) {
+		ShaderCompileFuture future = job.promise.get_future().share();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (workers.empty())
+				for (uint32_t i = 0; i < workerCount; ++i)
+					workers.emplace_back(&ShaderCompileService::WorkerLoop, this);
+			queue.push_back(std::move(job));
+		}
+		wake.notify_one();
+		return future;
+	}
+
+	uint32_t ShaderCompileService::GetPendingCount() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return static_cast<uint32_t>(queue.size()) + running;
+	}
+
+	void ShaderCompileService::WorkerLoop() {
+		for (;;) {
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this] { return stopping || !queue.empty(); });
+				if (stopping)
+					return;
+				job = std::move(queue.front());
+				queue.pop_front();
+				++running;
+			}
+
+			ShaderCompileResult result;
+			if (job.packPath.empty()) {
+				PROFILE_SCOPE("Compile shader");
+				result.succeeded = cache.GetBytecode(job.desc, result.bytecode, result.errors);
+			}
+			else {
+				PROFILE_SCOPE("Build shader pack");
+				result.succeeded = ShaderPermutationPack::Build(job.packDesc, job.packKeys, cache, job.packPath, result.errors);
+			}
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				--running;
+			}
+			job.promise.set_value(std::move(result));
+		}
+	}
+
+	void AsyncShaderProgram::Request(ShaderCompileService& service, const ShaderCompileDesc (&stages)[SHADER_STAGE_COUNT]) {
+		for (uint32_t stage = 0; stage < SHADER_STAGE_COUNT; ++stage) {
+			futures[stage] = service.Request(stages[stage]);
+			results[stage] = {};
+		}
+		errors.clear();
+		state = ShaderProgramState::Compiling;
+	}
+
+	ShaderProgramState AsyncShaderProgram::Poll() {
+		if (state != ShaderProgramState::Compiling)
+			return state;
+		for (const ShaderCompileFuture& future : futures)
+			if (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+				return state;
+
+		state = ShaderProgramState::Ready;
+		for (uint32_t stage = 0; stage < SHADER_STAGE_COUNT; ++stage) {
+			results[stage] = futures[stage].get();
+			futures[stage] = {};
+			if (!results[stage].succeeded) {
+				state = ShaderProgramState::Failed;
+				errors += results[stage].errors;
+			}
+		}
+		return state;
+	}
+
+} // namespace awesome
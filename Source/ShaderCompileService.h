@@ -0,0 +1,100 @@
+#pragma once
+#include "ShaderCache.h"
+#include "ShaderPermutations.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace awesome {
+
+	struct ShaderCompileResult {
+		bool succeeded{ false };
+		ShaderBytecode bytecode;
+		std::string errors;
+	};
+	using ShaderCompileFuture = std::shared_future<ShaderCompileResult>;
+
+	/*
+	 * Compiles shaders through the cache on a pool of worker threads. Request never blocks,
+	 * the future becomes ready once the bytecode is in memory. Workers are started on the first
+	 * request and joined by the destructor; requests still queued at that point fail.
+	 */
+	class ShaderCompileService {
+	public:
+		ShaderCompileService(ShaderCache& cache, uint32_t workerCount);
+		~ShaderCompileService();
+		ShaderCompileService(const ShaderCompileService&) = delete;
+		ShaderCompileService& operator=(const ShaderCompileService&) = delete;
+
+		ShaderCompileFuture Request(const ShaderCompileDesc& desc);
+		/* Compiles the used permutations and writes the pack on a worker; the result carries no bytecode */
+		ShaderCompileFuture RequestPackBuild(const PermutationPackDesc& desc, const std::vector<PermutationKey>& usedKeys, const std::string& outputPath);
+		/* Queued plus currently compiling */
+		uint32_t GetPendingCount() const;
+
+	private:
+		struct Job {
+			ShaderCompileDesc desc;
+			/* A pack build when packPath is set, desc is unused then */
+			PermutationPackDesc packDesc;
+			std::vector<PermutationKey> packKeys;
+			std::string packPath;
+			std::promise<ShaderCompileResult> promise;
+		};
+
+		ShaderCompileFuture Enqueue(Job job);
+		void WorkerLoop();
+
+		ShaderCache& cache;
+		uint32_t workerCount{ 1 };
+		std::vector<std::thread> workers;
+		std::deque<Job> queue;
+		uint32_t running{ 0 };
+		bool stopping{ false };
+		mutable std::mutex mutex;
+		std::condition_variable wake;
+	};
+
+	enum class ShaderProgramState {
+		Idle,
+		Compiling,
+		Ready,
+		Failed
+	};
+
+	/* All stages of one program compiled in the background, polled once per frame */
+	class AsyncShaderProgram {
+	public:
+		void Request(ShaderCompileService& service, const ShaderCompileDesc (&stages)[SHADER_STAGE_COUNT]);
+		/* Never blocks; the state only moves to Ready or Failed once every stage has finished */
+		ShaderProgramState Poll();
+		ShaderProgramState GetState() const { return state; }
+		const ShaderBytecode& GetBytecode(ShaderStage stage) const { return results[stage].bytecode; }
+		const std::string& GetErrors() const { return errors; }
+
+	private:
+		ShaderCompileFuture futures[SHADER_STAGE_COUNT];
+		ShaderCompileResult results[SHADER_STAGE_COUNT];
+		std::string errors;
+		ShaderProgramState state{ ShaderProgramState::Idle };
+	};
+
+	enum class DrawShaderChoice {
+		Program,
+		Fallback,
+		Skip
+	};
+
+	/* What a draw uses while its program is not ready: the fallback if there is one, otherwise nothing */
+	inline DrawShaderChoice ChooseDrawShader(ShaderProgramState state, bool haveFallback) {
+		if (state == ShaderProgramState::Ready)
+			return DrawShaderChoice::Program;
+		return haveFallback ? DrawShaderChoice::Fallback : DrawShaderChoice::Skip;
+	}
+
+} // namespace awesome
@@ -0,0 +1,51 @@
+#pragma once
+#include "ConstantBufferLayout.h"
+
+namespace awesome {
+
+	/*
+	 * Mirrors the cbuffers in Shaders/surface.hlsl, field for field. Constants are split by how
+	 * often they change so each tier is only uploaded when its own data changes: once per frame,
+	 * once per view, when the material changes, and per draw for the small object tier.
+	 */
+	enum ConstantBufferSlot : uint32_t {
+		CBUFFER_SLOT_FRAME,
+		CBUFFER_SLOT_VIEW,
+		CBUFFER_SLOT_MATERIAL,
+		CBUFFER_SLOT_OBJECT,
+		CBUFFER_SLOT_COUNT
+	};
+
+	struct FrameConstants {
+		float timeSec;
+		float deltaTimeSec;
+		float padding[2];
+	};
+	using FrameConstantsLayout = CBufferLayout<FrameConstants,
+		AWESOME_CBUFFER_FIELD(FrameConstants, timeSec),
+		AWESOME_CBUFFER_FIELD(FrameConstants, deltaTimeSec)>;
+
+	struct ViewConstants {
+		float4x4 viewProj;
+		float3 cameraPosition;
+		float padding;
+	};
+	using ViewConstantsLayout = CBufferLayout<ViewConstants,
+		AWESOME_CBUFFER_FIELD(ViewConstants, viewProj),
+		AWESOME_CBUFFER_FIELD(ViewConstants, cameraPosition)>;
+
+	struct MaterialConstants {
+		float4 baseColor;
+	};
+	using MaterialConstantsLayout = CBufferLayout<MaterialConstants,
+		AWESOME_CBUFFER_FIELD(MaterialConstants, baseColor)>;
+
+	/* Transforms live in the per-frame ObjectTransforms buffer, a draw only says where its own start */
+	struct ObjectConstants {
+		uint32_t firstTransform;
+		uint32_t padding[3];
+	};
+	using ObjectConstantsLayout = CBufferLayout<ObjectConstants,
+		AWESOME_CBUFFER_FIELD(ObjectConstants, firstTransform)>;
+
+} // namespace awesome
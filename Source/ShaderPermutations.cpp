@@ -0,0 +1,169 @@
+#include "ShaderPermutations.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+namespace awesome {
+
+	namespace {
+		constexpr uint32_t PACK_MAGIC = 0x50535741; // "AWSP"
+		constexpr uint32_t PACK_VERSION = 1;
+
+		struct PackHeader {
+			uint32_t magic;
+			uint32_t version;
+			uint32_t featureBitCount;
+			uint32_t stageCount;
+			uint32_t permutationCount;
+			uint32_t reserved;
+			uint64_t sourceHash;
+		};
+
+		const char* FEATURE_DEFINES[SHADER_FEATURE_BIT_COUNT] = {
+			"TEXTURED",
+			"VERTEX_COLOR",
+		};
+	}
+
+	const char* GetShaderFeatureDefine(uint32_t featureBit) {
+		return featureBit < SHADER_FEATURE_BIT_COUNT ? FEATURE_DEFINES[featureBit] : nullptr;
+	}
+
+	void BuildPermutationDefines(PermutationKey key, std::vector<ShaderDefine>& defines) {
+		defines.clear();
+		for (uint32_t bit = 0; bit < SHADER_FEATURE_BIT_COUNT; ++bit)
+			defines.push_back({ FEATURE_DEFINES[bit], (key & (1u << bit)) ? "1" : "0" });
+	}
+
+	ShaderCompileDesc MakePermutationCompileDesc(const PermutationPackDesc& desc, PermutationKey key, ShaderStage stage) {
+		ShaderCompileDesc compileDesc;
+		compileDesc.sourcePath = desc.sourcePath;
+		compileDesc.entryPoint = desc.entryPoints[stage];
+		compileDesc.profile = desc.profiles[stage];
+		compileDesc.flags = desc.flags;
+		BuildPermutationDefines(key, compileDesc.defines);
+		return compileDesc;
+	}
+
+	bool ShaderPermutationPack::ComputeSourceHash(const PermutationPackDesc& desc, const std::vector<PermutationKey>& usedKeys, ShaderCache& cache,
+		uint64_t& hash, std::string& errors) {
+		std::vector<PermutationKey> keys = usedKeys;
+		std::sort(keys.begin(), keys.end());
+		keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+		hash = HASH_SEED;
+		for (PermutationKey key : keys) {
+			for (uint32_t stage = 0; stage < SHADER_STAGE_COUNT; ++stage) {
+				uint64_t entryKey;
+				if (!cache.ComputeKey(MakePermutationCompileDesc(desc, key, static_cast<ShaderStage>(stage)), entryKey, errors))
+					return false;
+				hash = HashBytes(&entryKey, sizeof(entryKey), hash);
+			}
+		}
+		return true;
+	}
+
+	bool ShaderPermutationPack::Build(const PermutationPackDesc& desc, const std::vector<PermutationKey>& usedKeys, ShaderCache& cache,
+		const std::string& outputPath, std::string& errors) {
+		const uint32_t tableSize = (1u << SHADER_FEATURE_BIT_COUNT) * SHADER_STAGE_COUNT;
+		std::vector<Entry> entries(tableSize, Entry{ 0, 0 });
+		std::vector<uint8_t> blobs;
+		const uint32_t dataStart = static_cast<uint32_t>(sizeof(PackHeader) + tableSize * sizeof(Entry));
+
+		std::vector<PermutationKey> keys = usedKeys;
+		std::sort(keys.begin(), keys.end());
+		keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+		ShaderBytecode bytecode;
+		for (PermutationKey key : keys) {
+			if (key >= (1u << SHADER_FEATURE_BIT_COUNT)) {
+				errors = "Permutation key uses an unknown feature bit";
+				return false;
+			}
+			for (uint32_t stage = 0; stage < SHADER_STAGE_COUNT; ++stage) {
+				if (!cache.GetBytecode(MakePermutationCompileDesc(desc, key, static_cast<ShaderStage>(stage)), bytecode, errors))
+					return false;
+				/* DXBC only needs 4 byte alignment */
+				blobs.resize((blobs.size() + 3) & ~size_t(3));
+				entries[key * SHADER_STAGE_COUNT + stage] = { dataStart + static_cast<uint32_t>(blobs.size()), static_cast<uint32_t>(bytecode.size()) };
+				blobs.insert(blobs.end(), bytecode.begin(), bytecode.end());
+			}
+		}
+
+		PackHeader header{ PACK_MAGIC, PACK_VERSION, SHADER_FEATURE_BIT_COUNT, SHADER_STAGE_COUNT, static_cast<uint32_t>(keys.size()), 0, 0 };
+		if (!ComputeSourceHash(desc, keys, cache, header.sourceHash, errors))
+			return false;
+
+		/* Like the shader cache entries: a temporary name first, so a crash or a full disk keeps the previous pack intact */
+		std::string tempPath = outputPath + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+		std::error_code error;
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file) {
+				errors = "Could not write shader pack " + outputPath;
+				return false;
+			}
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+			file.write(reinterpret_cast<const char*>(blobs.data()), blobs.size());
+			if (!file) {
+				file.close();
+				std::filesystem::remove(tempPath, error);
+				errors = "Could not write shader pack " + outputPath;
+				return false;
+			}
+		}
+		std::filesystem::rename(tempPath, outputPath, error);
+		if (error) {
+			std::filesystem::remove(tempPath, error);
+			errors = "Could not replace shader pack " + outputPath;
+			return false;
+		}
+		return true;
+	}
+
+	bool ShaderPermutationPack::Load(const std::string& path) {
+		table = nullptr;
+		tableSize = 0;
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+		PackHeader header;
+		if (data.size() < sizeof(header))
+			return false;
+		memcpy(&header, data.data(), sizeof(header));
+		if (header.magic != PACK_MAGIC || header.version != PACK_VERSION)
+			return false;
+		/* Built for a different feature set, the keys would mean something else */
+		if (header.featureBitCount != SHADER_FEATURE_BIT_COUNT || header.stageCount != SHADER_STAGE_COUNT)
+			return false;
+
+		uint32_t entryCount = (1u << SHADER_FEATURE_BIT_COUNT) * SHADER_STAGE_COUNT;
+		if (data.size() < sizeof(header) + entryCount * sizeof(Entry))
+			return false;
+		const Entry* entries = reinterpret_cast<const Entry*>(data.data() + sizeof(header));
+		for (uint32_t i = 0; i < entryCount; ++i)
+			if (static_cast<size_t>(entries[i].offset) + entries[i].size > data.size())
+				return false;
+
+		table = entries;
+		tableSize = entryCount;
+		permutationCount = header.permutationCount;
+		sourceHash = header.sourceHash;
+		return true;
+	}
+
+	bool ShaderPermutationPack::Find(PermutationKey key, ShaderStage stage, const uint8_t*& bytecode, size_t& size) const {
+		uint32_t index = key * SHADER_STAGE_COUNT + stage;
+		if (index >= tableSize || table[index].size == 0)
+			return false;
+		bytecode = data.data() + table[index].offset;
+		size = table[index].size;
+		return true;
+	}
+
+} // namespace awesome
@@ -0,0 +1,68 @@
+#pragma once
+#include "ShaderCache.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace awesome {
+
+	/* One bit per shader feature, every bit becomes a define set to 0 or 1 */
+	enum ShaderFeature : uint32_t {
+		SHADER_FEATURE_TEXTURED = 1u << 0,
+		SHADER_FEATURE_VERTEX_COLOR = 1u << 1,
+	};
+	constexpr uint32_t SHADER_FEATURE_BIT_COUNT = 2;
+	using PermutationKey = uint32_t;
+
+	enum ShaderStage : uint32_t {
+		SHADER_STAGE_VERTEX,
+		SHADER_STAGE_PIXEL,
+		SHADER_STAGE_COUNT
+	};
+
+	const char* GetShaderFeatureDefine(uint32_t featureBit);
+	void BuildPermutationDefines(PermutationKey key, std::vector<ShaderDefine>& defines);
+
+	/* One source file with one entry point per stage, specialised by the feature bits */
+	struct PermutationPackDesc {
+		std::string sourcePath;
+		std::string entryPoints[SHADER_STAGE_COUNT];
+		std::string profiles[SHADER_STAGE_COUNT];
+		uint32_t flags{ 0 };
+	};
+
+	ShaderCompileDesc MakePermutationCompileDesc(const PermutationPackDesc& desc, PermutationKey key, ShaderStage stage);
+
+	/*
+	 * All used permutations of a shader in one file: a header, a dense table indexed by
+	 * key * SHADER_STAGE_COUNT + stage, then the bytecode. Only the keys passed to Build are compiled,
+	 * the other table entries are empty, and lookups are a single array access.
+	 */
+	class ShaderPermutationPack {
+	public:
+		/* Compiles the used permutations (through the cache) and writes the pack */
+		static bool Build(const PermutationPackDesc& desc, const std::vector<PermutationKey>& usedKeys, ShaderCache& cache,
+			const std::string& outputPath, std::string& errors);
+		/* Combined cache key of every used permutation, stored in the pack to detect stale packs */
+		static bool ComputeSourceHash(const PermutationPackDesc& desc, const std::vector<PermutationKey>& usedKeys, ShaderCache& cache,
+			uint64_t& hash, std::string& errors);
+
+		bool Load(const std::string& path);
+		bool Find(PermutationKey key, ShaderStage stage, const uint8_t*& bytecode, size_t& size) const;
+		uint64_t GetSourceHash() const { return sourceHash; }
+		uint32_t GetPermutationCount() const { return permutationCount; }
+
+	private:
+		struct Entry {
+			uint32_t offset;
+			uint32_t size;
+		};
+
+		std::vector<uint8_t> data;
+		const Entry* table{ nullptr };
+		uint32_t tableSize{ 0 };
+		uint32_t permutationCount{ 0 };
+		uint64_t sourceHash{ 0 };
+	};
+
+} // namespace awesome
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+namespace awesome {
+
+	/*
+	 * Bounded lock-free queue for exactly one producer thread and one consumer thread. Each side
+	 * keeps a cached copy of the other's position on its own cache line, so the shared atomics are
+	 * only read when the cached copy says the queue looks full (producer) or empty (consumer).
+	 * TryPush fails instead of blocking when the queue is full.
+	 */
+	template<typename T, size_t Capacity>
+	class SpscQueue {
+		static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+	public:
+		/* Producer only */
+		bool TryPush(const T& value) {
+			size_t write = writePos.load(std::memory_order_relaxed);
+			if (write - cachedReadPos == Capacity) {
+				cachedReadPos = readPos.load(std::memory_order_acquire);
+				if (write - cachedReadPos == Capacity)
+					return false;
+			}
+			items[write & (Capacity - 1)] = value;
+			writePos.store(write + 1, std::memory_order_release);
+			return true;
+		}
+
+		/* Consumer only */
+		bool TryPop(T& value) {
+			size_t read = readPos.load(std::memory_order_relaxed);
+			if (read == cachedWritePos) {
+				cachedWritePos = writePos.load(std::memory_order_acquire);
+				if (read == cachedWritePos)
+					return false;
+			}
+			value = items[read & (Capacity - 1)];
+			readPos.store(read + 1, std::memory_order_release);
+			return true;
+		}
+
+		/* Consumer only, the item stays queued */
+		bool TryPeek(T& value) {
+			size_t read = readPos.load(std::memory_order_relaxed);
+			if (read == cachedWritePos) {
+				cachedWritePos = writePos.load(std::memory_order_acquire);
+				if (read == cachedWritePos)
+					return false;
+			}
+			value = items[read & (Capacity - 1)];
+			return true;
+		}
+
+		/* Only a snapshot when the other side is running */
+		size_t GetSize() const {
+			return writePos.load(std::memory_order_acquire) - readPos.load(std::memory_order_acquire);
+		}
+
+		static constexpr size_t GetCapacity() { return Capacity; }
+
+	private:
+		alignas(64) std::atomic<size_t> writePos{ 0 };
+		size_t cachedReadPos{ 0 };
+		alignas(64) std::atomic<size_t> readPos{ 0 };
+		size_t cachedWritePos{ 0 };
+		alignas(64) T items[Capacity]{};
+	};
+
+} // namespace awesome
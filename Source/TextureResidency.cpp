@@ -0,0 +1,177 @@
+#include "TextureResidency.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+
+namespace awesome {
+
+	TextureHandle TextureResidencyManager::Register(const TextureResidencyDesc& desc) {
+		assert(desc.mipCount > 0 && desc.blockSize > 0);
+		TextureHandle handle;
+		if (!freeHandles.empty()) {
+			handle = freeHandles.back();
+			freeHandles.pop_back();
+		}
+		else {
+			handle = static_cast<TextureHandle>(textures.size());
+			textures.emplace_back();
+		}
+
+		Texture& t = textures[handle];
+		t = Texture{};
+		t.desc = desc;
+		t.mipBytes.resize(desc.mipCount);
+		for (uint32_t mip = 0; mip < desc.mipCount; ++mip) {
+			uint64_t w = std::max(desc.width >> mip, 1u);
+			uint64_t h = std::max(desc.height >> mip, 1u);
+			uint64_t blocksX = (w + desc.blockSize - 1) / desc.blockSize;
+			uint64_t blocksY = (h + desc.blockSize - 1) / desc.blockSize;
+			t.mipBytes[mip] = blocksX * blocksY * desc.bytesPerBlock;
+		}
+		t.registered = true;
+
+		/* Textures are created with their full mip chain */
+		stats.residentBytes += ResidentBytes(t, 0);
+		++stats.textureCount;
+		return handle;
+	}
+
+	void TextureResidencyManager::Unregister(TextureHandle texture) {
+		Texture& t = textures[texture];
+		assert(t.registered);
+		stats.residentBytes -= ResidentBytes(t, t.topMip);
+		if (t.topMip == t.desc.mipCount)
+			--stats.evictedTextures;
+		--stats.textureCount;
+		t = Texture{};
+		freeHandles.push_back(texture);
+	}
+
+	void TextureResidencyManager::MarkUsed(TextureHandle texture, uint64_t frame, float coveredPixels) {
+		Texture& t = textures[texture];
+		if (t.lastUsedFrame != frame) {
+			t.lastUsedFrame = frame;
+			t.coveredPixels = 0.f;
+		}
+		t.coveredPixels += coveredPixels;
+	}
+
+	uint64_t TextureResidencyManager::GetMipBytes(TextureHandle texture, uint32_t mip) const {
+		return textures[texture].mipBytes[mip];
+	}
+
+	uint64_t TextureResidencyManager::ResidentBytes(const Texture& t, uint32_t topMip) const {
+		uint64_t bytes = 0;
+		for (uint32_t mip = topMip; mip < t.desc.mipCount; ++mip)
+			bytes += t.mipBytes[mip];
+		return bytes;
+	}
+
+	void TextureResidencyManager::SetTopMip(TextureHandle texture, uint32_t topMip, std::vector<ResidencyChange>& changes) {
+		Texture& t = textures[texture];
+		if (topMip == t.topMip)
+			return;
+		stats.residentBytes -= ResidentBytes(t, t.topMip);
+		stats.residentBytes += ResidentBytes(t, topMip);
+		if (topMip > t.topMip)
+			stats.mipsDroppedThisFrame += topMip - t.topMip;
+		else
+			stats.mipsRestoredThisFrame += t.topMip - topMip;
+		if (t.topMip == t.desc.mipCount)
+			--stats.evictedTextures;
+		if (topMip == t.desc.mipCount)
+			++stats.evictedTextures;
+
+		changes.push_back({ texture, t.topMip, topMip });
+		t.topMip = topMip;
+	}
+
+	void TextureResidencyManager::Update(uint64_t frame, std::vector<ResidencyChange>& changes) {
+		stats.mipsDroppedThisFrame = 0;
+		stats.mipsRestoredThisFrame = 0;
+		stats.wantedBytes = 0;
+
+		order.clear();
+		for (TextureHandle handle = 0; handle < textures.size(); ++handle) {
+			Texture& t = textures[handle];
+			if (!t.registered)
+				continue;
+			order.push_back(handle);
+
+			/* One texel per covered pixel is enough, every extra mip above that is wasted memory */
+			bool stale = frame - t.lastUsedFrame > evictAfterFrames;
+			if (stale) {
+				t.wantedTopMip = t.desc.mipCount;
+			}
+			else {
+				double texels = static_cast<double>(t.desc.width) * t.desc.height;
+				double ratio = t.coveredPixels > 0.f ? texels / t.coveredPixels : texels;
+				uint32_t mip = ratio > 1.0 ? static_cast<uint32_t>(0.5 * std::log2(ratio)) : 0;
+				t.wantedTopMip = std::min(mip, t.desc.mipCount - 1);
+			}
+			stats.wantedBytes += ResidentBytes(t, t.wantedTopMip);
+		}
+
+		if (stats.budgetBytes == 0) {
+			stats.pressure = 0.f;
+			stats.peakResidentBytes = std::max(stats.peakResidentBytes, stats.residentBytes);
+			return; // no budget configured
+		}
+		stats.pressure = static_cast<float>(static_cast<double>(stats.wantedBytes) / stats.budgetBytes);
+
+		/* Least recently used first, then the ones covering the least of the screen */
+		std::sort(order.begin(), order.end(), [this](TextureHandle a, TextureHandle b) {
+			const Texture& ta = textures[a];
+			const Texture& tb = textures[b];
+			if (ta.lastUsedFrame != tb.lastUsedFrame)
+				return ta.lastUsedFrame < tb.lastUsedFrame;
+			if (ta.coveredPixels != tb.coveredPixels)
+				return ta.coveredPixels < tb.coveredPixels;
+			return a < b;
+		});
+
+		if (stats.residentBytes > stats.budgetBytes) {
+			/* First give up mips that are finer than anything on screen needs, nobody will notice */
+			for (TextureHandle handle : order) {
+				if (stats.residentBytes <= stats.budgetBytes)
+					break;
+				const Texture& t = textures[handle];
+				if (t.topMip < t.wantedTopMip)
+					SetTopMip(handle, t.wantedTopMip, changes);
+			}
+			/* Then start losing detail, stale textures may go away completely */
+			for (TextureHandle handle : order) {
+				const Texture& t = textures[handle];
+				uint32_t lowestTopMip = frame - t.lastUsedFrame > evictAfterFrames ? t.desc.mipCount : t.desc.mipCount - 1;
+				while (stats.residentBytes > stats.budgetBytes && t.topMip < lowestTopMip)
+					SetTopMip(handle, t.topMip + 1, changes);
+				if (stats.residentBytes <= stats.budgetBytes)
+					break;
+			}
+		}
+		else {
+			/* Hand spare budget back to the most recently used, largest on screen textures */
+			for (auto it = order.rbegin(); it != order.rend(); ++it) {
+				const Texture& t = textures[*it];
+				if (t.lastUsedFrame + 1 < frame)
+					break;
+				while (t.topMip > t.wantedTopMip && stats.residentBytes + t.mipBytes[t.topMip - 1] <= stats.budgetBytes)
+					SetTopMip(*it, t.topMip - 1, changes);
+			}
+		}
+
+		stats.peakResidentBytes = std::max(stats.peakResidentBytes, stats.residentBytes);
+		if (stats.residentBytes > stats.budgetBytes)
+			++stats.framesOverBudget;
+	}
+
+	void TextureResidencyManager::FormatStats(char* buffer, size_t bufferSize) const {
+		const double MB = 1024.0 * 1024.0;
+		snprintf(buffer, bufferSize,
+			"Texture budget: %.1f / %.1f MB resident (peak %.1f MB, wanted %.1f MB, pressure %.2f), %u textures, %u evicted, %u mips dropped, %u restored, %u frames over budget\n",
+			stats.residentBytes / MB, stats.budgetBytes / MB, stats.peakResidentBytes / MB, stats.wantedBytes / MB, stats.pressure,
+			stats.textureCount, stats.evictedTextures, stats.mipsDroppedThisFrame, stats.mipsRestoredThisFrame, stats.framesOverBudget);
+	}
+
+} // namespace awesome
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace awesome {
+
+	using TextureHandle = uint32_t;
+	constexpr TextureHandle INVALID_TEXTURE_HANDLE = 0xFFFFFFFFu;
+
+	struct TextureResidencyDesc {
+		std::string name;
+		uint32_t width{ 0 };
+		uint32_t height{ 0 };
+		uint32_t mipCount{ 1 };
+		uint32_t blockSize{ 1 };     // 4 for BC formats, 1 for everything else
+		uint32_t bytesPerBlock{ 4 }; // bytes per texel when blockSize is 1
+	};
+
+	/* Tells the owner of a texture which mips it is allowed to keep, topMip == mipCount means fully evicted */
+	struct ResidencyChange {
+		TextureHandle texture;
+		uint32_t previousTopMip;
+		uint32_t topMip;
+	};
+
+	struct ResidencyStats {
+		uint64_t budgetBytes{ 0 };
+		uint64_t residentBytes{ 0 };
+		uint64_t peakResidentBytes{ 0 }; // highest residentBytes after an Update, once the budget is met
+		uint64_t wantedBytes{ 0 };     // what would be resident with no budget
+		uint32_t textureCount{ 0 };
+		uint32_t evictedTextures{ 0 }; // currently fully evicted
+		uint32_t mipsDroppedThisFrame{ 0 };
+		uint32_t mipsRestoredThisFrame{ 0 };
+		uint32_t framesOverBudget{ 0 };
+		float pressure{ 0.f };         // wantedBytes / budgetBytes, above 1 means we cannot keep everything
+	};
+
+	/*
+	 * Accounts for the memory of every texture per mip and keeps the total under a budget.
+	 * When over budget the top mips of the least recently used, smallest on screen textures are dropped first;
+	 * textures unused for evictAfterFrames can be evicted entirely. Spare budget is handed back to
+	 * recently used textures that are still missing mips they need.
+	 */
+	class TextureResidencyManager {
+	public:
+		void SetBudget(uint64_t bytes) { stats.budgetBytes = bytes; }
+		void SetEvictAfterFrames(uint32_t frames) { evictAfterFrames = frames; }
+
+		TextureHandle Register(const TextureResidencyDesc& desc);
+		void Unregister(TextureHandle texture);
+		/* coveredPixels is the screen area the texture was drawn over, used to pick the mip it actually needs */
+		void MarkUsed(TextureHandle texture, uint64_t frame, float coveredPixels);
+		void Update(uint64_t frame, std::vector<ResidencyChange>& changes);
+
+		uint32_t GetTopMip(TextureHandle texture) const { return textures[texture].topMip; }
+		uint64_t GetMipBytes(TextureHandle texture, uint32_t mip) const;
+		const ResidencyStats& GetStats() const { return stats; }
+		/* One line summary of the budget pressure, meant for the debug output */
+		void FormatStats(char* buffer, size_t bufferSize) const;
+
+	private:
+		struct Texture {
+			TextureResidencyDesc desc;
+			std::vector<uint64_t> mipBytes;
+			uint32_t topMip{ 0 };
+			uint32_t wantedTopMip{ 0 };
+			uint64_t lastUsedFrame{ 0 };
+			float coveredPixels{ 0.f };
+			bool registered{ false };
+		};
+
+		uint64_t ResidentBytes(const Texture& t, uint32_t topMip) const;
+		void SetTopMip(TextureHandle texture, uint32_t topMip, std::vector<ResidencyChange>& changes);
+
+		std::vector<Texture> textures;
+		std::vector<TextureHandle> freeHandles;
+		std::vector<TextureHandle> order;
+		uint32_t evictAfterFrames{ 300 };
+		ResidencyStats stats{};
+	};
+
+} // namespace awesome
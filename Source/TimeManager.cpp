@@ -1,41 +1,34 @@
 #include "TimeManager.h"
-#include <windows.h>
-#include <cstdlib>
-#include <algorithm>
+#include "Clock.h"
 
 namespace awesome {
 
 	TimeManager::TimeManager() {
-		LARGE_INTEGER Frequency;
-		if (!QueryPerformanceFrequency(&Frequency))
-			exit(-1); // Hardware does not support high-res counter
-		ticksPerSec = Frequency.QuadPart;
-
-		LARGE_INTEGER perfCount;
-		QueryPerformanceCounter(&perfCount);
-		startTimeTicks = currentTimeTicks = perfCount.QuadPart;
+		ticksPerSec = Clock::QueryTicksPerSec();
+		startTimeTicks = currentTimeTicks = Clock::QueryTicks();
 	}
 
-	unsigned long long TimeManager::Tick() {
+	double TimeManager::Tick() {
 		unsigned long long prevTimeTicks = currentTimeTicks;
-		LARGE_INTEGER perfCount;
-		QueryPerformanceCounter(&perfCount);
-		currentTimeTicks = perfCount.QuadPart;
-		unsigned long long deltaMs = (currentTimeTicks - prevTimeTicks) * 1000ULL / ticksPerSec;
-		//deltaMs = std::max(deltaMs, 7ULL); /* make sure the first frame is at least 7 ms (144 FPS) */
-		return deltaMs;
+		currentTimeTicks = Clock::QueryTicks();
+		deltaNs = TicksToNs(currentTimeTicks - prevTimeTicks, ticksPerSec);
+		return GetDeltaSec();
 	}
 
 	unsigned long long TimeManager::GetCurrentTimeTicks() const { 
 		return currentTimeTicks - startTimeTicks;
 	}
 
+	unsigned long long TimeManager::GetCurrentTimeNs() const {
+		return TicksToNs(GetCurrentTimeTicks(), ticksPerSec);
+	}
+
 	unsigned long long TimeManager::GetCurrentTimeMs() const { 
-		return GetCurrentTimeTicks() * 1000ULL / ticksPerSec;
+		return GetCurrentTimeNs() / 1000000ULL;
 	}
 
-	float TimeManager::GetCurrentTimeSec() const {
-		return static_cast<float> (GetCurrentTimeTicks() / ticksPerSec);
+	double TimeManager::GetCurrentTimeSec() const {
+		return static_cast<double>(GetCurrentTimeTicks()) / static_cast<double>(ticksPerSec);
 	}
 
 } // namespace awesome
@@ -2,17 +2,24 @@
 
 namespace awesome {
 
+	/* Frame clock; deltas are kept in nanoseconds so fast frames do not round to 0 or 1 ms */
 	class TimeManager {
 	public:
 		TimeManager();
-		unsigned long long Tick();
+		/* Advances to now and returns the frame delta in seconds */
+		double Tick();
+		unsigned long long GetDeltaNs() const { return deltaNs; }
+		double GetDeltaSec() const { return deltaNs * 1e-9; }
 		unsigned long long GetCurrentTimeTicks() const;
+		unsigned long long GetCurrentTimeNs() const;
 		unsigned long long GetCurrentTimeMs() const;
-		float GetCurrentTimeSec() const;
+		double GetCurrentTimeSec() const;
+
 	private:
 		unsigned long long ticksPerSec{0};
 		unsigned long long currentTimeTicks{0};
 		unsigned long long startTimeTicks{ 0 };
+		unsigned long long deltaNs{ 0 };
 	};
 
-} // awesome
\ No newline at end of file
+} // awesome
@@ -0,0 +1,14 @@
+#include "TransformBuffer.h"
+#include "JobSystem.h"
+
+namespace awesome {
+
+	void WriteObjectTransforms(float3x4* dst, const float4x4* models, uint32_t count, JobSystem& jobSystem) {
+		/* Contiguous ranges, so every thread streams through its own part of the write-combined mapping */
+		jobSystem.ParallelFor(count, MIN_TRANSFORMS_PER_JOB, [dst, models](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; ++i)
+				dst[i] = toFloat3x4(models[i]);
+		});
+	}
+
+} // namespace awesome
@@ -0,0 +1,19 @@
+#pragma once
+#include "3DMaths.h"
+#include <cstdint>
+
+namespace awesome {
+
+	class JobSystem;
+
+	/* Below this many transforms a job costs more than the copy it saves */
+	constexpr uint32_t MIN_TRANSFORMS_PER_JOB = 1024;
+
+	/*
+	 * Converts every object matrix of a frame into dst, typically the single mapped
+	 * StructuredBuffer<float3x4> the vertex shader indexes. Large counts are split into
+	 * contiguous ranges run as jobs, the caller's thread included.
+	 */
+	void WriteObjectTransforms(float3x4* dst, const float4x4* models, uint32_t count, JobSystem& jobSystem);
+
+} // namespace awesome
@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace awesome {
+
+	/*
+	 * Lock-free handoff of whole values from one writer thread to one reader thread. The writer
+	 * fills its back buffer and publishes it by swapping it with the middle buffer; the reader
+	 * swaps the middle buffer for its front buffer when a newer one is there. Neither side ever
+	 * waits, the reader always gets the most recent value, and a value the reader was too slow to
+	 * take is overwritten. Values are reused, not reconstructed, so containers keep their capacity.
+	 */
+	template<typename T>
+	class TripleBuffer {
+	public:
+		/* Writer only, the contents are whatever was published three values ago */
+		T& GetWriteBuffer() { return buffers[back]; }
+
+		/* Writer only; returns true if the previous published value was never read */
+		bool Publish() {
+			uint8_t previous = middle.exchange(static_cast<uint8_t>(back | FRESH), std::memory_order_acq_rel);
+			back = previous & INDEX_MASK;
+			return (previous & FRESH) != 0;
+		}
+
+		/* Reader only */
+		bool HasNew() const {
+			return (middle.load(std::memory_order_acquire) & FRESH) != 0;
+		}
+
+		/* Reader only; takes the latest published value if there is one newer than the current */
+		bool AcquireLatest() {
+			if (!HasNew())
+				return false;
+			uint8_t previous = middle.exchange(front, std::memory_order_acq_rel);
+			front = previous & INDEX_MASK;
+			return true;
+		}
+
+		/* Reader only, stays valid and unchanged until the next AcquireLatest */
+		const T& GetReadBuffer() const { return buffers[front]; }
+
+	private:
+		static constexpr uint8_t INDEX_MASK = 0x3;
+		static constexpr uint8_t FRESH = 0x4;
+
+		T buffers[3]{};
+		uint8_t back{ 0 };                   // writer's
+		alignas(64) std::atomic<uint8_t> middle{ 1 };
+		alignas(64) uint8_t front{ 2 };      // reader's
+	};
+
+} // namespace awesome
@@ -0,0 +1,176 @@
+#pragma once
+#include "3DMaths.h"
+#include "PixelConversion.h"
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+namespace awesome {
+
+	/*
+	 * Vertex layouts declared as types, e.g. VertexFormat<Pos<float2>, Tex<half2>>. The element
+	 * descriptions, offsets and stride are computed at compile time from the same list the packer
+	 * uses, so the input layout, the buffer stride and the packed data can not disagree.
+	 */
+
+	struct half2 {
+		uint16_t x, y;
+	};
+
+	struct half4 {
+		uint16_t x, y, z, w;
+	};
+
+	/* Four bytes read as 0..1 floats by the shader */
+	struct unorm8x4 {
+		uint8_t x, y, z, w;
+	};
+
+	/* Mapped to DXGI formats by the renderer so this header stays free of Windows includes */
+	enum class VertexElementFormat : uint8_t {
+		Float2,
+		Float3,
+		Float4,
+		Half2,
+		Half4,
+		UNorm8x4,
+	};
+
+	/* Matches D3D11_IA_VERTEX_INPUT_STRUCTURE_ELEMENT_COUNT and D3D11_REQ_MULTI_ELEMENT_STRUCTURE_SIZE_IN_BYTES */
+	constexpr uint32_t MAX_VERTEX_ELEMENTS = 32;
+	constexpr uint32_t MAX_VERTEX_STRIDE = 2048;
+
+	/* How one attribute type is stored and what it is packed from */
+	template<typename T> struct VertexAttribute;
+
+	template<> struct VertexAttribute<float2> {
+		static constexpr VertexElementFormat FORMAT = VertexElementFormat::Float2;
+		using Source = float2;
+		static float2 Convert(const float2& v) { return v; }
+	};
+
+	template<> struct VertexAttribute<float3> {
+		static constexpr VertexElementFormat FORMAT = VertexElementFormat::Float3;
+		using Source = float3;
+		static float3 Convert(const float3& v) { return v; }
+	};
+
+	template<> struct VertexAttribute<float4> {
+		static constexpr VertexElementFormat FORMAT = VertexElementFormat::Float4;
+		using Source = float4;
+		static float4 Convert(const float4& v) { return v; }
+	};
+
+	template<> struct VertexAttribute<half2> {
+		static constexpr VertexElementFormat FORMAT = VertexElementFormat::Half2;
+		using Source = float2;
+		static half2 Convert(const float2& v) { return { FloatToHalf(v.x), FloatToHalf(v.y) }; }
+	};
+
+	template<> struct VertexAttribute<half4> {
+		static constexpr VertexElementFormat FORMAT = VertexElementFormat::Half4;
+		using Source = float4;
+		static half4 Convert(const float4& v) { return { FloatToHalf(v.x), FloatToHalf(v.y), FloatToHalf(v.z), FloatToHalf(v.w) }; }
+	};
+
+	template<> struct VertexAttribute<unorm8x4> {
+		static constexpr VertexElementFormat FORMAT = VertexElementFormat::UNorm8x4;
+		using Source = float4;
+		static uint8_t ToUNorm8(float f) {
+			f = f < 0.0f ? 0.0f : (f > 1.0f ? 1.0f : f);
+			return static_cast<uint8_t>(lrintf(f * 255.0f));
+		}
+		static unorm8x4 Convert(const float4& v) { return { ToUNorm8(v.x), ToUNorm8(v.y), ToUNorm8(v.z), ToUNorm8(v.w) }; }
+	};
+
+	/* Semantics, the names have to match the vertex shader input */
+	template<typename T, uint32_t Index = 0> struct Pos {
+		using Type = T;
+		static constexpr const char* SEMANTIC = "POS";
+		static constexpr uint32_t SEMANTIC_INDEX = Index;
+	};
+
+	template<typename T, uint32_t Index = 0> struct Tex {
+		using Type = T;
+		static constexpr const char* SEMANTIC = "TEX";
+		static constexpr uint32_t SEMANTIC_INDEX = Index;
+	};
+
+	template<typename T, uint32_t Index = 0> struct Col {
+		using Type = T;
+		static constexpr const char* SEMANTIC = "COL";
+		static constexpr uint32_t SEMANTIC_INDEX = Index;
+	};
+
+	struct VertexElementDesc {
+		const char* semantic;
+		uint32_t semanticIndex;
+		VertexElementFormat format;
+		uint32_t offset;
+	};
+
+	template<typename... Elements>
+	class VertexFormat {
+	public:
+		static constexpr uint32_t ELEMENT_COUNT = sizeof...(Elements);
+		static_assert(ELEMENT_COUNT > 0 && ELEMENT_COUNT <= MAX_VERTEX_ELEMENTS, "Vertex formats need between 1 and 32 elements");
+		static_assert((std::is_trivially_copyable_v<typename Elements::Type> && ...), "Vertex attributes must be plain data");
+		/* The input assembler fetches every element at a 4 byte aligned offset */
+		static_assert(((sizeof(typename Elements::Type) % 4 == 0) && ...), "Vertex attribute sizes must be a multiple of 4 bytes");
+
+	private:
+		static constexpr std::array<uint32_t, ELEMENT_COUNT> SIZES = { static_cast<uint32_t>(sizeof(typename Elements::Type))... };
+
+		static constexpr std::array<uint32_t, ELEMENT_COUNT> ComputeOffsets() {
+			std::array<uint32_t, ELEMENT_COUNT> offsets{};
+			uint32_t offset = 0;
+			for (uint32_t i = 0; i < ELEMENT_COUNT; ++i) {
+				offsets[i] = offset;
+				offset += SIZES[i];
+			}
+			return offsets;
+		}
+
+	public:
+		static constexpr std::array<uint32_t, ELEMENT_COUNT> OFFSETS = ComputeOffsets();
+		static constexpr uint32_t STRIDE = OFFSETS[ELEMENT_COUNT - 1] + SIZES[ELEMENT_COUNT - 1];
+		static_assert(STRIDE % 4 == 0 && STRIDE <= MAX_VERTEX_STRIDE, "Vertex stride must be 4 byte aligned and at most 2048 bytes");
+
+	private:
+		template<size_t... Is>
+		static constexpr std::array<VertexElementDesc, ELEMENT_COUNT> MakeElements(std::index_sequence<Is...>) {
+			return { { { Elements::SEMANTIC, Elements::SEMANTIC_INDEX, VertexAttribute<typename Elements::Type>::FORMAT, OFFSETS[Is] }... } };
+		}
+
+		template<typename T>
+		static void Store(uint8_t* dst, const T& value) {
+			memcpy(dst, &value, sizeof(T));
+		}
+
+		template<size_t... Is>
+		static void PackVertex(uint8_t* vertex, std::index_sequence<Is...>,
+			const typename VertexAttribute<typename Elements::Type>::Source&... values) {
+			(Store(vertex + OFFSETS[Is], VertexAttribute<typename Elements::Type>::Convert(values)), ...);
+		}
+
+	public:
+		static constexpr std::array<VertexElementDesc, ELEMENT_COUNT> ELEMENTS = MakeElements(std::index_sequence_for<Elements...>{});
+
+		/* Writes one vertex, the arguments are the unpacked attributes in declaration order */
+		static void Pack(void* vertex, const typename VertexAttribute<typename Elements::Type>::Source&... values) {
+			PackVertex(static_cast<uint8_t*>(vertex), std::index_sequence_for<Elements...>{}, values...);
+		}
+
+		/* Interleaves one array per attribute into count vertices at dst, which holds count * STRIDE bytes */
+		static void PackVertices(void* dst, size_t count, const typename VertexAttribute<typename Elements::Type>::Source*... streams) {
+			uint8_t* vertex = static_cast<uint8_t*>(dst);
+			for (size_t i = 0; i < count; ++i, vertex += STRIDE)
+				PackVertex(vertex, std::index_sequence_for<Elements...>{}, streams[i]...);
+		}
+	};
+
+} // namespace awesome
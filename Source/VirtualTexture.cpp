@@ -0,0 +1,225 @@
+#include "VirtualTexture.h"
+#include <algorithm>
+#include <cassert>
+
+namespace awesome {
+
+	void PageTable::Init(uint32_t widthInPages, uint32_t heightInPages) {
+		assert(widthInPages <= MAX_PAGES_PER_SIDE && heightInPages <= MAX_PAGES_PER_SIDE); // 12 bits each in a page key
+		mips.clear();
+		uint32_t w = std::max(widthInPages, 1u);
+		uint32_t h = std::max(heightInPages, 1u);
+		for (;;) {
+			Mip mip;
+			mip.width = w;
+			mip.height = h;
+			mip.slots.assign(static_cast<size_t>(w) * h, -1);
+			mips.push_back(std::move(mip));
+			if (w == 1 && h == 1)
+				break;
+			w = std::max(w / 2, 1u);
+			h = std::max(h / 2, 1u);
+		}
+	}
+
+	bool PageTable::IsValid(PageId p) const {
+		return p.mip < mips.size() && p.x < mips[p.mip].width && p.y < mips[p.mip].height;
+	}
+
+	PageId PageTable::GetParent(PageId p) const {
+		const Mip& parent = mips[p.mip + 1];
+		return { p.mip + 1, std::min(p.x / 2, parent.width - 1), std::min(p.y / 2, parent.height - 1) };
+	}
+
+	int32_t PageTable::GetSlot(PageId p) const {
+		assert(IsValid(p));
+		const Mip& mip = mips[p.mip];
+		return mip.slots[static_cast<size_t>(p.y) * mip.width + p.x];
+	}
+
+	void PageTable::SetSlot(PageId p, int32_t slot) {
+		assert(IsValid(p));
+		Mip& mip = mips[p.mip];
+		mip.slots[static_cast<size_t>(p.y) * mip.width + p.x] = slot;
+	}
+
+	bool PageTable::Resolve(PageId p, PageId& resolved, int32_t& slot) const {
+		for (;;) {
+			int32_t s = GetSlot(p);
+			if (s >= 0) {
+				resolved = p;
+				slot = s;
+				return true;
+			}
+			if (p.mip + 1 >= mips.size())
+				return false;
+			p = GetParent(p);
+		}
+	}
+
+	void PageTable::BuildIndirection(uint32_t mip, uint32_t poolWidthInPages, std::vector<IndirectionEntry>& out) const {
+		const Mip& m = mips[mip];
+		out.resize(static_cast<size_t>(m.width) * m.height);
+		for (uint32_t y = 0; y < m.height; ++y) {
+			for (uint32_t x = 0; x < m.width; ++x) {
+				IndirectionEntry& e = out[static_cast<size_t>(y) * m.width + x];
+				PageId resolved;
+				int32_t slot;
+				if (Resolve({ mip, x, y }, resolved, slot))
+					e = { static_cast<uint8_t>(slot % poolWidthInPages), static_cast<uint8_t>(slot / poolWidthInPages), static_cast<uint8_t>(resolved.mip), 1 };
+				else
+					e = { 0, 0, 0, 0 };
+			}
+		}
+	}
+
+	void PhysicalPagePool::Init(uint32_t slotCount) {
+		slots.assign(slotCount, Slot{});
+	}
+
+	int32_t PhysicalPagePool::Allocate(uint64_t currentFrame, uint32_t& evictedKey) {
+		evictedKey = INVALID_PAGE_KEY;
+		int32_t victim = -1;
+		for (int32_t i = 0; i < static_cast<int32_t>(slots.size()); ++i) {
+			const Slot& s = slots[i];
+			if (s.pageKey == INVALID_PAGE_KEY)
+				return i;
+			/* pages sampled this frame stay, otherwise we would thrash the pool */
+			if (s.pinned || s.lastUsedFrame >= currentFrame)
+				continue;
+			if (victim < 0 || s.lastUsedFrame < slots[victim].lastUsedFrame)
+				victim = i;
+		}
+		if (victim >= 0)
+			evictedKey = slots[victim].pageKey;
+		return victim;
+	}
+
+	void PhysicalPagePool::Assign(int32_t slot, uint32_t pageKey, bool pinned, uint64_t currentFrame) {
+		slots[slot] = { pageKey, currentFrame, pinned };
+	}
+
+	void PhysicalPagePool::Touch(int32_t slot, uint64_t currentFrame) {
+		slots[slot].lastUsedFrame = currentFrame;
+	}
+
+	void PageManager::Init(const VirtualTextureDesc& desc, PageLoader loader) {
+		assert(desc.poolWidthInPages > 0 && desc.poolWidthInPages <= 256);
+		assert(desc.poolHeightInPages > 0 && desc.poolHeightInPages <= 256);
+		this->desc = desc;
+		this->loader = std::move(loader);
+		pageTable.Init(desc.widthInPages, desc.heightInPages);
+		pool.Init(desc.poolWidthInPages * desc.poolHeightInPages);
+		pending.clear();
+		stats = {};
+
+		/* The coarsest mip is always resident so every lookup resolves to something */
+		LoadPage({ pageTable.GetMipCount() - 1, 0, 0 }, true, 0);
+	}
+
+	void PageManager::RequestPage(PageId page, uint64_t frame) {
+		Request& r = pending[PackPageId(page)];
+		if (r.lastRequestedFrame != frame) {
+			r.count = 0;
+			r.lastRequestedFrame = frame;
+		}
+		++r.count;
+	}
+
+	void PageManager::ProcessFeedback(const uint32_t* feedback, size_t count, uint64_t frame) {
+		for (size_t i = 0; i < count; ++i) {
+			if (feedback[i] == INVALID_PAGE_KEY)
+				continue;
+			PageId page = UnpackPageId(feedback[i]);
+			if (!pageTable.IsValid(page))
+				continue;
+
+			/* Request the page and every missing ancestor, keep whatever it falls back to alive */
+			PageId resolved;
+			int32_t slot;
+			if (pageTable.Resolve(page, resolved, slot))
+				pool.Touch(slot, frame);
+			else
+				resolved.mip = pageTable.GetMipCount();
+			while (page.mip < resolved.mip) {
+				RequestPage(page, frame);
+				if (page.mip + 1 == resolved.mip)
+					break;
+				page = pageTable.GetParent(page);
+			}
+		}
+
+		/* Anything not asked for this frame is no longer visible */
+		uint32_t requested = 0;
+		for (auto it = pending.begin(); it != pending.end();) {
+			if (it->second.lastRequestedFrame != frame) {
+				it = pending.erase(it);
+			}
+			else {
+				++requested;
+				++it;
+			}
+		}
+		stats.requestedPages = requested;
+	}
+
+	bool PageManager::Update(uint64_t frame, uint32_t maxUploads) {
+		stats.uploadedPages = 0;
+		stats.evictedPages = 0;
+
+		sortScratch.clear();
+		for (const auto& kv : pending)
+			sortScratch.push_back(kv.first);
+
+		/* Coarse mips first so the fallback improves quickly, then the most requested pages */
+		auto higherPriority = [this](uint32_t a, uint32_t b) {
+			uint32_t mipA = a >> 24, mipB = b >> 24;
+			if (mipA != mipB)
+				return mipA > mipB;
+			uint32_t countA = pending[a].count, countB = pending[b].count;
+			if (countA != countB)
+				return countA > countB;
+			return a < b;
+		};
+		size_t uploadCount = std::min<size_t>(maxUploads, sortScratch.size());
+		std::partial_sort(sortScratch.begin(), sortScratch.begin() + uploadCount, sortScratch.end(), higherPriority);
+
+		bool changed = false;
+		for (size_t i = 0; i < uploadCount; ++i) {
+			uint32_t key = sortScratch[i];
+			LoadResult result = LoadPage(UnpackPageId(key), false, frame);
+			if (result == LoadResult::NoFreeSlot)
+				break;
+			pending.erase(key); // a page that failed to load is asked for again by the next feedback
+			changed |= (result == LoadResult::Loaded);
+		}
+		stats.pendingPages = static_cast<uint32_t>(pending.size());
+		return changed;
+	}
+
+	PageManager::LoadResult PageManager::LoadPage(PageId page, bool pinned, uint64_t frame) {
+		uint32_t evictedKey;
+		int32_t slot = pool.Allocate(frame, evictedKey);
+		if (slot < 0)
+			return LoadResult::NoFreeSlot; // every slot is in use this frame
+
+		if (evictedKey != INVALID_PAGE_KEY) {
+			pageTable.SetSlot(UnpackPageId(evictedKey), -1);
+			++stats.evictedPages;
+			--stats.residentPages;
+		}
+		pool.Assign(slot, INVALID_PAGE_KEY, false, 0);
+
+		uint32_t poolX = static_cast<uint32_t>(slot) % desc.poolWidthInPages;
+		uint32_t poolY = static_cast<uint32_t>(slot) / desc.poolWidthInPages;
+		if (loader && !loader(page, poolX, poolY))
+			return LoadResult::LoaderFailed;
+
+		pool.Assign(slot, PackPageId(page), pinned, frame);
+		pageTable.SetSlot(page, slot);
+		++stats.uploadedPages;
+		++stats.residentPages;
+		return LoadResult::Loaded;
+	}
+
+} // namespace awesome
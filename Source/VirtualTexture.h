@@ -0,0 +1,135 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace awesome {
+
+	/* One tile of the virtual texture: mip level plus tile coordinates inside that mip */
+	struct PageId {
+		uint32_t mip{ 0 };
+		uint32_t x{ 0 };
+		uint32_t y{ 0 };
+	};
+
+	/* Packed as mip:8 | y:12 | x:12, the same layout the feedback pass writes (see virtual_texture.hlsl) */
+	constexpr uint32_t INVALID_PAGE_KEY = 0xFFFFFFFFu;
+	constexpr uint32_t MAX_PAGES_PER_SIDE = 1u << 12;
+
+	inline uint32_t PackPageId(PageId p) {
+		return (p.mip << 24) | ((p.y & 0xFFFu) << 12) | (p.x & 0xFFFu);
+	}
+
+	inline PageId UnpackPageId(uint32_t key) {
+		return { key >> 24, key & 0xFFFu, (key >> 12) & 0xFFFu };
+	}
+
+	struct VirtualTextureDesc {
+		uint32_t widthInPages{ 0 };  // mip 0
+		uint32_t heightInPages{ 0 }; // mip 0
+		uint32_t pageSizeTexels{ 128 };
+		uint32_t poolWidthInPages{ 0 };
+		uint32_t poolHeightInPages{ 0 };
+	};
+
+	/* Texel of the indirection texture (R8G8B8A8_UINT): where the best resident page for a virtual page lives */
+	struct IndirectionEntry {
+		uint8_t poolX;
+		uint8_t poolY;
+		uint8_t mip;
+		uint8_t resident; // 0 only when nothing in the mip chain is resident yet
+	};
+
+	/* Maps virtual pages to physical pool slots, one table per mip */
+	class PageTable {
+	public:
+		void Init(uint32_t widthInPages, uint32_t heightInPages);
+		uint32_t GetMipCount() const { return static_cast<uint32_t>(mips.size()); }
+		uint32_t GetMipWidth(uint32_t mip) const { return mips[mip].width; }
+		uint32_t GetMipHeight(uint32_t mip) const { return mips[mip].height; }
+		bool IsValid(PageId p) const;
+		/* The page one mip coarser that covers p, p.mip + 1 must exist */
+		PageId GetParent(PageId p) const;
+
+		int32_t GetSlot(PageId p) const;
+		void SetSlot(PageId p, int32_t slot);
+		/* Walks towards coarser mips until it finds a resident page, returns false if none is */
+		bool Resolve(PageId p, PageId& resolved, int32_t& slot) const;
+		void BuildIndirection(uint32_t mip, uint32_t poolWidthInPages, std::vector<IndirectionEntry>& out) const;
+
+	private:
+		struct Mip {
+			uint32_t width{ 0 };
+			uint32_t height{ 0 };
+			std::vector<int32_t> slots;
+		};
+		std::vector<Mip> mips;
+	};
+
+	/* Fixed set of physical tiles in the pool texture, recycled least-recently-used first */
+	class PhysicalPagePool {
+	public:
+		void Init(uint32_t slotCount);
+		uint32_t GetSlotCount() const { return static_cast<uint32_t>(slots.size()); }
+		/* Returns a free slot, or evicts the least recently used unpinned page not touched this frame, -1 if none */
+		int32_t Allocate(uint64_t currentFrame, uint32_t& evictedKey);
+		void Assign(int32_t slot, uint32_t pageKey, bool pinned, uint64_t currentFrame);
+		void Touch(int32_t slot, uint64_t currentFrame);
+		uint32_t GetPageKey(int32_t slot) const { return slots[slot].pageKey; }
+
+	private:
+		struct Slot {
+			uint32_t pageKey{ INVALID_PAGE_KEY };
+			uint64_t lastUsedFrame{ 0 };
+			bool pinned{ false };
+		};
+		std::vector<Slot> slots;
+	};
+
+	struct PageManagerStats {
+		uint32_t requestedPages{ 0 };  // distinct non-resident pages asked for by the last feedback
+		uint32_t pendingPages{ 0 };    // still waiting after the last Update
+		uint32_t uploadedPages{ 0 };   // streamed in by the last Update
+		uint32_t evictedPages{ 0 };    // recycled by the last Update
+		uint32_t residentPages{ 0 };
+	};
+
+	/*
+	 * CPU side of the virtual texture. Each frame the GPU feedback buffer is handed to ProcessFeedback,
+	 * then Update streams the most important missing pages into the pool through the page loader
+	 * and reports whether the indirection texture has to be re-uploaded.
+	 */
+	class PageManager {
+	public:
+		/* Copies the tile into the pool texture at the given slot; returns false if the tile could not be read */
+		using PageLoader = std::function<bool(PageId page, uint32_t poolX, uint32_t poolY)>;
+
+		void Init(const VirtualTextureDesc& desc, PageLoader loader);
+		void ProcessFeedback(const uint32_t* feedback, size_t count, uint64_t frame);
+		bool Update(uint64_t frame, uint32_t maxUploads);
+
+		const PageTable& GetPageTable() const { return pageTable; }
+		const VirtualTextureDesc& GetDesc() const { return desc; }
+		const PageManagerStats& GetStats() const { return stats; }
+
+	private:
+		enum class LoadResult { Loaded, NoFreeSlot, LoaderFailed };
+		LoadResult LoadPage(PageId page, bool pinned, uint64_t frame);
+		void RequestPage(PageId page, uint64_t frame);
+
+		struct Request {
+			uint32_t count{ 0 };
+			uint64_t lastRequestedFrame{ 0 };
+		};
+
+		VirtualTextureDesc desc{};
+		PageLoader loader;
+		PageTable pageTable;
+		PhysicalPagePool pool;
+		std::unordered_map<uint32_t, Request> pending;
+		std::vector<uint32_t> sortScratch;
+		PageManagerStats stats{};
+	};
+
+} // namespace awesome